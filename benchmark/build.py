@@ -29,6 +29,7 @@ benchmarks = [
     #"test_array_allocation.cpp",
     #"test_png_encoding1.cpp",
     #"test_png_encoding2.cpp",
+    "test_png_encoding3.cpp",
     #"test_to_string1.cpp",
     #"test_to_string2.cpp",
     #"test_to_bool.cpp",
@@ -43,6 +44,7 @@ benchmarks = [
     "test_font_registration.cpp",
     "test_rendering.cpp",
     "test_rendering_shared_map.cpp",
+    "test_premultiply.cpp",
 ]
 for cpp_test in benchmarks:
     test_program = test_env_local.Program('out/'+cpp_test.replace('.cpp',''), source=[cpp_test])
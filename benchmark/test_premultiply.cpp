@@ -0,0 +1,47 @@
+#include "bench_framework.hpp"
+#include <mapnik/image_util.hpp>
+
+class test : public benchmark::test_case
+{
+    mutable mapnik::image_rgba8 im_;
+public:
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       im_(1024,1024)
+    {
+        // gradient of colours and alpha, a quarter of it opaque
+        for (unsigned y = 0; y < im_.height(); ++y)
+        {
+            for (unsigned x = 0; x < im_.width(); ++x)
+            {
+                unsigned a = (x < 256) ? 255 : (x + y) & 0xff;
+                im_(x,y) = (a << 24) | ((y & 0xff) << 16) | ((x * 3 & 0xff) << 8) | (x & 0xff);
+            }
+        }
+    }
+    bool validate() const
+    {
+        // a premultiply and demultiply round trip must keep opaque pixels
+        mapnik::image_rgba8 im(im_);
+        mapnik::premultiply_alpha(im);
+        mapnik::demultiply_alpha(im);
+        for (unsigned y = 0; y < im.height(); ++y)
+        {
+            for (unsigned x = 0; x < 256; ++x)
+            {
+                if (im(x,y) != im_(x,y)) return false;
+            }
+        }
+        return true;
+    }
+    bool operator()() const
+    {
+        for (std::size_t i=0;i<iterations_;++i) {
+            mapnik::premultiply_alpha(im_);
+            mapnik::demultiply_alpha(im_);
+        }
+        return true;
+    }
+};
+
+BENCHMARK(test,"premultiply and demultiply rgba8")
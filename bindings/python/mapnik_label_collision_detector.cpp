@@ -38,6 +38,7 @@
 #include <mapnik/map.hpp>
 
 #include <list>
+#include <sstream>
 
 using mapnik::label_collision_detector4;
 using mapnik::box2d;
@@ -74,6 +75,20 @@ make_label_boxes(std::shared_ptr<label_collision_detector4> det)
     return boxes;
 }
 
+std::string save_labels(std::shared_ptr<label_collision_detector4> det, box2d<double> const& region)
+{
+    std::ostringstream ss;
+    det->save_labels(ss, region);
+    return ss.str();
+}
+
+bool load_labels(std::shared_ptr<label_collision_detector4> det, std::string const& labels,
+                 double dx, double dy)
+{
+    std::istringstream ss(labels);
+    return det->load_labels(ss, dx, dy);
+}
+
 }
 
 void export_label_collision_detector()
@@ -127,5 +142,23 @@ void export_label_collision_detector()
              ">>> m = Map(size_x, size_y)\n"
              ">>> detector = mapnik.LabelCollisionDetector(m)"
              ">>> detector.insert(mapnik.Box2d(196, 254, 291, 389))")
+
+        .def("save_labels", &save_labels,
+             (arg("region")),
+             "Serializes the labels intersecting the given region to a string, "
+             "e.g. the part of the buffer overlapping a neighbouring tile.\n"
+             "\n"
+             "Example:\n"
+             ">>> labels = detector.save_labels(mapnik.Box2d(256, -128, 384, 384))")
+
+        .def("load_labels", &load_labels,
+             (arg("labels"), arg("dx")=0.0, arg("dy")=0.0),
+             "Seeds the detector with labels from save_labels, translated by (dx, dy) "
+             "into this detector's pixel space. Returns False if the input is malformed.\n"
+             "\n"
+             "Example:\n"
+             ">>> detector = mapnik.LabelCollisionDetector(m)\n"
+             ">>> detector.load_labels(labels, -256, 0)\n"
+             ">>> mapnik.render_with_detector(m, im, detector)")
         ;
 }
@@ -469,6 +469,19 @@ void export_map()
                       "2\n"
             )
 
+        .add_property("deferred_labels",
+                      &Map::deferred_labels,
+                      &Map::set_deferred_labels,
+                      "Get/Set deferred label placement. When enabled text and shield\n"
+                      "labels of all layers are placed after rendering, ordered by\n"
+                      "their 'priority' property (highest first).\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> m.deferred_labels\n"
+                      "False # False by default\n"
+                      ">>> m.deferred_labels = True\n"
+            )
+
         .add_property("height",
                       &Map::height,
                       &Map::set_height,
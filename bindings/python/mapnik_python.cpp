@@ -114,6 +114,7 @@ void export_logger();
 #include "mapnik_threads.hpp"
 #include "python_optional.hpp"
 #include <mapnik/marker_cache.hpp>
+#include <mapnik/util/parallel.hpp>
 #if defined(SHAPE_MEMORY_MAPPED_FILE)
 #include <mapnik/mapped_memory_cache.hpp>
 #endif
@@ -1051,6 +1052,18 @@ BOOST_PYTHON_MODULE(_mapnik)
     def("has_grid_renderer", &has_grid_renderer, "Get grid_renderer status");
     def("has_cairo", &has_cairo, "Get cairo library status");
     def("has_pycairo", &has_pycairo, "Get pycairo module status");
+    def("band_threads", &mapnik::util::band_threads,
+        "Get the number of threads image filters, raster colouring, scaling\n"
+        "and reprojection split an image across (1 by default)");
+    def("set_band_threads", &mapnik::util::set_band_threads, (arg("threads")),
+        "Set the number of threads image filters, raster colouring, scaling\n"
+        "and reprojection split an image across. Threads come from one pool\n"
+        "shared by the whole process; keep 1 when already rendering a map per core.\n"
+        "\n"
+        "Usage:\n"
+        ">>> from mapnik import set_band_threads\n"
+        ">>> set_band_threads(4)\n"
+        );
 
     python_optional<mapnik::font_set>();
     python_optional<mapnik::color>();
@@ -419,6 +419,7 @@ void export_text_placement()
     enumeration_<halo_rasterizer_e>("halo_rasterizer")
         .value("FULL",HALO_RASTERIZER_FULL)
         .value("FAST",HALO_RASTERIZER_FAST)
+        .value("DILATE",HALO_RASTERIZER_DILATE)
         ;
     */
     class_<text_symbolizer>("TextSymbolizer",
@@ -53,6 +53,7 @@ namespace mapnik {
   class proj_transform;
   struct rasterizer;
   struct rgba8_t;
+  class deferred_labels;
   template<typename T> class image;
 }
 
@@ -126,16 +127,23 @@ public:
                  mapnik::feature_impl & feature,
                  proj_transform const& prj_trans);
 
-    inline bool process(rule::symbolizers const&,
+    inline bool process(rule::symbolizers const& syms,
                         mapnik::feature_impl&,
                         proj_transform const& )
     {
+        // every symbolizer and raster goes through here first, so whatever
+        // they draw the image can no longer be assumed solid
+        if (!syms.empty()) solid_ = false;
         // agg renderer doesn't support processing of multiple symbolizers.
         return false;
     }
 
     void painted(bool painted);
     bool painted();
+    // true while the image is known to be a single colour: the background
+    // was filled and no symbolizer, marker, composite or filter touched it
+    // since. Pass it on to save_to_sink/save_to_string to skip their scan.
+    bool solid() const;
 
     inline eAttributeCollectionPolicy attribute_collection_policy() const
     {
@@ -160,6 +168,20 @@ protected:
     void draw_geo_extent(box2d<double> const& extent,mapnik::color const& color);
 
 private:
+    // place and render a label now, see deferred_labels for the
+    // priority sorted alternative
+    void render_label(text_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_label(shield_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_deferred_labels();
+
     buffer_type & pixmap_;
     std::shared_ptr<buffer_type> internal_buffer_;
     mutable buffer_type * current_buffer_;
@@ -167,7 +189,9 @@ private:
     const std::unique_ptr<rasterizer> ras_ptr;
     gamma_method_enum gamma_method_;
     double gamma_;
+    bool solid_;
     renderer_common common_;
+    std::unique_ptr<deferred_labels> deferred_labels_;
     void setup(Map const& m);
 };
 
@@ -51,6 +51,7 @@ struct marker;
 class proj_transform;
 class request;
 struct pixel_position;
+class deferred_labels;
 struct cairo_save_restore
 {
     cairo_save_restore(cairo_context & context)
@@ -178,6 +179,21 @@ protected:
     renderer_common common_;
     cairo_face_manager face_manager_;
     void setup(Map const& m);
+private:
+    // place and render a label now, see deferred_labels for the
+    // priority sorted alternative
+    void render_label(text_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_label(shield_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_deferred_labels();
+    std::unique_ptr<deferred_labels> deferred_labels_;
 
 };
 
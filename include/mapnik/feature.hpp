@@ -90,7 +90,8 @@ using context_ptr = std::shared_ptr<context_type>;
 
 static const value default_feature_value;
 
-class MAPNIK_DECL feature_impl : private util::noncopyable
+class MAPNIK_DECL feature_impl : private util::noncopyable,
+                                public std::enable_shared_from_this<feature_impl>
 {
     friend class feature_kv_iterator;
 public:
@@ -32,6 +32,7 @@
 // stl
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <utility> // pair
 #include <vector>
 
@@ -50,6 +51,7 @@ class font_face_set;
 using face_set_ptr = std::unique_ptr<font_face_set>;
 class font_face;
 using face_ptr = std::shared_ptr<font_face>;
+class text_layout;
 
 class MAPNIK_DECL freetype_engine
 {
@@ -103,6 +105,7 @@ private:
 class MAPNIK_DECL face_manager : private util::noncopyable
 {
     using face_ptr_cache_type = std::map<std::string, face_ptr>;
+    using layout_cache_type = std::unordered_map<std::string, std::shared_ptr<text_layout>>;
 
 public:
     face_manager(font_library & library,
@@ -113,12 +116,17 @@ public:
     face_set_ptr get_face_set(font_set const& fset);
     face_set_ptr get_face_set(std::string const& name, boost::optional<font_set> fset);
     inline stroker_ptr get_stroker() { return stroker_; }
+    // Finished text layouts keyed by text_layout::cache_key(). Repeated labels (e.g. road shields)
+    // are shaped only once per face_manager, i.e. once per render.
+    std::shared_ptr<text_layout> get_layout(std::string const& key) const;
+    void add_layout(std::string const& key, std::shared_ptr<text_layout> const& layout);
 private:
     face_ptr_cache_type face_ptr_cache_;
     font_library & library_;
     freetype_engine::font_file_mapping_type const& font_file_mapping_;
     freetype_engine::font_memory_cache_type const& font_memory_cache_;
     stroker_ptr stroker_;
+    layout_cache_type layout_cache_;
 };
 
 using face_manager_freetype = face_manager;
@@ -53,6 +53,7 @@ namespace mapnik {
   class proj_transform;
   struct grid_rasterizer;
   class request;
+  class deferred_labels;
 }
 
 namespace mapnik {
@@ -145,9 +146,24 @@ public:
     }
 
 private:
+    // place and render a label now, see deferred_labels for the
+    // priority sorted alternative
+    void render_label(text_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_label(shield_symbolizer const& sym,
+                      mapnik::feature_impl const& feature,
+                      proj_transform const& prj_trans,
+                      box2d<double> const& clip_box,
+                      agg::trans_affine const& tr);
+    void render_deferred_labels();
+
     buffer_type & pixmap_;
     const std::unique_ptr<grid_rasterizer> ras_ptr;
     renderer_common common_;
+    std::unique_ptr<deferred_labels> deferred_labels_;
     void setup(Map const& m);
 };
 }
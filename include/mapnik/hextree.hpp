@@ -197,7 +197,8 @@ public:
         }
     }
 
-    void insert(T const& data)
+    // insert `n` pixels of the same color
+    void insert(T const& data, unsigned n = 1)
     {
         byte a = preprocessAlpha(data.a);
         unsigned level = 0;
@@ -209,15 +210,19 @@ public:
         }
         while (true)
         {
-            cur_node->pixel_count++;
-            cur_node->reds   += gammaLUT_[data.r];
-            cur_node->greens += gammaLUT_[data.g];
-            cur_node->blues  += gammaLUT_[data.b];
-            cur_node->alphas += a;
+            cur_node->pixel_count += n;
+            // summing one pixel at a time keeps the result identical to n separate inserts
+            for (unsigned i = 0; i < n; ++i)
+            {
+                cur_node->reds   += gammaLUT_[data.r];
+                cur_node->greens += gammaLUT_[data.g];
+                cur_node->blues  += gammaLUT_[data.b];
+                cur_node->alphas += a;
+            }
 
             if (level == InsertPolicy::MAX_LEVELS)
             {
-                if (cur_node->pixel_count == 1)
+                if (cur_node->pixel_count == n)
                 {
                     ++colors_;
                 }
@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_IMAGE_BUFFER_POOL_HPP
+#define MAPNIK_IMAGE_BUFFER_POOL_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+
+namespace mapnik
+{
+
+// Process wide pool of scratch rgba8 images, such as the buffers agg_renderer
+// draws styles into before compositing and filtering them. Buffers are keyed
+// by size and handed out fully transparent, so renderers do not allocate and
+// page fault a whole image per render.
+class MAPNIK_DECL image_buffer_pool :
+        public singleton<image_buffer_pool, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<image_buffer_pool>;
+    struct store;
+    // Shared with the deleters of acquired buffers through weak references,
+    // so buffers outliving the pool (destroyed at exit) are simply freed.
+    std::shared_ptr<store> store_;
+    image_buffer_pool();
+    ~image_buffer_pool();
+public:
+    using buffer_ptr = std::shared_ptr<image_rgba8>;
+    // A transparent width x height image; it goes back to the pool, cleared,
+    // when the last copy of the pointer is destroyed.
+    buffer_ptr acquire(unsigned width, unsigned height);
+    // Upper bound on the memory held by idle buffers (64MB by default)
+    void set_max_bytes(std::size_t bytes);
+    std::size_t max_bytes() const;
+    std::size_t idle_bytes() const;
+    void clear();
+};
+
+// Zeroes the bounding box of the pixels that are not transparent black,
+// leaving the whole image transparent. Cheaper than fill() when only part of
+// the image was painted.
+MAPNIK_DECL void clear_painted(image_rgba8 & image);
+
+}
+
+#endif // MAPNIK_IMAGE_BUFFER_POOL_HPP
@@ -27,6 +27,7 @@
 //mapnik
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/util/hsl.hpp>
+#include <mapnik/util/parallel.hpp>
 
 // boost GIL
 #pragma GCC diagnostic push
@@ -45,6 +46,14 @@
 #include "agg_gradient_lut.h"
 // stl
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -143,267 +152,265 @@ boost::gil::rgba8_view_t rgba8_view(Image & img)
                             img.width() * sizeof(rgba8_pixel_t));
 }
 
+// Scratch output for filters that read neighbouring pixels: bands write into
+// it and the result is copied back once every band is done
 template <typename Image>
 struct double_buffer
 {
-    boost::gil::rgba8_image_t   dst_buffer;
-    boost::gil::rgba8_view_t    dst_view;
-    boost::gil::rgba8_view_t    src_view;
+    std::vector<std::uint8_t> dst;
+    Image & src;
+
+    explicit double_buffer(Image & src_)
+        : dst(src_.getSize()),
+          src(src_) {}
+
+    std::uint8_t const* src_row(unsigned y) const
+    {
+        return src.getBytes() + y * src.getRowSize();
+    }
 
-    explicit double_buffer(Image & src)
-        : dst_buffer(src.width(), src.height())
-        , dst_view(view(dst_buffer))
-        , src_view(rgba8_view(src)) {}
+    std::uint8_t * dst_row(unsigned y)
+    {
+        return dst.data() + y * src.getRowSize();
+    }
 
     ~double_buffer()
     {
-        copy_pixels(dst_view, src_view);
+        std::copy(dst.begin(), dst.end(), src.getBytes());
     }
 };
 
-template <typename Src, typename Dst, typename Conv>
-void process_channel_impl (Src const& src, Dst & dst, Conv const& k)
+// Three source rows as floats, padded with the edge pixel on both sides so
+// that the 3x3 window needs no bounds checks. Rows are kept in a slot per
+// y % 3, so walking down a band converts each row once.
+class float_rows
 {
-    using boost::gil::bits32f;
-
-    bits32f out_value =
-        k[0]*src[0] + k[1]*src[1] + k[2]*src[2] +
-        k[3]*src[3] + k[4]*src[4] + k[5]*src[5] +
-        k[6]*src[6] + k[7]*src[7] + k[8]*src[8]
-        ;
-    if (out_value < 0) out_value = 0;
-    if (out_value > 255) out_value = 255;
-    dst = out_value;
-}
+public:
+    float_rows(std::uint8_t const* bytes, unsigned width, std::size_t row_size)
+        : bytes_(bytes),
+          width_(width),
+          row_size_(row_size),
+          data_(3 * (width + 2) * 4)
+    {
+        std::fill(tags_, tags_ + 3, -1);
+    }
 
-template <typename Src, typename Dst, typename Conv>
-void process_channel (Src const&, Dst &, Conv const&)
+    // pixel x - 1 of row y starts at row(y)[x * 4]
+    float const* row(int y)
+    {
+        int slot = y % 3;
+        float * out = data_.data() + slot * (width_ + 2) * 4;
+        if (tags_[slot] != y)
+        {
+            std::uint8_t const* in = bytes_ + y * row_size_;
+            std::copy(in, in + width_ * 4, out + 4);
+            std::copy(out + 4, out + 8, out);
+            std::copy(out + width_ * 4, out + width_ * 4 + 4, out + (width_ + 1) * 4);
+            tags_[slot] = y;
+        }
+        return out;
+    }
+
+private:
+    std::uint8_t const* bytes_;
+    unsigned width_;
+    std::size_t row_size_;
+    std::vector<float> data_;
+    int tags_[3];
+};
+
+// c0 c1 c2   from rows r0, r1, r2
+// c3 c4 c5
+// c6 c7 c8
+inline void convolve_row(float const* r0, float const* r1, float const* r2,
+                         std::uint8_t const* src, std::uint8_t * dst,
+                         unsigned width, float const* k)
 {
+    unsigned x = 0;
+#ifdef SSE_MATH
+    // all four channels of a pixel at once, summed in the same order as the
+    // scalar loop so that results are identical
+    __m128 const k0 = _mm_set1_ps(k[0]), k1 = _mm_set1_ps(k[1]), k2 = _mm_set1_ps(k[2]);
+    __m128 const k3 = _mm_set1_ps(k[3]), k4 = _mm_set1_ps(k[4]), k5 = _mm_set1_ps(k[5]);
+    __m128 const k6 = _mm_set1_ps(k[6]), k7 = _mm_set1_ps(k[7]), k8 = _mm_set1_ps(k[8]);
+    __m128 const lo = _mm_setzero_ps();
+    __m128 const hi = _mm_set1_ps(255.0f);
+    for (; x < width; ++x)
+    {
+        float const* a = r0 + x * 4;
+        float const* b = r1 + x * 4;
+        float const* c = r2 + x * 4;
+        __m128 v = _mm_mul_ps(k0, _mm_loadu_ps(a));
+        v = _mm_add_ps(v, _mm_mul_ps(k1, _mm_loadu_ps(a + 4)));
+        v = _mm_add_ps(v, _mm_mul_ps(k2, _mm_loadu_ps(a + 8)));
+        v = _mm_add_ps(v, _mm_mul_ps(k3, _mm_loadu_ps(b)));
+        v = _mm_add_ps(v, _mm_mul_ps(k4, _mm_loadu_ps(b + 4)));
+        v = _mm_add_ps(v, _mm_mul_ps(k5, _mm_loadu_ps(b + 8)));
+        v = _mm_add_ps(v, _mm_mul_ps(k6, _mm_loadu_ps(c)));
+        v = _mm_add_ps(v, _mm_mul_ps(k7, _mm_loadu_ps(c + 4)));
+        v = _mm_add_ps(v, _mm_mul_ps(k8, _mm_loadu_ps(c + 8)));
+        __m128i i = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+        i = _mm_packs_epi32(i, i);
+        std::uint32_t px = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(i, i)));
+        std::memcpy(dst + x * 4, &px, 4);
+        dst[x * 4 + 3] = src[x * 4 + 3]; // Dst.a = Src.a
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        float const* a = r0 + x * 4;
+        float const* b = r1 + x * 4;
+        float const* c = r2 + x * 4;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            float out_value =
+                k[0]*a[i] + k[1]*a[i + 4] + k[2]*a[i + 8] +
+                k[3]*b[i] + k[4]*b[i + 4] + k[5]*b[i + 8] +
+                k[6]*c[i] + k[7]*c[i + 4] + k[8]*c[i + 8]
+                ;
+            if (out_value < 0) out_value = 0;
+            if (out_value > 255) out_value = 255;
+            dst[x * 4 + i] = static_cast<std::uint8_t>(out_value);
+        }
+        dst[x * 4 + 3] = src[x * 4 + 3]; // Dst.a = Src.a
+    }
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::blur)
+inline void sobel_row(float const* r0, float const* r1, float const* r2,
+                      std::uint8_t const* src, std::uint8_t * dst,
+                      unsigned width)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::blur_matrix);
+    for (unsigned x = 0; x < width; ++x)
+    {
+        float const* a = r0 + x * 4;
+        float const* b = r1 + x * 4;
+        float const* c = r2 + x * 4;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            float x_gradient = (a[i + 8] + 2*b[i + 8] + c[i + 8])
+                - (a[i] + 2*b[i] + c[i]);
+
+            float y_gradient = (a[i] + 2*a[i + 4] + a[i + 8])
+                - (c[i] + 2*c[i + 4] + c[i + 8]);
+
+            float out_value  = std::sqrt(std::pow(x_gradient,2) + std::pow(y_gradient,2));
+            if (out_value < 0) out_value = 0;
+            if (out_value > 255) out_value = 255;
+            dst[x * 4 + i] = static_cast<std::uint8_t>(out_value);
+        }
+        dst[x * 4 + 3] = src[x * 4 + 3]; // Dst.a = Src.a
+    }
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::emboss)
+template <typename Filter>
+struct convolution_3x3
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::emboss_matrix);
-}
+    explicit convolution_3x3(float const* k)
+        : k_(k) {}
+
+    void operator() (float const* r0, float const* r1, float const* r2,
+                     std::uint8_t const* src, std::uint8_t * dst, unsigned width) const
+    {
+        convolve_row(r0, r1, r2, src, dst, width, k_);
+    }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::sharpen)
+    float const* k_;
+};
+
+inline convolution_3x3<blur> row_filter(blur const&)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::sharpen_matrix);
+    return convolution_3x3<blur>(mapnik::filter::detail::blur_matrix);
 }
 
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::edge_detect)
+inline convolution_3x3<emboss> row_filter(emboss const&)
 {
-    process_channel_impl(src,dst,mapnik::filter::detail::edge_detect_matrix);
+    return convolution_3x3<emboss>(mapnik::filter::detail::emboss_matrix);
 }
 
-
-template <typename Src, typename Dst>
-void process_channel (Src const& src, Dst & dst, mapnik::filter::sobel)
+inline convolution_3x3<sharpen> row_filter(sharpen const&)
 {
-    using boost::gil::bits32f;
-
-    bits32f x_gradient = (src[2] + 2*src[5] + src[8])
-        - (src[0] + 2*src[3] + src[6]);
-
-    bits32f y_gradient = (src[0] + 2*src[1] + src[2])
-        - (src[6] + 2*src[7] + src[8]);
-
-    bits32f  out_value  = std::sqrt(std::pow(x_gradient,2) + std::pow(y_gradient,2));
-    //bts32f theta = std::atan2(x_gradient,y_gradient);
-    if (out_value < 0) out_value = 0;
-    if (out_value > 255) out_value = 255;
-    dst = out_value;
+    return convolution_3x3<sharpen>(mapnik::filter::detail::sharpen_matrix);
 }
 
+inline convolution_3x3<edge_detect> row_filter(edge_detect const&)
+{
+    return convolution_3x3<edge_detect>(mapnik::filter::detail::edge_detect_matrix);
+}
 
-
-template <typename Src, typename Dst, typename Filter>
-void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+struct sobel_row_filter
 {
-    using boost::gil::bits32f;
-    using boost::gil::point2;
-
-    // p0 p1 p2
-    // p3 p4 p5
-    // p6 p7 p8
-
-    typename Src::xy_locator src_loc = src_view.xy_at(0,0);
-    typename Src::xy_locator::cached_location_t loc00 = src_loc.cache_location(-1,-1);
-    typename Src::xy_locator::cached_location_t loc10 = src_loc.cache_location( 0,-1);
-    typename Src::xy_locator::cached_location_t loc20 = src_loc.cache_location( 1,-1);
-    typename Src::xy_locator::cached_location_t loc01 = src_loc.cache_location(-1, 0);
-    typename Src::xy_locator::cached_location_t loc11 = src_loc.cache_location( 0, 0);
-    typename Src::xy_locator::cached_location_t loc21 = src_loc.cache_location( 1, 0);
-    typename Src::xy_locator::cached_location_t loc02 = src_loc.cache_location(-1, 1);
-    typename Src::xy_locator::cached_location_t loc12 = src_loc.cache_location( 0, 1);
-    typename Src::xy_locator::cached_location_t loc22 = src_loc.cache_location( 1, 1);
-
-    typename Src::x_iterator dst_it = dst_view.row_begin(0);
-
-    // top row
-    for (int x = 0 ; x < src_view.width(); ++x)
+    void operator() (float const* r0, float const* r1, float const* r2,
+                     std::uint8_t const* src, std::uint8_t * dst, unsigned width) const
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (int i = 0; i < 3; ++i)
-        {
-            bits32f p[9];
-
-            p[4] = src_loc[loc11][i];
-            p[7] = src_loc[loc12][i];
-
-            if (x == 0)
-            {
-                p[3] = p[4];
-                p[6] = p[7];
-            }
-            else
-            {
-                p[3] = src_loc[loc01][i];
-                p[6] = src_loc[loc02][i];
-            }
-
-            if ( x == src_view.width()-1)
-            {
-                p[5] = p[4];
-                p[8] = p[7];
-            }
-            else
-            {
-                p[5] = src_loc[loc21][i];
-                p[8] = src_loc[loc22][i];
-            }
-
-            p[0] = p[6];
-            p[1] = p[7];
-            p[2] = p[8];
-
-            process_channel(p, (*dst_it)[i], filter);
-        }
-        ++src_loc.x();
-        ++dst_it;
+        sobel_row(r0, r1, r2, src, dst, width);
     }
-    // carrige-return
-    src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
-
-    // 1... height-1 rows
-    for (int y = 1; y<src_view.height()-1; ++y)
-    {
-        for (int x = 0; x < src_view.width(); ++x)
-        {
-            (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-            for (int i = 0; i < 3; ++i)
-            {
-                bits32f p[9];
-
-                p[1] = src_loc[loc10][i];
-                p[4] = src_loc[loc11][i];
-                p[7] = src_loc[loc12][i];
-
-                if (x == 0)
-                {
-                    p[0] = p[1];
-                    p[3] = p[4];
-                    p[6] = p[7];
-                }
-                else
-                {
-                    p[0] = src_loc[loc00][i];
-                    p[3] = src_loc[loc01][i];
-                    p[6] = src_loc[loc02][i];
-                }
+};
 
-                if ( x == src_view.width() - 1)
-                {
-                    p[2] = p[1];
-                    p[5] = p[4];
-                    p[8] = p[7];
-                }
-                else
-                {
-                    p[2] = src_loc[loc20][i];
-                    p[5] = src_loc[loc21][i];
-                    p[8] = src_loc[loc22][i];
-                }
-                process_channel(p, (*dst_it)[i], filter);
-            }
-            ++dst_it;
-            ++src_loc.x();
-        }
-        // carrige-return
-        src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
-    }
+inline sobel_row_filter row_filter(sobel const&)
+{
+    return sobel_row_filter();
+}
 
-    // bottom row
-    //src_loc = src_view.xy_at(0,src_view.height()-1);
-    for (int x = 0 ; x < src_view.width(); ++x)
+// Rows outside the image are mirrored (the row below stands in for the one
+// above the top row and vice versa), columns are clamped to the edge.
+template <typename Src, typename Filter>
+void apply_convolution_3x3(Src & src, Filter const& filter)
+{
+    if (src.width() == 0 || src.height() == 0) return;
+    auto row_op = row_filter(filter);
+    double_buffer<Src> tb(src);
+    int const last = static_cast<int>(src.height()) - 1;
+    util::parallel_rows(src.height(), src.width(), [&](unsigned y0, unsigned y1)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (int i = 0; i < 3; ++i)
+        float_rows rows(src.getBytes(), src.width(), src.getRowSize());
+        for (unsigned y = y0; y < y1; ++y)
         {
-            bits32f p[9];
-
-            p[1] = src_loc[loc10][i];
-            p[4] = src_loc[loc11][i];
-
-            if (x == 0)
-            {
-                p[0] = p[1];
-                p[3] = p[4];
-            }
-            else
-            {
-                p[0] = src_loc[loc00][i];
-                p[3] = src_loc[loc01][i];
-            }
-
-            if ( x == src_view.width()-1)
-            {
-                p[2] = p[1];
-                p[5] = p[4];
-
-            }
-            else
-            {
-                p[2] = src_loc[loc20][i];
-                p[5] = src_loc[loc21][i];
-            }
-
-            p[6] = p[0];
-            p[7] = p[1];
-            p[8] = p[2];
-            process_channel(p, (*dst_it)[i], filter);
+            int yi = static_cast<int>(y);
+            int above = (yi == 0) ? std::min(1, last) : yi - 1;
+            int below = (yi == last) ? std::max(last - 1, 0) : yi + 1;
+            float const* r0 = rows.row(above);
+            float const* r1 = rows.row(yi);
+            float const* r2 = rows.row(below);
+            row_op(r0, r1, r2, tb.src_row(y), tb.dst_row(y), src.width());
         }
-        ++src_loc.x();
-        ++dst_it;
-    }
+    });
 }
 
 template <typename Src, typename Filter>
 void apply_filter(Src & src, Filter const& filter)
 {
-    {
-        demultiply_alpha(src);
-        double_buffer<Src> tb(src);
-        apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
-    } // ensure ~double_buffer() is called before premultiplying
+    demultiply_alpha(src);
+    apply_convolution_3x3(src, filter);
     premultiply_alpha(src);
 }
 
+// agg's stack blur is separable: rows are blurred independently, then
+// columns, so each pass is split into bands of rows or strips of columns.
 template <typename Src>
 void apply_filter(Src & src, agg_stack_blur const& op)
 {
-    agg::rendering_buffer buf(src.getBytes(),src.width(),src.height(), src.getRowSize());
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+    unsigned width = src.width();
+    unsigned height = src.height();
+    if (width == 0 || height == 0) return;
+    int stride = src.getRowSize();
+    if (op.rx > 0)
+    {
+        util::parallel_rows(height, width, [&](unsigned y0, unsigned y1)
+        {
+            agg::rendering_buffer buf(src.getBytes() + y0 * stride, width, y1 - y0, stride);
+            agg::pixfmt_rgba32_pre pixf(buf);
+            agg::stack_blur_rgba32(pixf, op.rx, 0);
+        });
+    }
+    if (op.ry > 0)
+    {
+        util::parallel_rows(width, height, [&](unsigned x0, unsigned x1)
+        {
+            agg::rendering_buffer buf(src.getBytes() + x0 * 4, x1 - x0, height, stride);
+            agg::pixfmt_rgba32_pre pixf(buf);
+            agg::stack_blur_rgba32(pixf, 0, op.ry);
+        });
+    }
 }
 
 inline double channel_delta(double source, double match)
@@ -488,23 +495,26 @@ void apply_filter(Src & src, colorize_alpha const& op)
         mapnik::filter::color_stop const& stop = op[0];
         mapnik::color const& c = stop.color;
         rgba8_view_t src_view = rgba8_view(src);
-        for (int y=0; y<src_view.height(); ++y)
+        util::parallel_rows(src.height(), src.width(), [&](unsigned y0, unsigned y1)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-            for (int x=0; x<src_view.width(); ++x)
+            for (int y=y0; y<static_cast<int>(y1); ++y)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                if ( a > 0)
+                rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
+                for (int x=0; x<src_view.width(); ++x)
                 {
-                    r = (c.red() * a + 255) >> 8;
-                    g = (c.green() * a + 255) >> 8;
-                    b = (c.blue() * a + 255) >> 8;
+                    uint8_t & r = get_color(src_it[x], red_t());
+                    uint8_t & g = get_color(src_it[x], green_t());
+                    uint8_t & b = get_color(src_it[x], blue_t());
+                    uint8_t & a = get_color(src_it[x], alpha_t());
+                    if ( a > 0)
+                    {
+                        r = (c.red() * a + 255) >> 8;
+                        g = (c.green() * a + 255) >> 8;
+                        b = (c.blue() * a + 255) >> 8;
+                    }
                 }
             }
-        }
+        });
     }
     else if (size > 1)
     {
@@ -529,56 +539,30 @@ void apply_filter(Src & src, colorize_alpha const& op)
         if (grad_lut.build_lut())
         {
             rgba8_view_t src_view = rgba8_view(src);
-            for (int y=0; y<src_view.height(); ++y)
+            util::parallel_rows(src.height(), src.width(), [&](unsigned y0, unsigned y1)
             {
-                rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-                for (int x=0; x<src_view.width(); ++x)
+                for (int y=y0; y<static_cast<int>(y1); ++y)
                 {
-                    uint8_t & r = get_color(src_it[x], red_t());
-                    uint8_t & g = get_color(src_it[x], green_t());
-                    uint8_t & b = get_color(src_it[x], blue_t());
-                    uint8_t & a = get_color(src_it[x], alpha_t());
-                    if ( a > 0)
+                    rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
+                    for (int x=0; x<src_view.width(); ++x)
                     {
-                        agg::rgba8 c = grad_lut[a];
-                        r = (c.r * a + 255) >> 8;
-                        g = (c.g * a + 255) >> 8;
-                        b = (c.b * a + 255) >> 8;
-                        if (r>a) r=a;
-                        if (g>a) g=a;
-                        if (b>a) b=a;
-        #if 0
-                        // rainbow
-                        r = 0;
-                        g = 0;
-                        b = 0;
-                        if (a < 64)
-                        {
-                            g = a * 4;
-                            b = 255;
-                        }
-                        else if (a >= 64 && a < 128)
+                        uint8_t & r = get_color(src_it[x], red_t());
+                        uint8_t & g = get_color(src_it[x], green_t());
+                        uint8_t & b = get_color(src_it[x], blue_t());
+                        uint8_t & a = get_color(src_it[x], alpha_t());
+                        if ( a > 0)
                         {
-                            g = 255;
-                            b = 255 - ((a - 64) * 4);
+                            agg::rgba8 c = grad_lut[a];
+                            r = (c.r * a + 255) >> 8;
+                            g = (c.g * a + 255) >> 8;
+                            b = (c.b * a + 255) >> 8;
+                            if (r>a) r=a;
+                            if (g>a) g=a;
+                            if (b>a) b=a;
                         }
-                        else if (a >= 128 && a < 192)
-                        {
-                            r = (a - 128) * 4;
-                            g = 255;
-                        }
-                        else // >= 192
-                        {
-                            r = 255;
-                            g = 255 - ((a - 192) * 4);
-                        }
-                        r = (r * a + 255) >> 8;
-                        g = (g * a + 255) >> 8;
-                        b = (b * a + 255) >> 8;
-        #endif
                     }
                 }
-            }
+            });
         }
     }
 }
@@ -692,47 +676,58 @@ void apply_filter(Src & src, gray const& /*op*/)
     }
 }
 
-template <typename Src, typename Dst>
-void x_gradient_impl(Src const& src_view, Dst const& dst_view)
+// dst = 128 + (previous - next) / 2, one sided at the edges
+inline void gradient_pixel(std::uint8_t const* prev, std::uint8_t const* next, std::uint8_t * dst)
 {
-    for (int y=0; y<src_view.height(); ++y)
-    {
-        typename Src::x_iterator src_it = src_view.row_begin(y);
-        typename Dst::x_iterator dst_it = dst_view.row_begin(y);
-
-        dst_it[0][0] = 128 + (src_it[0][0] - src_it[1][0]) / 2;
-        dst_it[0][1] = 128 + (src_it[0][1] - src_it[1][1]) / 2;
-        dst_it[0][2] = 128 + (src_it[0][2] - src_it[1][2]) / 2;
-
-        dst_it[dst_view.width()-1][0] = 128 + (src_it[src_view.width()-2][0] - src_it[src_view.width()-1][0]) / 2;
-        dst_it[dst_view.width()-1][1] = 128 + (src_it[src_view.width()-2][1] - src_it[src_view.width()-1][1]) / 2;
-        dst_it[dst_view.width()-1][2] = 128 + (src_it[src_view.width()-2][2] - src_it[src_view.width()-1][2]) / 2;
-
-        dst_it[0][3] = dst_it[src_view.width()-1][3] = 255;
-
-        for (int x=1; x<src_view.width()-1; ++x)
-        {
-            dst_it[x][0] = 128 + (src_it[x-1][0] - src_it[x+1][0]) / 2;
-            dst_it[x][1] = 128 + (src_it[x-1][1] - src_it[x+1][1]) / 2;
-            dst_it[x][2] = 128 + (src_it[x-1][2] - src_it[x+1][2]) / 2;
-            dst_it[x][3] = 255;
-        }
-    }
+    dst[0] = 128 + (prev[0] - next[0]) / 2;
+    dst[1] = 128 + (prev[1] - next[1]) / 2;
+    dst[2] = 128 + (prev[2] - next[2]) / 2;
+    dst[3] = 255;
 }
 
 template <typename Src>
 void apply_filter(Src & src, x_gradient const& /*op*/)
 {
+    if (src.width() == 0 || src.height() == 0) return;
     double_buffer<Src> tb(src);
-    x_gradient_impl(tb.src_view, tb.dst_view);
+    unsigned const last = src.width() - 1;
+    util::parallel_rows(src.height(), src.width(), [&](unsigned y0, unsigned y1)
+    {
+        for (unsigned y = y0; y < y1; ++y)
+        {
+            std::uint8_t const* row = tb.src_row(y);
+            std::uint8_t * dst = tb.dst_row(y);
+            for (unsigned x = 0; x <= last; ++x)
+            {
+                unsigned prev = (x == 0 || x == last) ? (x == 0 ? 0 : last - 1) : x - 1;
+                unsigned next = (x == 0 || x == last) ? (x == 0 ? std::min(1u, last) : last) : x + 1;
+                gradient_pixel(row + prev * 4, row + next * 4, dst + x * 4);
+            }
+        }
+    });
 }
 
 template <typename Src>
 void apply_filter(Src & src, y_gradient const& /*op*/)
 {
+    if (src.width() == 0 || src.height() == 0) return;
     double_buffer<Src> tb(src);
-    x_gradient_impl(rotated90ccw_view(tb.src_view),
-                    rotated90ccw_view(tb.dst_view));
+    unsigned const last = src.height() - 1;
+    util::parallel_rows(src.height(), src.width(), [&](unsigned y0, unsigned y1)
+    {
+        for (unsigned y = y0; y < y1; ++y)
+        {
+            unsigned prev = (y == 0 || y == last) ? (y == 0 ? 0 : last - 1) : y - 1;
+            unsigned next = (y == 0 || y == last) ? (y == 0 ? std::min(1u, last) : last) : y + 1;
+            std::uint8_t const* prev_row = tb.src_row(prev);
+            std::uint8_t const* next_row = tb.src_row(next);
+            std::uint8_t * dst = tb.dst_row(y);
+            for (unsigned x = 0; x < src.width(); ++x)
+            {
+                gradient_pixel(prev_row + x * 4, next_row + x * 4, dst + x * 4);
+            }
+        }
+    });
 }
 
 template <typename Src>
@@ -34,6 +34,7 @@
 // stl
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace mapnik
 {
@@ -62,6 +63,25 @@ struct MAPNIK_DECL image_reader : private util::noncopyable
     virtual boost::optional<box2d<double> > bounding_box() const = 0;
     virtual void read(unsigned x,unsigned y,image_rgba8& image) = 0;
     virtual image_any read(unsigned x, unsigned y, unsigned width, unsigned height) = 0;
+    // Reduced resolution versions of the image the format can decode without
+    // going through the full resolution one (e.g. TIFF overviews), largest
+    // first. Levels are numbered from 1; level 0 is the image itself and
+    // reads from a level take coordinates in that level's pixels.
+    virtual unsigned overview_count() const { return 0; }
+    virtual std::pair<unsigned, unsigned> overview_size(unsigned level) const
+    {
+        if (level != 0) throw image_reader_exception("image_reader: no such overview level");
+        return std::make_pair(width(), height());
+    }
+    virtual image_any read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height)
+    {
+        if (level != 0) throw image_reader_exception("image_reader: no such overview level");
+        return read(x, y, width, height);
+    }
+    // True when overviews are not stored in the file but decoded at a reduced
+    // scale (e.g. JPEG DCT scaling): their pixels then differ from those of
+    // resampling the full resolution image.
+    virtual bool scaled_overviews() const { return false; }
     virtual ~image_reader() {}
 };
 
@@ -23,8 +23,13 @@
 #ifndef MAPNIK_IMAGE_SCALING_TRAITS_HPP
 #define MAPNIK_IMAGE_SCALING_TRAITS_HPP
 
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/image.hpp>
+
 // agg
 #include "agg_image_accessors.h"
+#include "agg_image_filters.h"
 #include "agg_pixfmt_rgba.h"
 #include "agg_pixfmt_gray.h"
 #include "agg_span_allocator.h"
@@ -159,6 +164,15 @@ struct agg_scaling_traits<image_gray64f>
     using span_image_resample_affine = agg::span_image_resample_gray_affine<img_src_type>;
 };
 
+// scale_image_agg with the filter given directly, nullptr for nearest neighbour
+template <typename T>
+MAPNIK_DECL void scale_image_agg(T & target, T const& source,
+                                 agg::image_filter_lut const* filter,
+                                 double image_ratio_x,
+                                 double image_ratio_y,
+                                 double x_off_f,
+                                 double y_off_f);
+
 template <typename Filter>
 void set_scaling_method(Filter & filter, scaling_method_e scaling_method, double filter_factor)
 {
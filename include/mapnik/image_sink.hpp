@@ -0,0 +1,109 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_IMAGE_SINK_HPP
+#define MAPNIK_IMAGE_SINK_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstddef>
+#include <string>
+#include <ostream>
+
+namespace mapnik {
+
+// Destination of encoded image bytes. Encoders hand over their output in the
+// chunks they produce it in, so an implementation can gather them (e.g. into
+// an iovec list) or append them to storage it owns, without an intermediate copy.
+class MAPNIK_DECL image_sink
+{
+public:
+    virtual ~image_sink() {}
+    virtual void write(char const* data, std::size_t size) = 0;
+    virtual void flush() {}
+    // hint that about `size` more bytes are about to be written
+    virtual void reserve(std::size_t size) {}
+    // contiguous growable storage behind this sink, if any: writers that need
+    // to seek (tiff) encode straight into it rather than into a temporary
+    virtual std::string * buffer() { return nullptr; }
+    // false once a write has failed, like a std::ostream
+    virtual bool good() const { return true; }
+    explicit operator bool() const { return good(); }
+};
+
+// Appends to a caller owned string, which can be reserved up front and reused
+// across images.
+class MAPNIK_DECL string_sink : public image_sink
+{
+public:
+    explicit string_sink(std::string & buffer)
+        : buffer_(buffer) {}
+
+    void write(char const* data, std::size_t size)
+    {
+        buffer_.append(data, size);
+    }
+
+    void reserve(std::size_t size)
+    {
+        buffer_.reserve(buffer_.size() + size);
+    }
+
+    std::string * buffer()
+    {
+        return &buffer_;
+    }
+
+private:
+    std::string & buffer_;
+};
+
+class MAPNIK_DECL stream_sink : public image_sink
+{
+public:
+    explicit stream_sink(std::ostream & stream)
+        : stream_(stream) {}
+
+    void write(char const* data, std::size_t size)
+    {
+        stream_.write(data, static_cast<std::streamsize>(size));
+    }
+
+    void flush()
+    {
+        stream_.flush();
+    }
+
+    bool good() const
+    {
+        return static_cast<bool>(stream_);
+    }
+
+private:
+    std::ostream & stream_;
+};
+
+} // end ns
+
+#endif // MAPNIK_IMAGE_SINK_HPP
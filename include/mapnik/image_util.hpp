@@ -41,12 +41,14 @@
 
 // stl
 #include <string>
+#include <memory>
 #include <exception>
 
 namespace mapnik {
 
 // fwd declares
 class rgba_palette;
+class image_sink;
 struct image_any;
 template <typename T> class image;
 struct image_view_any;
@@ -116,6 +118,33 @@ MAPNIK_DECL void save_to_stream
     std::string const& type
 );
 
+// encode straight into a sink, e.g. a string_sink appending to a reusable buffer
+template <typename T>
+MAPNIK_DECL void save_to_sink
+(
+    T const& image,
+    image_sink & sink,
+    std::string const& type,
+    rgba_palette const& palette
+);
+
+// `known_solid` tells that the image is a single colour (e.g. agg_renderer::solid()),
+// so solid rgba8 images are served from the cache below without scanning them
+template <typename T>
+MAPNIK_DECL void save_to_sink
+(
+    T const& image,
+    image_sink & sink,
+    std::string const& type,
+    bool known_solid = false
+);
+
+// Encoded bytes of a single colour image (see is_solid and agg_renderer::solid),
+// served from a process wide cache keyed on size, colour and format. save_to_sink
+// and save_to_string take this path on their own for solid rgba8 images.
+MAPNIK_DECL std::shared_ptr<std::string const> save_solid_to_string(image<rgba8_t> const& image,
+                                                                    std::string const& type);
+
 // PREMULTIPLY ALPHA
 MAPNIK_DECL bool premultiply_alpha(image_any & image);
 
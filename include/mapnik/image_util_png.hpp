@@ -23,30 +23,32 @@
 #ifndef MAPNIK_IMAGE_UTIL_PNG_HPP
 #define MAPNIK_IMAGE_UTIL_PNG_HPP
 
+// mapnik
+#include <mapnik/image_sink.hpp>
+
 // stl
 #include <string>
-#include <iostream>
 
 namespace mapnik {
 
 struct png_saver_pal
 {
-    png_saver_pal(std::ostream &, std::string const&, rgba_palette const&);
+    png_saver_pal(image_sink &, std::string const&, rgba_palette const&);
     template <typename T>
     void operator() (T const&) const;
   private:
-    std::ostream & stream_;
+    image_sink & stream_;
     std::string const& t_;
     rgba_palette const& pal_; 
 };
 
 struct png_saver
 {
-    png_saver(std::ostream &, std::string const&);
+    png_saver(image_sink &, std::string const&);
     template <typename T>
     void operator() (T const&) const;
   private:
-    std::ostream & stream_;
+    image_sink & stream_;
     std::string const& t_;
 };
 
@@ -23,19 +23,21 @@
 #ifndef MAPNIK_IMAGE_UTIL_TIFF_HPP
 #define MAPNIK_IMAGE_UTIL_TIFF_HPP
 
+// mapnik
+#include <mapnik/image_sink.hpp>
+
 // stl
 #include <string>
-#include <iostream>
 
 namespace mapnik {
 
 struct tiff_saver
 {
-    tiff_saver(std::ostream &, std::string const&);
+    tiff_saver(image_sink &, std::string const&);
     template <typename T>
     void operator() (T const&) const;
   private:
-    std::ostream & stream_;
+    image_sink & stream_;
     std::string const& t_;
 };
 
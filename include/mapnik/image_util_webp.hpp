@@ -23,19 +23,21 @@
 #ifndef MAPNIK_IMAGE_UTIL_WEBP_HPP
 #define MAPNIK_IMAGE_UTIL_WEBP_HPP
 
+// mapnik
+#include <mapnik/image_sink.hpp>
+
 // stl
 #include <string>
-#include <iostream>
 
 namespace mapnik {
 
 struct webp_saver
 {
-    webp_saver(std::ostream &, std::string const&);
+    webp_saver(image_sink &, std::string const&);
     template <typename T>
     void operator() (T const&) const;
   private:
-    std::ostream & stream_;
+    image_sink & stream_;
     std::string const& t_;
 };
 
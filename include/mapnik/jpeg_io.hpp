@@ -38,25 +38,28 @@ extern "C"
 
 namespace jpeg_detail {
 
-typedef struct
+template <typename T>
+struct dest_mgr
 {
     struct jpeg_destination_mgr pub;
-    std::ostream * out;
+    T * out;
     JOCTET * buffer;
-} dest_mgr;
+};
 
-inline void init_destination( j_compress_ptr cinfo)
+template <typename T>
+void init_destination( j_compress_ptr cinfo)
 {
-    dest_mgr * dest = reinterpret_cast<dest_mgr*>(cinfo->dest);
+    dest_mgr<T> * dest = reinterpret_cast<dest_mgr<T>*>(cinfo->dest);
     dest->buffer = (JOCTET*) (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
                                                          BUFFER_SIZE * sizeof(JOCTET));
     dest->pub.next_output_byte = dest->buffer;
     dest->pub.free_in_buffer = BUFFER_SIZE;
 }
 
-inline boolean empty_output_buffer (j_compress_ptr cinfo)
+template <typename T>
+boolean empty_output_buffer (j_compress_ptr cinfo)
 {
-    dest_mgr * dest = reinterpret_cast<dest_mgr*>(cinfo->dest);
+    dest_mgr<T> * dest = reinterpret_cast<dest_mgr<T>*>(cinfo->dest);
     dest->out->write((char*)dest->buffer, BUFFER_SIZE);
     if (!*(dest->out)) return false;
     dest->pub.next_output_byte = dest->buffer;
@@ -64,9 +67,10 @@ inline boolean empty_output_buffer (j_compress_ptr cinfo)
     return true;
 }
 
-inline void term_destination( j_compress_ptr cinfo)
+template <typename T>
+void term_destination( j_compress_ptr cinfo)
 {
-    dest_mgr * dest = reinterpret_cast<dest_mgr*>(cinfo->dest);
+    dest_mgr<T> * dest = reinterpret_cast<dest_mgr<T>*>(cinfo->dest);
     size_t size  = BUFFER_SIZE - dest->pub.free_in_buffer;
     if (size > 0)
     {
@@ -91,12 +95,13 @@ void save_as_jpeg(T1 & file,int quality, T2 const& image)
     cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_compress(&cinfo);
 
+    using dest_mgr = jpeg_detail::dest_mgr<T1>;
     cinfo.dest = (struct jpeg_destination_mgr *)(*cinfo.mem->alloc_small)
-        ((j_common_ptr) &cinfo, JPOOL_PERMANENT, sizeof(jpeg_detail::dest_mgr));
-    jpeg_detail::dest_mgr * dest = reinterpret_cast<jpeg_detail::dest_mgr*>(cinfo.dest);
-    dest->pub.init_destination = jpeg_detail::init_destination;
-    dest->pub.empty_output_buffer = jpeg_detail::empty_output_buffer;
-    dest->pub.term_destination = jpeg_detail::term_destination;
+        ((j_common_ptr) &cinfo, JPOOL_PERMANENT, sizeof(dest_mgr));
+    dest_mgr * dest = reinterpret_cast<dest_mgr*>(cinfo.dest);
+    dest->pub.init_destination = jpeg_detail::init_destination<T1>;
+    dest->pub.empty_output_buffer = jpeg_detail::empty_output_buffer<T1>;
+    dest->pub.term_destination = jpeg_detail::term_destination<T1>;
     dest->out = &file;
 
     //jpeg_stdio_dest(&cinfo, fp);
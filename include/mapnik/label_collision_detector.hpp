@@ -33,6 +33,10 @@
 
 // stl
 #include <vector>
+#include <istream>
+#include <ostream>
+#include <limits>
+#include <string>
 
 namespace mapnik
 {
@@ -220,6 +224,11 @@ public:
         tree_.insert(label(box, text), box);
     }
 
+    void insert(label const& l)
+    {
+        tree_.insert(l, l.box);
+    }
+
     void clear()
     {
         tree_.clear();
@@ -230,6 +239,75 @@ public:
         return tree_.extent();
     }
 
+    // Returns all placed labels intersecting `region`, e.g. the part of the
+    // buffer which overlaps a neighbouring tile.
+    std::vector<label> labels_in_box(box2d<double> const& region)
+    {
+        std::vector<label> result;
+        tree_t::query_iterator itr = tree_.query_in_box(region);
+        tree_t::query_iterator end = tree_.query_end();
+        for ( ;itr != end; ++itr)
+        {
+            if (itr->box.intersects(region)) result.push_back(*itr);
+        }
+        return result;
+    }
+
+    // Seeds the detector with labels placed by another render. The labels
+    // are translated by (dx, dy) into this detector's pixel space and only
+    // those intersecting its extent are kept.
+    void insert_labels(std::vector<label> const& labels, double dx = 0.0, double dy = 0.0)
+    {
+        for (auto const& l : labels)
+        {
+            box2d<double> box(l.box.minx() + dx, l.box.miny() + dy,
+                              l.box.maxx() + dx, l.box.maxy() + dy);
+            if (box.intersects(extent()))
+            {
+                tree_.insert(label(box, l.text), box);
+            }
+        }
+    }
+
+    // Writes the labels intersecting `region` as text, one label per line:
+    // minx miny maxx maxy <utf8 byte count> <utf8 text>
+    void save_labels(std::ostream & out, box2d<double> const& region)
+    {
+        std::streamsize precision = out.precision(std::numeric_limits<double>::max_digits10);
+        std::string utf8;
+        for (auto const& l : labels_in_box(region))
+        {
+            utf8.clear();
+            l.text.toUTF8String(utf8);
+            out << l.box.minx() << ' ' << l.box.miny() << ' '
+                << l.box.maxx() << ' ' << l.box.maxy() << ' '
+                << utf8.size() << ' ' << utf8 << '\n';
+        }
+        out.precision(precision);
+    }
+
+    // Reads labels written by save_labels and inserts them translated
+    // by (dx, dy). Returns false if the input is malformed.
+    bool load_labels(std::istream & in, double dx = 0.0, double dy = 0.0)
+    {
+        std::vector<label> labels;
+        double minx, miny, maxx, maxy;
+        std::size_t size;
+        while (in >> minx >> miny >> maxx >> maxy >> size)
+        {
+            std::string utf8(size, ' ');
+            if (in.get() != ' ' || !in.read(&utf8[0], size) || in.get() != '\n')
+            {
+                return false;
+            }
+            labels.emplace_back(box2d<double>(minx, miny, maxx, maxy),
+                                mapnik::value_unicode_string::fromUTF8(utf8));
+        }
+        if (!in.eof()) return false;
+        insert_labels(labels, dx, dy);
+        return true;
+    }
+
     query_iterator begin() { return tree_.query_in_box(extent()); }
     query_iterator end() { return tree_.query_end(); }
 };
@@ -86,6 +86,7 @@ private:
     unsigned height_;
     std::string srs_;
     int buffer_size_;
+    bool deferred_labels_;
     boost::optional<color> background_;
     boost::optional<std::string> background_image_;
     composite_mode_e background_image_comp_op_;
@@ -365,6 +366,20 @@ public:
      */
     int buffer_size() const;
 
+    /*! \brief Set deferred label placement
+     *  @param deferred If true text and shield labels from all layers are
+     *  collected and placed by decreasing `priority` after all layers
+     *  have been rendered, instead of in datasource order. A layer with
+     *  clear-label-cache starts a new group of labels, placed after the
+     *  labels of earlier layers on a cleared collision detector.
+     */
+    void set_deferred_labels(bool deferred);
+
+    /*! \brief Get deferred label placement
+     *  @return true if labels are placed in a deferred, priority sorted pass
+     */
+    bool deferred_labels() const;
+
     /*! \brief Set the map maximum extent.
      *  @param box The bounding box for the maximum extent.
      */
@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/palette.hpp>
 #include <mapnik/config.hpp>
+#include <mapnik/image_sink.hpp>
 
 // stl
 #include <vector>
@@ -55,7 +56,7 @@ using mapnik::rgb;
 class MAPNIK_DECL PNGWriter {
 
 public:
-    PNGWriter(int level, int strategy);
+    PNGWriter(int level, int strategy, bool adaptive_filters = false);
     ~PNGWriter();
 private:
     inline void writeUInt32BE(unsigned char *target, unsigned int value);
@@ -71,10 +72,12 @@ public:
     void writeIDATStripAlpha(T const& image);
     void writeIEND();
     void toStream(std::ostream& stream);
+    void toStream(image_sink & sink);
 
 private:
     tdefl_compressor *compressor;
     tdefl_output_buffer *buffer;
+    bool adaptive_filters_;
     static const unsigned char preamble[];
     static const unsigned char IHDR_tpl[];
     static const unsigned char PLTE_tpl[];
@@ -139,21 +139,22 @@ public:
         return offset_;
     }
 
-    void insert(T const& data)
+    // insert `n` pixels of the same color
+    void insert(T const& data, unsigned n = 1)
     {
         unsigned level = 0;
         node * cur_node = root_;
         while (true)
         {
-            cur_node->count_cum++;
-            cur_node->reds   += data.r;
-            cur_node->greens += data.g;
-            cur_node->blues  += data.b;
+            cur_node->count_cum += n;
+            cur_node->reds   += static_cast<std::uint64_t>(data.r) * n;
+            cur_node->greens += static_cast<std::uint64_t>(data.g) * n;
+            cur_node->blues  += static_cast<std::uint64_t>(data.b) * n;
 
             if ( cur_node->count > 0 || level == leaf_level_)
             {
-                cur_node->count  += 1;
-                if (cur_node->count == 1) ++colors_;
+                cur_node->count  += n;
+                if (cur_node->count == n) ++colors_;
                 //if (colors_ >= max_colors_ - 1)
                 //reduce();
                 break;
@@ -40,6 +40,7 @@
 
 // stl
 #include <vector>
+#include <memory>
 
 #define U2RED(x) ((x)&0xff)
 #define U2GREEN(x) (((x)>>8)&0xff)
@@ -107,23 +108,43 @@ class MAPNIK_DECL rgba_palette : private util::noncopyable {
 public:
     enum palette_type { PALETTE_RGBA = 0, PALETTE_RGB = 1, PALETTE_ACT = 2 };
 
+    // Memo of recent lookups for the row API. The palette itself is immutable
+    // after construction and can be shared between threads, a cache can't.
+    class MAPNIK_DECL cache : private util::noncopyable
+    {
+    public:
+        cache();
+    private:
+        friend class rgba_palette;
+        static const unsigned size = 4096;
+        std::unique_ptr<unsigned[]> keys_;
+        std::unique_ptr<unsigned char[]> values_;
+    };
+
     explicit rgba_palette(std::string const& pal, palette_type type = PALETTE_RGBA);
     rgba_palette();
 
     const std::vector<rgb>& palette() const;
     const std::vector<unsigned>& alphaTable() const;
 
+    // Thread safe: exact palette colors are found in a read-only table,
+    // other colors with a search for the closest palette entry.
     unsigned char quantize(unsigned c) const;
+    // Quantizes `size` pixels, reusing results for runs of equal pixels and
+    // for colors memoized in `c`.
+    void quantize(unsigned const* row, unsigned char * out, std::size_t size, cache & c) const;
 
     bool valid() const;
     std::string to_string() const;
 
 private:
     void parse(std::string const& pal, palette_type type);
+    unsigned char closest(unsigned val) const;
 
 private:
     std::vector<rgba> sorted_pal_;
-    mutable rgba_hash_table color_hashmap_;
+    // palette colors only, never modified after parse()
+    rgba_hash_table color_hashmap_;
 
     unsigned colors_;
     std::vector<rgb> rgb_pal_;
@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_PNG_FILTER_HPP
+#define MAPNIK_PNG_FILTER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstddef>
+
+namespace mapnik {
+
+// Filters one scanline of `size` bytes with `bpp` bytes per pixel, choosing the
+// filter (None, Sub, Up, Average or Paeth) with the lowest sum of absolute residuals.
+// `prev` is the unfiltered previous scanline, or nullptr for the first one.
+// Writes the filter type byte followed by `size` filtered bytes to `out`.
+MAPNIK_DECL void png_filter_row(unsigned char const* row,
+                                unsigned char const* prev,
+                                std::size_t size,
+                                unsigned bpp,
+                                unsigned char * out);
+
+}
+
+#endif // MAPNIK_PNG_FILTER_HPP
@@ -28,13 +28,25 @@
 #include <mapnik/octree.hpp>
 #include <mapnik/hextree.hpp>
 #include <mapnik/miniz_png.hpp>
+#include <mapnik/png_filter.hpp>
 #include <mapnik/image.hpp>
+#include <mapnik/util/parallel.hpp>
 
 // zlib
 #include <zlib.h>  // for Z_DEFAULT_COMPRESSION
 
-// boost
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <thread>
+#endif
 
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 extern "C"
 {
@@ -54,6 +66,10 @@ struct png_options {
     bool paletted;
     bool use_hextree;
     bool use_miniz;
+    // choose a filter per scanline of true color images instead of always using none
+    bool adaptive_filters;
+    // number of threads used to deflate true color images (0 = one per core)
+    unsigned threads;
     png_options() :
         colors(256),
         compression(Z_DEFAULT_COMPRESSION),
@@ -62,7 +78,9 @@ struct png_options {
         gamma(-1),
         paletted(true),
         use_hextree(true),
-        use_miniz(false) {}
+        use_miniz(false),
+        adaptive_filters(false),
+        threads(1) {}
 };
 
 template <typename T>
@@ -79,15 +97,213 @@ void flush_data (png_structp png_ptr)
     out->flush();
 }
 
+namespace detail {
+
+// One horizontal band of scanlines, deflated independently of the others
+// into a raw deflate stream ending on a byte boundary (like pigz does).
+struct png_band
+{
+    std::vector<unsigned char> data;
+    uLong adler = 1;
+    uLong length = 0;
+    bool ok = false;
+};
+
+template <typename T>
+void png_pack_row(T const& image, unsigned y, bool strip_alpha, unsigned char * out)
+{
+    unsigned char const* row = reinterpret_cast<unsigned char const*>(image.getRow(y));
+    unsigned width = image.width();
+    if (strip_alpha)
+    {
+        for (unsigned x = 0; x < width; ++x, row += 4)
+        {
+            *out++ = row[0];
+            *out++ = row[1];
+            *out++ = row[2];
+        }
+    }
+    else
+    {
+        std::copy(row, row + width * 4, out);
+    }
+}
+
+template <typename T>
+void png_deflate_band(T const& image, unsigned y0, unsigned y1, bool last,
+                      png_options const& opts, png_band & band)
+{
+    bool strip_alpha = (opts.trans_mode == 0);
+    unsigned bpp = strip_alpha ? 3 : 4;
+    std::size_t row_size = 1 + image.width() * bpp;
+    // the rows preceding the band (up to the 32k window) prime the dictionary,
+    // so splitting costs almost nothing in compression ratio
+    unsigned dict_rows = std::min<std::size_t>(y0, (32768 + row_size - 1) / row_size);
+    std::vector<unsigned char> input(row_size * (y1 - y0 + dict_rows));
+    std::vector<unsigned char> rows(opts.adaptive_filters ? 2 * (row_size - 1) : 0);
+    unsigned char * out = input.data();
+    for (unsigned y = y0 - dict_rows; y < y1; ++y, out += row_size)
+    {
+        if (opts.adaptive_filters)
+        {
+            // filters look at the unfiltered row above, which may belong to the previous band
+            unsigned char * row = rows.data() + (y % 2) * (row_size - 1);
+            unsigned char * prev = rows.data() + ((y + 1) % 2) * (row_size - 1);
+            if (y == y0 - dict_rows && y > 0) png_pack_row(image, y - 1, strip_alpha, prev);
+            png_pack_row(image, y, strip_alpha, row);
+            png_filter_row(row, y > 0 ? prev : nullptr, row_size - 1, bpp, out);
+        }
+        else
+        {
+            *out = 0; // PNG_FILTER_VALUE_NONE
+            png_pack_row(image, y, strip_alpha, out + 1);
+        }
+    }
+    std::size_t dict_size = std::min<std::size_t>(dict_rows * row_size, 32768);
+    unsigned char * in = input.data() + dict_rows * row_size;
+    std::size_t in_size = row_size * (y1 - y0);
+
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    int level = std::min(opts.compression, Z_BEST_COMPRESSION);
+    if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, opts.strategy) != Z_OK) return;
+    if (dict_size > 0)
+    {
+        deflateSetDictionary(&strm, in - dict_size, static_cast<uInt>(dict_size));
+    }
+    band.adler = adler32(adler32(0L, Z_NULL, 0), in, static_cast<uInt>(in_size));
+    band.length = static_cast<uLong>(in_size);
+    band.data.resize(deflateBound(&strm, static_cast<uLong>(in_size)) + 16);
+    strm.next_in = in;
+    strm.avail_in = static_cast<uInt>(in_size);
+    strm.next_out = band.data.data();
+    strm.avail_out = static_cast<uInt>(band.data.size());
+    // all bands but the last end with a sync flush: an empty stored block
+    // that byte-aligns the output so the bands can simply be concatenated
+    int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    int ret;
+    for (;;)
+    {
+        ret = deflate(&strm, flush);
+        if (ret != Z_OK || strm.avail_out != 0) break;
+        std::size_t used = band.data.size();
+        band.data.resize(used * 2);
+        strm.next_out = band.data.data() + used;
+        strm.avail_out = static_cast<uInt>(band.data.size() - used);
+    }
+    band.ok = last ? (ret == Z_STREAM_END) : (ret == Z_OK && strm.avail_in == 0);
+    band.data.resize(strm.total_out);
+    deflateEnd(&strm);
+}
+
+inline void png_put_uint32(unsigned char * out, std::uint32_t val)
+{
+    out[0] = static_cast<unsigned char>(val >> 24);
+    out[1] = static_cast<unsigned char>(val >> 16);
+    out[2] = static_cast<unsigned char>(val >> 8);
+    out[3] = static_cast<unsigned char>(val);
+}
+
+template <typename T>
+void png_write_chunk(T & file, char const* type, unsigned char const* data, std::size_t size)
+{
+    unsigned char buf[8];
+    png_put_uint32(buf, static_cast<std::uint32_t>(size));
+    std::copy(type, type + 4, buf + 4);
+    file.write(reinterpret_cast<char const*>(buf), 8);
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), buf + 4, 4);
+    if (size > 0)
+    {
+        file.write(reinterpret_cast<char const*>(data), size);
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    png_put_uint32(buf, static_cast<std::uint32_t>(crc));
+    file.write(reinterpret_cast<char const*>(buf), 4);
+}
+
+} // namespace detail
+
+// Encodes a true color image with the scanlines split into bands that are filtered and
+// deflated concurrently. The bands form one valid zlib stream, written as one IDAT chunk each.
+template <typename T1, typename T2>
+void save_as_png_parallel(T1 & file,
+                          T2 const& image,
+                          png_options const& opts)
+{
+    unsigned width = image.width();
+    unsigned height = image.height();
+    unsigned threads = opts.threads;
+#ifdef MAPNIK_THREADSAFE
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+#else
+    threads = 1;
+#endif
+    // very small bands would only add sync flush overhead
+    unsigned const min_band_rows = 32;
+    unsigned num_bands = std::max(1u, std::min(threads, height / min_band_rows));
+    std::vector<detail::png_band> bands(num_bands);
+    auto band_start = [&](unsigned i) { return static_cast<unsigned>(std::uint64_t(height) * i / num_bands); };
+    // bands run on the shared band pool, which rethrows a failure of any band here
+    util::parallel_bands(num_bands, num_bands, [&](unsigned begin, unsigned end)
+    {
+        for (unsigned i = begin; i < end; ++i)
+        {
+            detail::png_deflate_band(image, band_start(i), band_start(i + 1), i + 1 == num_bands, opts, bands[i]);
+        }
+    });
+    uLong adler = bands[0].adler;
+    for (unsigned i = 0; i < num_bands; ++i)
+    {
+        if (!bands[i].ok) throw std::runtime_error("png encoder: deflate failed");
+        if (i > 0) adler = adler32_combine(adler, bands[i].adler, bands[i].length);
+    }
+
+    static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    file.write(reinterpret_cast<char const*>(signature), 8);
+    unsigned char ihdr[13];
+    detail::png_put_uint32(ihdr, width);
+    detail::png_put_uint32(ihdr + 4, height);
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = (opts.trans_mode == 0) ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
+    ihdr[10] = PNG_COMPRESSION_TYPE_DEFAULT;
+    ihdr[11] = PNG_FILTER_TYPE_DEFAULT;
+    ihdr[12] = PNG_INTERLACE_NONE;
+    detail::png_write_chunk(file, "IHDR", ihdr, 13);
+
+    // zlib header (32k window, no preset dictionary) in front of the first band
+    // and the adler32 of all uncompressed data behind the last one
+    int level = std::min(opts.compression, Z_BEST_COMPRESSION);
+    unsigned flevel = (level == Z_DEFAULT_COMPRESSION || level == 6) ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : 3));
+    unsigned header = (0x78 << 8) | (flevel << 6);
+    if (header % 31) header += 31 - header % 31;
+    unsigned char zlib_header[2] = { static_cast<unsigned char>(header >> 8), static_cast<unsigned char>(header) };
+    bands.front().data.insert(bands.front().data.begin(), zlib_header, zlib_header + 2);
+    unsigned char trailer[4];
+    detail::png_put_uint32(trailer, static_cast<std::uint32_t>(adler));
+    bands.back().data.insert(bands.back().data.end(), trailer, trailer + 4);
+    for (auto const& band : bands)
+    {
+        detail::png_write_chunk(file, "IDAT", band.data.data(), band.data.size());
+    }
+    detail::png_write_chunk(file, "IEND", nullptr, 0);
+}
+
 template <typename T1, typename T2>
 void save_as_png(T1 & file,
                 T2 const& image,
                 png_options const& opts)
 
 {
+    if (opts.threads != 1)
+    {
+        save_as_png_parallel(file, image, opts);
+        return;
+    }
     if (opts.use_miniz)
     {
-        MiniZ::PNGWriter writer(opts.compression,opts.strategy);
+        MiniZ::PNGWriter writer(opts.compression,opts.strategy,opts.adaptive_filters);
         if (opts.trans_mode == 0)
         {
             writer.writeIHDR(image.width(), image.height(), 24);
@@ -115,7 +331,8 @@ void save_as_png(T1 & file,
     mask = png_get_asm_flagmask(PNG_SELECT_READ | PNG_SELECT_WRITE);
     png_set_asm_flags(png_ptr, flags | mask);
 #endif
-    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+    // libpng applies the same minimum sum of residuals heuristic itself
+    png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, opts.adaptive_filters ? PNG_ALL_FILTERS : PNG_FILTER_NONE);
     png_infop info_ptr = png_create_info_struct(png_ptr);
     if (!info_ptr)
     {
@@ -147,6 +364,28 @@ void save_as_png(T1 & file,
     png_destroy_write_struct(&png_ptr, &info_ptr);
 }
 
+namespace detail {
+
+// Returns the end of the run of pixels equal to row[x]. Map imagery is mostly
+// runs, so the quantizers below handle one run at a time rather than one pixel.
+inline unsigned run_end(image_rgba8::pixel_type const* row, unsigned x, unsigned width)
+{
+    image_rgba8::pixel_type val = row[x++];
+    if (x == width || row[x] != val) return x;
+#ifdef SSE_MATH
+    __m128i v = _mm_set1_epi32(static_cast<int>(val));
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(px, v)) != 0xffff) break;
+    }
+#endif
+    while (x < width && row[x] == val) ++x;
+    return x;
+}
+
+} // namespace detail
+
 template <typename T>
 void reduce_8(T const& in,
               image_gray8 & out,
@@ -168,9 +407,11 @@ void reduce_8(T const& in,
     {
         mapnik::image_rgba8::pixel_type const * row = in.getRow(y);
         mapnik::image_gray8::pixel_type  * row_out = out.getRow(y);
-        for (unsigned x = 0; x < width; ++x)
+        for (unsigned x = 0; x < width;)
         {
             unsigned val = row[x];
+            unsigned end = detail::run_end(row, x, width);
+            unsigned n = end - x;
             byte index = 0;
             int idx = -1;
             for(int j=levels-1; j>0; j--)
@@ -183,10 +424,11 @@ void reduce_8(T const& in,
             }
             if (idx>=0 && idx<(int)alpha.size())
             {
-                alpha[idx]+=U2ALPHA(val);
-                alphaCount[idx]++;
+                alpha[idx]+=U2ALPHA(val) * n;
+                alphaCount[idx] += n;
             }
-            row_out[x] = index;
+            std::fill(row_out + x, row_out + end, index);
+            x = end;
         }
     }
     for(unsigned i=0; i<alpha.size(); i++)
@@ -219,9 +461,10 @@ void reduce_4(T const& in,
     {
         mapnik::image_rgba8::pixel_type const * row = in.getRow(y);
         mapnik::image_gray8::pixel_type  * row_out = out.getRow(y);
-        for (unsigned x = 0; x < width; ++x)
+        for (unsigned x = 0; x < width;)
         {
             unsigned val = row[x];
+            unsigned end = detail::run_end(row, x, width);
             byte index = 0;
             int idx=-1;
             for(int j=levels-1; j>0; j--)
@@ -234,14 +477,13 @@ void reduce_4(T const& in,
             }
             if (idx>=0 && idx<(int)alpha.size())
             {
-                alpha[idx]+=U2ALPHA(val);
-                alphaCount[idx]++;
+                alpha[idx]+=U2ALPHA(val) * (end - x);
+                alphaCount[idx] += end - x;
             }
-            if (x%2 == 0)
+            for (; x < end; ++x)
             {
-                index = index<<4;
+                row_out[x>>1] |= (x%2 == 0) ? (index<<4) : index;
             }
-            row_out[x>>1] |= index;
         }
     }
     for(unsigned i=0; i<alpha.size(); i++)
@@ -504,18 +746,20 @@ void save_as_png8_oct(T1 & file,
     for (unsigned y = 0; y < height; ++y)
     {
         typename T2::pixel_type const * row = image.getRow(y);
-        for (unsigned x = 0; x < width; ++x)
+        for (unsigned x = 0; x < width;)
         {
             unsigned val = row[x];
+            unsigned end = detail::run_end(row, x, width);
             // insert to proper tree based on alpha range
             for(unsigned j=TRANSPARENCY_LEVELS-1; j>0; j--)
             {
                 if (cols[j]>0 && U2ALPHA(val)>=limits[j])
                 {
-                    trees[j].insert(mapnik::rgb(U2RED(val), U2GREEN(val), U2BLUE(val)));
+                    trees[j].insert(mapnik::rgb(U2RED(val), U2GREEN(val), U2BLUE(val)), end - x);
                     break;
                 }
             }
+            x = end;
         }
     }
     unsigned leftovers = 0;
@@ -586,6 +830,40 @@ void save_as_png8_oct(T1 & file,
 }
 
 
+namespace detail {
+
+template <typename T>
+struct row_quantizer
+{
+    explicit row_quantizer(T const& tree)
+        : tree_(tree) {}
+    void operator()(image_rgba8::pixel_type const* row, image_gray8::pixel_type * out, unsigned width)
+    {
+        for (unsigned x = 0; x < width;)
+        {
+            unsigned end = run_end(row, x, width);
+            std::fill(out + x, out + end, static_cast<image_gray8::pixel_type>(tree_.quantize(row[x])));
+            x = end;
+        }
+    }
+    T const& tree_;
+};
+
+template <>
+struct row_quantizer<rgba_palette>
+{
+    explicit row_quantizer(rgba_palette const& pal)
+        : pal_(pal), cache_() {}
+    void operator()(image_rgba8::pixel_type const* row, image_gray8::pixel_type * out, unsigned width)
+    {
+        pal_.quantize(row, out, width, cache_);
+    }
+    rgba_palette const& pal_;
+    rgba_palette::cache cache_;
+};
+
+} // namespace detail
+
 template <typename T1, typename T2, typename T3>
 void save_as_png8(T1 & file,
                   T2 const& image,
@@ -596,6 +874,7 @@ void save_as_png8(T1 & file,
 {
     unsigned width = image.width();
     unsigned height = image.height();
+    detail::row_quantizer<T3> quantize_row(tree);
 
     if (palette.size() > 16 )
     {
@@ -603,12 +882,7 @@ void save_as_png8(T1 & file,
         image_gray8 reduced_image(width, height);
         for (unsigned y = 0; y < height; ++y)
         {
-            mapnik::image_rgba8::pixel_type const * row = image.getRow(y);
-            mapnik::image_gray8::pixel_type  * row_out = reduced_image.getRow(y);
-            for (unsigned x = 0; x < width; ++x)
-            {
-                row_out[x] = tree.quantize(row[x]);
-            }
+            quantize_row(image.getRow(y), reduced_image.getRow(y), width);
         }
         save_as_png(file, palette, reduced_image, width, height, 8, alphaTable, opts);
     }
@@ -627,15 +901,15 @@ void save_as_png8(T1 & file,
         unsigned image_width  = ((width + 7) >> 1) & ~3U; // 4-bit image, round up to 32-bit boundary
         unsigned image_height = height;
         image_gray8 reduced_image(image_width, image_height);
+        std::vector<image_gray8::pixel_type> indexes(width);
         for (unsigned y = 0; y < height; ++y)
         {
-            mapnik::image_rgba8::pixel_type const * row = image.getRow(y);
             mapnik::image_gray8::pixel_type  * row_out = reduced_image.getRow(y);
+            quantize_row(image.getRow(y), indexes.data(), width);
             byte index = 0;
             for (unsigned x = 0; x < width; ++x)
             {
-
-                index = tree.quantize(row[x]);
+                index = indexes[x];
                 if (x%2 == 0)
                 {
                     index = index<<4;
@@ -670,10 +944,12 @@ void save_as_png8_hex(T1 & file,
         for (unsigned y = 0; y < height; ++y)
         {
             typename T2::pixel_type const * row = image.getRow(y);
-            for (unsigned x = 0; x < width; ++x)
+            for (unsigned x = 0; x < width;)
             {
                 unsigned val = row[x];
-                tree.insert(mapnik::rgba(U2RED(val), U2GREEN(val), U2BLUE(val), U2ALPHA(val)));
+                unsigned end = detail::run_end(row, x, width);
+                tree.insert(mapnik::rgba(U2RED(val), U2GREEN(val), U2BLUE(val), U2ALPHA(val)), end - x);
+                x = end;
             }
         }
 
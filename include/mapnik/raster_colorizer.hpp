@@ -216,6 +216,12 @@ public:
     inline float get_epsilon() const { return epsilon_; }
 
 private:
+    //! \brief Index of the stop the value is in, -1 before the first stop
+    int find_stop(float value) const;
+
+    //! \brief Colour of a value in the given stop (see find_stop)
+    unsigned color_for_stop(float value, int stopIdx) const;
+
     colorizer_stops stops_;         //!< The vector of stops
 
     colorizer_mode default_mode_;   //!< The default mode inherited by stops
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_RENDERER_COMMON_DEFERRED_LABELS_HPP
+#define MAPNIK_RENDERER_COMMON_DEFERRED_LABELS_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// agg
+#include "agg_trans_affine.h"
+
+// stl
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace mapnik {
+
+// Text and shield label candidates collected during the style pass when
+// Map::deferred_labels() is set. Features are shared with the featuresets
+// and projections are copied so the candidates outlive the layers they came
+// from; symbolizers are referenced since they are owned by the Map being
+// rendered. A layer with clear-label-cache starts a new group: groups are
+// placed in order, each by decreasing priority on a cleared detector.
+class deferred_labels : private util::noncopyable
+{
+    struct layer_projection
+    {
+        layer_projection(projection const& source, projection const& dest)
+            : source_(source),
+              dest_(dest),
+              prj_trans_(source_, dest_) {}
+
+        projection source_;
+        projection dest_;
+        proj_transform prj_trans_;
+    };
+
+public:
+    struct candidate
+    {
+        unsigned group;
+        double priority;
+        text_symbolizer const* text_sym;
+        shield_symbolizer const* shield_sym;
+        feature_ptr feature;
+        std::shared_ptr<proj_transform const> prj_trans;
+        box2d<double> clip_box;
+        agg::trans_affine tr;
+    };
+
+    // the feature must be owned by a feature_ptr, as featuresets return them
+    void add(text_symbolizer const& sym, double priority, feature_impl & feature,
+             proj_transform const& prj_trans, box2d<double> const& clip_box,
+             agg::trans_affine const& tr)
+    {
+        candidates_.push_back(candidate{group_, priority, &sym, nullptr, feature.shared_from_this(),
+                                        get_prj_trans(prj_trans), clip_box, tr});
+    }
+
+    void add(shield_symbolizer const& sym, double priority, feature_impl & feature,
+             proj_transform const& prj_trans, box2d<double> const& clip_box,
+             agg::trans_affine const& tr)
+    {
+        candidates_.push_back(candidate{group_, priority, nullptr, &sym, feature.shared_from_this(),
+                                        get_prj_trans(prj_trans), clip_box, tr});
+    }
+
+    // projections can only change between layers
+    void start_layer(bool clear_label_cache)
+    {
+        layer_projection_.reset();
+        if (clear_label_cache && !candidates_.empty())
+        {
+            group_ = candidates_.back().group + 1;
+        }
+    }
+
+    // Candidates ordered by group, then by decreasing priority, equal
+    // priorities keep the order in which they were collected.
+    std::vector<candidate> const& sorted()
+    {
+        std::stable_sort(candidates_.begin(), candidates_.end(),
+                         [](candidate const& a, candidate const& b)
+                         {
+                             return a.group != b.group ? a.group < b.group : a.priority > b.priority;
+                         });
+        return candidates_;
+    }
+
+    bool empty() const
+    {
+        return candidates_.empty();
+    }
+
+    void clear()
+    {
+        candidates_.clear();
+        layer_projection_.reset();
+        group_ = 0;
+    }
+
+private:
+    std::shared_ptr<proj_transform const> get_prj_trans(proj_transform const& prj_trans)
+    {
+        if (!layer_projection_)
+        {
+            layer_projection_ = std::make_shared<layer_projection>(prj_trans.source(), prj_trans.dest());
+        }
+        return std::shared_ptr<proj_transform const>(layer_projection_, &layer_projection_->prj_trans_);
+    }
+
+
+    std::shared_ptr<layer_projection> layer_projection_;
+    std::vector<candidate> candidates_;
+    unsigned group_ = 0;
+};
+
+} // namespace mapnik
+
+#endif // MAPNIK_RENDERER_COMMON_DEFERRED_LABELS_HPP
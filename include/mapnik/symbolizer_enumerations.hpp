@@ -62,6 +62,7 @@ enum halo_rasterizer_enum : std::uint8_t
 {
     HALO_RASTERIZER_FULL,
     HALO_RASTERIZER_FAST,
+    HALO_RASTERIZER_DILATE,
     halo_rasterizer_enum_MAX
 };
 
@@ -92,6 +92,7 @@ enum class keys : std::uint8_t
     direction,
     avoid_edges,
     ff_settings,
+    priority,
     MAX_SYMBOLIZER_KEY
 };
 
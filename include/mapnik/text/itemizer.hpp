@@ -83,6 +83,11 @@ public:
     // Only forced line breaks with \n characters are handled here.
     std::pair<unsigned, unsigned> line(unsigned i) const;
     unsigned num_lines() const;
+    // Calls f(start, end, format) for each format run, in char index order.
+    template <typename F> void for_each_format_run(F && f) const
+    {
+        for (auto const& r : format_runs_) f(r.start, r.end, r.data);
+    }
 private:
     template<typename T> struct run : util::noncopyable
     {
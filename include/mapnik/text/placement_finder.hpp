@@ -58,6 +58,9 @@ public:
     // Iterate over the given path, placing line-following labels or point labels with respect to label_spacing.
     template <typename T>
     bool find_line_placements(T & path, bool points);
+    // Same as above for an already cached path. The cache is rewound first, so it can be
+    // reused (including its offset lines) by all placement attempts of a feature.
+    bool find_line_placements(vertex_cache & pp, bool points);
     // Try next position alternative from placement_info.
     bool next_position();
 
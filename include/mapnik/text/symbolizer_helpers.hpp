@@ -25,6 +25,11 @@
 //mapnik
 #include <mapnik/text/placement_finder.hpp>
 #include <mapnik/vertex_converters.hpp>
+#include <mapnik/vertex_cache.hpp>
+#include <mapnik/make_unique.hpp>
+
+// stl
+#include <map>
 
 namespace mapnik {
 
@@ -41,18 +46,24 @@ struct placement_finder_adapter
         : finder_(finder),
           points_on_line_(points_on_line) {}
 
+    // Keep the converted path, it is reused by all placement attempts of the feature.
     template <typename PathT>
     void add_path(PathT & path)
     {
-        status_ = finder_.find_line_placements(path, points_on_line_);
+        path_ = std::make_unique<vertex_cache>(path);
+    }
+
+    bool find_line_placements(vertex_cache & path) const
+    {
+        return finder_.find_line_placements(path, points_on_line_);
     }
 
-    bool status() const { return status_;}
+    vertex_cache_ptr release_path() { return std::move(path_); }
+
     // Place text at points on a line instead of following the line (used for ShieldSymbolizer)
     placement_finder_type & finder_;
     bool points_on_line_;
-    mutable bool status_ = false;
-
+    vertex_cache_ptr path_;
 };
 
 using vertex_converter_type = vertex_converter<placement_finder_adapter<placement_finder>,clip_line_tag , transform_tag, affine_transform_tag, simplify_tag, smooth_tag>;
@@ -142,8 +153,10 @@ protected:
 
     mutable placement_finder finder_;
 
-    placement_finder_adapter<placement_finder> adapter_;
+    mutable placement_finder_adapter<placement_finder> adapter_;
     mutable vertex_converter_type converter_;
+    // Converted geometries, shared by all placement attempts (null if nothing was left to place on).
+    mutable std::map<geometry_type const*, vertex_cache_ptr> paths_;
     //ShieldSymbolizer only
     void init_marker() const;
 };
@@ -41,6 +41,7 @@
 #include <memory>
 #include <map>
 #include <utility>
+#include <string>
 
 namespace mapnik
 {
@@ -84,6 +85,10 @@ public:
     // Clear all data stored in this object. The object's state is the same as directly after construction.
     void clear();
 
+    // Builds a key from the text, the evaluated formats and layout properties, i.e. everything
+    // layout() and rendering depend on. Returns false if the layout can't be shared (child layouts).
+    bool cache_key(std::string & key) const;
+
     // Height of all lines together (in pixels).
     inline double height() const { return height_; }
     // Width of the longest line (in pixels).
@@ -146,6 +151,7 @@ private:
     double width_;
     double height_;
     unsigned glyphs_count_;
+    bool laid_out_ = false;
 
     // output
     line_vector lines_;
@@ -37,6 +37,8 @@ extern "C"
 
 //std
 #include <memory>
+#include <string>
+#include <cstring>
 
 #define TIFF_WRITE_SCANLINE 0
 #define TIFF_WRITE_STRIPPED 1
@@ -161,6 +163,101 @@ static inline int tiff_dummy_map_proc(thandle_t , tdata_t*, toff_t* )
     return 0;
 }
 
+// Seekable output appending to a string. libtiff offsets are relative to the
+// end of whatever the string held before, so tiffs can be encoded in place
+// into a caller's buffer.
+struct tiff_memory_stream
+{
+    explicit tiff_memory_stream(std::string & data_)
+        : data(data_),
+          base(data_.size()),
+          pos(0) {}
+
+    std::string & data;
+    std::size_t base;
+    std::size_t pos;
+};
+
+static inline tsize_t tiff_memory_write_proc(thandle_t fd, tdata_t buf, tsize_t size)
+{
+    tiff_memory_stream * out = reinterpret_cast<tiff_memory_stream*>(fd);
+    if (size < 0) return static_cast<tsize_t>(-1);
+    std::size_t offset = out->base + out->pos;
+    if (offset + size > out->data.size())
+    {
+        out->data.resize(offset + size);
+    }
+    std::memcpy(&out->data[offset], buf, size);
+    out->pos += size;
+    return size;
+}
+
+static inline toff_t tiff_memory_seek_proc(thandle_t fd, toff_t off, int whence)
+{
+    tiff_memory_stream * out = reinterpret_cast<tiff_memory_stream*>(fd);
+    std::size_t size = out->data.size() - out->base;
+    std::size_t pos = out->pos;
+    switch(whence)
+    {
+    case SEEK_SET:
+        pos = off;
+        break;
+    case SEEK_CUR:
+        pos += off;
+        break;
+    case SEEK_END:
+        pos = size + off;
+        break;
+    }
+    // seeking beyond the end extends the output with zeros (re: libtiff/tif_stream.cxx)
+    if (pos > size)
+    {
+        out->data.resize(out->base + pos);
+    }
+    out->pos = pos;
+    return static_cast<toff_t>(pos);
+}
+
+static inline int tiff_memory_close_proc(thandle_t)
+{
+    return 0;
+}
+
+static inline toff_t tiff_memory_size_proc(thandle_t fd)
+{
+    tiff_memory_stream * out = reinterpret_cast<tiff_memory_stream*>(fd);
+    return static_cast<toff_t>(out->data.size() - out->base);
+}
+
+template <typename T>
+TIFF* tiff_open_writer(T & file)
+{
+    return RealTIFFOpen("mapnik_tiff_stream",
+                        "wm",
+                        (thandle_t)&file,
+                        tiff_dummy_read_proc,
+                        tiff_write_proc,
+                        tiff_seek_proc,
+                        tiff_close_proc,
+                        tiff_size_proc,
+                        tiff_dummy_map_proc,
+                        tiff_dummy_unmap_proc);
+}
+
+inline TIFF* tiff_open_writer(tiff_memory_stream & file)
+{
+    return RealTIFFOpen("mapnik_tiff_stream",
+                        "wm",
+                        (thandle_t)&file,
+                        tiff_dummy_read_proc,
+                        tiff_memory_write_proc,
+                        tiff_memory_seek_proc,
+                        tiff_memory_close_proc,
+                        tiff_memory_size_proc,
+                        tiff_dummy_map_proc,
+                        tiff_dummy_unmap_proc);
+}
+
 struct tiff_config
 {
     tiff_config()
@@ -394,16 +491,7 @@ void save_as_tiff(T1 & file, T2 const& image, tiff_config const& config)
     const int width = image.width();
     const int height = image.height();
 
-    TIFF* output = RealTIFFOpen("mapnik_tiff_stream",
-                                "wm",
-                                (thandle_t)&file,
-                                tiff_dummy_read_proc,
-                                tiff_write_proc,
-                                tiff_seek_proc,
-                                tiff_close_proc,
-                                tiff_size_proc,
-                                tiff_dummy_map_proc,
-                                tiff_dummy_unmap_proc);
+    TIFF* output = tiff_open_writer(file);
     if (! output)
     {
         throw ImageWriterException("Could not write TIFF");
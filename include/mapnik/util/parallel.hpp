@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_UTIL_PARALLEL_HPP
+#define MAPNIK_UTIL_PARALLEL_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <algorithm>
+#include <cstddef>
+
+namespace mapnik { namespace util {
+
+// Upper bound on the threads parallel_rows splits one image operation across,
+// the calling thread included. Defaults to 1 (no parallelism): servers
+// already running one render per core should leave it there, others can
+// raise it to the number of cores. Extra threads come from one process wide
+// pool, so the total stays bounded however many renders call in at once.
+MAPNIK_DECL unsigned band_threads();
+MAPNIK_DECL void set_band_threads(unsigned threads);
+
+// Pixels a band must hold before it is worth a thread of its own
+static const std::size_t min_band_pixels = 65536;
+
+namespace detail {
+
+using band_func = void (*)(void const* func, unsigned begin, unsigned end);
+
+template <typename F>
+void call_band(void const* func, unsigned begin, unsigned end)
+{
+    (*static_cast<F const*>(func))(begin, end);
+}
+
+// Runs `bands` bands of [0, rows) on the calling thread and idle pool
+// threads, returning once all have finished. The first exception thrown by
+// a band is rethrown here.
+MAPNIK_DECL void run_bands(unsigned rows, unsigned bands, band_func call, void const* func);
+
+}
+
+// Calls func(begin, end) on `bands` consecutive bands covering [0, rows),
+// concurrently when bands > 1. The first exception thrown by a band is
+// rethrown once all bands have finished.
+template <typename F>
+void parallel_bands(unsigned rows, unsigned bands, F const& func)
+{
+#ifdef MAPNIK_THREADSAFE
+    if (bands > 1)
+    {
+        detail::run_bands(rows, bands, &detail::call_band<F>, &func);
+        return;
+    }
+#endif
+    func(0, rows);
+}
+
+// Calls func(begin, end) on consecutive bands covering [0, rows). Bands run
+// concurrently when the image is large enough and band_threads() > 1;
+// func must only write rows of its own band.
+template <typename F>
+void parallel_rows(unsigned rows, std::size_t row_pixels, F const& func)
+{
+    std::size_t pixels = static_cast<std::size_t>(rows) * row_pixels;
+    unsigned bands = static_cast<unsigned>(std::min<std::size_t>(band_threads(), pixels / min_band_pixels));
+    parallel_bands(rows, bands, func);
+}
+
+}}
+
+#endif // MAPNIK_UTIL_PARALLEL_HPP
@@ -35,6 +35,7 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <utility>
 
 namespace mapnik
 {
@@ -108,7 +109,9 @@ public:
     double linear_position() const { return position_; }
 
 
-    // Returns a parallel line in the specified distance.
+    // Returns a parallel line of the current subpath in the specified distance,
+    // positioned next to the current position. Offset lines are memoized, so
+    // they are only computed once for all placement attempts on this path.
     vertex_cache & get_offseted(double offset, double region_width);
 
 
@@ -140,6 +143,7 @@ public:
     double position_closest_to(pixel_position const &target_pos);
 
 private:
+    class subpath_adapter;
     void rewind_subpath();
     bool next_segment();
     bool previous_segment();
@@ -170,8 +174,8 @@ private:
     // Is the value in angle_ valid?
     // Used to avoid unnecessary calculations.
     mutable bool angle_valid_;
-    using offseted_lines_map = std::map<double, vertex_cache_ptr>;
-    // Cache of all offseted lines already computed.
+    using offseted_lines_map = std::map<std::pair<std::size_t, double>, vertex_cache_ptr>;
+    // Cache of all offseted lines already computed, keyed by subpath index and offset.
     offseted_lines_map offseted_lines_;
     // Linear position, i.e distance from start of line.
     double position_;
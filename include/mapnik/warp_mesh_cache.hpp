@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_WARP_MESH_CACHE_HPP
+#define MAPNIK_WARP_MESH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace mapnik
+{
+
+// Source pixel corners of the mesh cells, reprojected into the target srs
+struct warp_mesh
+{
+    warp_mesh(std::size_t nx, std::size_t ny)
+        : xs(nx, ny, false),
+          ys(nx, ny, false) {}
+    image_gray64f xs;
+    image_gray64f ys;
+};
+
+using warp_mesh_ptr = std::shared_ptr<warp_mesh const>;
+
+// A mesh only depends on the source window and the projections, so rasters
+// warped again (other styles, overlapping metatiles, untiled sources) reuse
+// it instead of reprojecting every vertex. Least recently used meshes are
+// dropped past max_bytes.
+class MAPNIK_DECL warp_mesh_cache :
+        public singleton<warp_mesh_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<warp_mesh_cache>;
+public:
+    struct key_type
+    {
+        std::string source_srs;
+        std::string dest_srs;
+        box2d<double> source_ext;
+        std::size_t width;
+        std::size_t height;
+        unsigned mesh_size;
+        bool operator==(key_type const& rhs) const
+        {
+            return width == rhs.width && height == rhs.height && mesh_size == rhs.mesh_size &&
+                source_ext == rhs.source_ext &&
+                source_srs == rhs.source_srs && dest_srs == rhs.dest_srs;
+        }
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(key_type const& key) const;
+    };
+
+    warp_mesh_ptr find(key_type const& key);
+    void insert(key_type const& key, warp_mesh_ptr const& mesh);
+
+    // Sets the budget of the meshes (16MB by default)
+    void set_max_bytes(std::size_t bytes);
+    std::size_t max_bytes() const;
+    std::size_t bytes() const;
+    std::size_t size() const;
+    void clear();
+
+private:
+    warp_mesh_cache();
+    void evict();
+
+    using mesh_list = std::list<std::pair<key_type, warp_mesh_ptr> >;
+    mesh_list meshes_; // most recently used first
+    std::unordered_map<key_type, mesh_list::iterator, key_hash> index_;
+    std::size_t bytes_;
+    std::size_t max_bytes_;
+};
+
+}
+
+#endif // MAPNIK_WARP_MESH_CACHE_HPP
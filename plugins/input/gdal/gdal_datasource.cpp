@@ -29,9 +29,18 @@
 #include <mapnik/geom_util.hpp>
 #include <mapnik/timer.hpp>
 #include <mapnik/value_types.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/utils.hpp>
+#endif
 
 #include <gdal_version.h>
 
+// stl
+#include <algorithm>
+#ifdef MAPNIK_THREADSAFE
+#include <map>
+#endif
+
 using mapnik::datasource;
 using mapnik::parameters;
 
@@ -45,9 +54,71 @@ using mapnik::layer_descriptor;
 using mapnik::datasource_exception;
 
 
+#ifdef MAPNIK_THREADSAFE
+// One lock per GDALDataset, whichever datasources read through it. Entries
+// are dropped once the last handle holding their lock is closed.
+class gdal_dataset_locks :
+        public mapnik::singleton<gdal_dataset_locks, mapnik::CreateStatic>,
+        private mapnik::util::noncopyable
+{
+    friend class mapnik::CreateStatic<gdal_dataset_locks>;
+public:
+    std::shared_ptr<std::mutex> get(GDALDataset * dataset)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto itr = locks_.begin(); itr != locks_.end();)
+        {
+            if (itr->second.expired()) itr = locks_.erase(itr);
+            else ++itr;
+        }
+        std::weak_ptr<std::mutex> & entry = locks_[dataset];
+        std::shared_ptr<std::mutex> result = entry.lock();
+        if (!result)
+        {
+            result = std::make_shared<std::mutex>();
+            entry = result;
+        }
+        return result;
+    }
+private:
+    gdal_dataset_locks() {}
+    std::mutex mutex_;
+    std::map<GDALDataset *, std::weak_ptr<std::mutex> > locks_;
+};
+#endif
+
+gdal_dataset::gdal_dataset(std::string const& name, bool shared)
+    : dataset_(nullptr)
+{
+#if GDAL_VERSION_NUM >= 1600
+    if (shared)
+    {
+        dataset_ = reinterpret_cast<GDALDataset*>(GDALOpenShared(name.c_str(), GA_ReadOnly));
+    }
+    else
+#endif
+    {
+        dataset_ = reinterpret_cast<GDALDataset*>(GDALOpen(name.c_str(), GA_ReadOnly));
+    }
+#ifdef MAPNIK_THREADSAFE
+    mutex_ = shared ? gdal_dataset_locks::instance().get(dataset_) : std::make_shared<std::mutex>();
+#endif
+    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: opened Dataset=" << dataset_;
+}
+
+gdal_dataset::~gdal_dataset()
+{
+    if (dataset_)
+    {
+        MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Closing Dataset=" << dataset_;
+        GDALClose(dataset_);
+    }
+}
+
 gdal_datasource::gdal_datasource(parameters const& params)
     : datasource(params),
-      dataset_(nullptr),
+      pool_(),
+      shared_handle_(),
       desc_(gdal_datasource::name(), "utf-8"),
       nodata_value_(params.get<double>("nodata")),
       nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12))
@@ -76,27 +147,32 @@ gdal_datasource::gdal_datasource(parameters const& params)
     shared_dataset_ = *params.get<mapnik::boolean_type>("shared", false);
     band_ = *params.get<mapnik::value_integer>("band", -1);
 
-#if GDAL_VERSION_NUM >= 1600
     if (shared_dataset_)
     {
-        dataset_ = reinterpret_cast<GDALDataset*>(GDALOpenShared((dataset_name_).c_str(), GA_ReadOnly));
+        // every featureset reads through this one handle
+        shared_handle_ = std::make_shared<gdal_dataset>(dataset_name_, true);
+        if (!shared_handle_->isOK())
+        {
+            throw datasource_exception(CPLGetLastErrorMsg());
+        }
     }
     else
-#endif
-    {
-        dataset_ = reinterpret_cast<GDALDataset*>(GDALOpen((dataset_name_).c_str(), GA_ReadOnly));
-    }
-
-    if (! dataset_)
     {
-        throw datasource_exception(CPLGetLastErrorMsg());
+        unsigned max_size = *params.get<mapnik::value_integer>("max_size", 10);
+        pool_.reset(new gdal_dataset_pool(gdal_dataset_creator<gdal_dataset>(dataset_name_, false),
+                                          1, std::max(1u, max_size)));
+        // the pool opens its first handle up front, so a bad path fails here
+        if (pool_->size() == 0)
+        {
+            throw datasource_exception(CPLGetLastErrorMsg());
+        }
     }
+    gdal_dataset_ptr dataset = borrow_dataset();
+    GDALDataset & ds = dataset->get();
 
-    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: opened Dataset=" << dataset_;
-
-    nbands_ = dataset_->GetRasterCount();
-    width_ = dataset_->GetRasterXSize();
-    height_ = dataset_->GetRasterYSize();
+    nbands_ = ds.GetRasterCount();
+    width_ = ds.GetRasterXSize();
+    height_ = ds.GetRasterYSize();
     desc_.add_descriptor(mapnik::attribute_descriptor("nodata", mapnik::Double));
 
     double tr[6];
@@ -128,7 +204,7 @@ gdal_datasource::gdal_datasource(parameters const& params)
     }
     else
     {
-        if (dataset_->GetGeoTransform(tr) != CPLE_None)
+        if (ds.GetGeoTransform(tr) != CPLE_None)
         {
             MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource GetGeotransform failure gives="
                                    << tr[0] << "," << tr[1] << ","
@@ -180,10 +256,25 @@ gdal_datasource::gdal_datasource(parameters const& params)
 
 }
 
-gdal_datasource::~gdal_datasource()
+gdal_datasource::~gdal_datasource() {}
+
+gdal_dataset_ptr gdal_datasource::borrow_dataset() const
 {
-    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Closing Dataset=" << dataset_;
-    GDALClose(dataset_);
+    if (shared_handle_)
+    {
+        return shared_handle_;
+    }
+    gdal_dataset_ptr dataset = pool_->borrowObject();
+    if (!dataset)
+    {
+        // every pooled handle is busy: open one closed along with its featureset
+        dataset = std::make_shared<gdal_dataset>(dataset_name_, false);
+        if (!dataset->isOK())
+        {
+            throw datasource_exception(CPLGetLastErrorMsg());
+        }
+    }
+    return dataset;
 }
 
 datasource::datasource_t gdal_datasource::type() const
@@ -220,7 +311,7 @@ featureset_ptr gdal_datasource::features(query const& q) const
     gdal_query gq = q;
 
     // TODO - move to std::make_shared, but must reduce # of args to <= 9
-    return featureset_ptr(new gdal_featureset(*dataset_,
+    return featureset_ptr(new gdal_featureset(borrow_dataset(),
                                               band_,
                                               gq,
                                               extent_,
@@ -242,7 +333,7 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol)
     gdal_query gq = pt;
 
     // TODO - move to std::make_shared, but must reduce # of args to <= 9
-    return featureset_ptr(new gdal_featureset(*dataset_,
+    return featureset_ptr(new gdal_featureset(borrow_dataset(),
                                               band_,
                                               gq,
                                               extent_,
@@ -31,17 +31,65 @@
 #include <mapnik/box2d.hpp>
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/pool.hpp>
+#include <mapnik/util/noncopyable.hpp>
 
 // boost
 #include <boost/optional.hpp>
 
 // stl
+#include <memory>
 #include <vector>
 #include <string>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
 
 // gdal
 #include <gdal_priv.h>
 
+// An open GDAL dataset. Handles must not be used by two threads at once, so
+// each featureset borrows one of its own from the datasource's pool, or with
+// shared=true they all read through a single handle one at a time. GDAL
+// hands the same shared handle to every datasource opening the file, so its
+// lock is looked up by GDALDataset in a process-wide table.
+class gdal_dataset : private mapnik::util::noncopyable
+{
+public:
+    gdal_dataset(std::string const& name, bool shared);
+    ~gdal_dataset();
+    bool isOK() const { return dataset_ != nullptr; }
+    GDALDataset & get() const { return *dataset_; }
+#ifdef MAPNIK_THREADSAFE
+    std::mutex & mutex() const { return *mutex_; }
+#endif
+private:
+    GDALDataset * dataset_;
+#ifdef MAPNIK_THREADSAFE
+    std::shared_ptr<std::mutex> mutex_;
+#endif
+};
+
+template <typename T>
+class gdal_dataset_creator
+{
+public:
+    gdal_dataset_creator(std::string const& name, bool shared)
+        : name_(name),
+          shared_(shared) {}
+
+    T* operator()() const
+    {
+        return new T(name_, shared_);
+    }
+private:
+    std::string name_;
+    bool shared_;
+};
+
+using gdal_dataset_ptr = std::shared_ptr<gdal_dataset>;
+using gdal_dataset_pool = mapnik::Pool<gdal_dataset, gdal_dataset_creator>;
+
 class gdal_datasource : public mapnik::datasource
 {
 public:
@@ -55,8 +103,9 @@ public:
     boost::optional<mapnik::datasource::geometry_t> get_geometry_type() const;
     mapnik::layer_descriptor get_descriptor() const;
 private:
-    GDALDataset* open_dataset() const;
-    GDALDataset* dataset_;
+    gdal_dataset_ptr borrow_dataset() const;
+    std::unique_ptr<gdal_dataset_pool> pool_;
+    gdal_dataset_ptr shared_handle_;
     mapnik::box2d<double> extent_;
     std::string dataset_name_;
     int band_;
@@ -30,8 +30,12 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_factory.hpp>
 #include <mapnik/util/variant.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <mapnik/unique_lock.hpp>
+#endif
 
 // stl
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <sstream>
@@ -48,7 +52,7 @@ using mapnik::geometry_type;
 using mapnik::datasource_exception;
 using mapnik::feature_factory;
 
-gdal_featureset::gdal_featureset(GDALDataset& dataset,
+gdal_featureset::gdal_featureset(gdal_dataset_ptr const& dataset,
                                  int band,
                                  gdal_query q,
                                  mapnik::box2d<double> extent,
@@ -59,7 +63,8 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  double dy,
                                  boost::optional<double> const& nodata,
                                  double nodata_tolerance)
-    : dataset_(dataset),
+    : handle_(dataset),
+      dataset_(dataset->get()),
       ctx_(std::make_shared<mapnik::context_type>()),
       band_(band),
       gquery_(q),
@@ -88,6 +93,10 @@ feature_ptr gdal_featureset::next()
     {
         first_ = false;
         MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Next feature in Dataset=" << &dataset_;
+#ifdef MAPNIK_THREADSAFE
+        // the handle is shared with other featuresets when shared=true
+        mapnik::scoped_lock lock(handle_->mutex());
+#endif
         return mapnik::util::apply_visitor(query_dispatch(*this), gquery_);
     }
     return feature_ptr();
@@ -188,6 +197,33 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
         im_width = int(im_width * filter_factor + 0.5);
         im_height = int(im_height * filter_factor + 0.5);
 
+        // read from the smallest overview still holding the output
+        // resolution, the window widened to whole overview pixels
+        int overview = select_overview(width, height, im_width, im_height);
+        if (overview >= 0)
+        {
+            GDALRasterBand * overview_band = dataset_.GetRasterBand(band_ > 0 ? band_ : 1)->GetOverview(overview);
+            double scale_x = overview_band->GetXSize() / double(raster_width_);
+            double scale_y = overview_band->GetYSize() / double(raster_height_);
+            int ov_x0 = int(std::floor(x_off * scale_x));
+            int ov_y0 = int(std::floor(y_off * scale_y));
+            int ov_x1 = std::min(overview_band->GetXSize(), int(std::ceil((x_off + width) * scale_x)));
+            int ov_y1 = std::min(overview_band->GetYSize(), int(std::ceil((y_off + height) * scale_y)));
+            intersect = t.backward(box2d<double>(ov_x0 / scale_x, ov_y0 / scale_y,
+                                                 ov_x1 / scale_x, ov_y1 / scale_y));
+            x_off = ov_x0;
+            y_off = ov_y0;
+            width = ov_x1 - ov_x0;
+            height = ov_y1 - ov_y0;
+            im_width = int(width_res * intersect.width() + 0.5);
+            im_height = int(height_res * intersect.height() + 0.5);
+            im_width = int(im_width * filter_factor + 0.5);
+            im_height = int(im_height * filter_factor + 0.5);
+            MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Overview=" << overview << " StartX=" << x_off << " StartY=" << y_off << " Width=" << width << " Height=" << height;
+        }
+        // the band, or its selected overview, to read from
+        auto level = [overview](GDALRasterBand * band) { return overview < 0 ? band : band->GetOverview(overview); };
+
         // case where we need to avoid upsampling so that the
         // image can be later scaled within raster_symbolizer
         if (im_width >= width || im_height >= height)
@@ -217,7 +253,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray8 image(im_width, im_height);
                     image.set(std::numeric_limits<std::uint8_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
+                    raster_io_error = level(band)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                      image.getData(), image.width(), image.height(),
                                                      GDT_Byte, 0, 0);
                     if (raster_io_error == CE_Failure)
@@ -237,7 +273,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray32f image(im_width, im_height);
                     image.set(std::numeric_limits<float>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
+                    raster_io_error = level(band)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                      image.getData(), image.width(), image.height(),
                                                      GDT_Float32, 0, 0);
                     if (raster_io_error == CE_Failure)
@@ -256,7 +292,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray16 image(im_width, im_height);
                     image.set(std::numeric_limits<std::uint16_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
+                    raster_io_error = level(band)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                      image.getData(), image.width(), image.height(),
                                                      GDT_UInt16, 0, 0);
                     if (raster_io_error == CE_Failure)
@@ -276,7 +312,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     mapnik::image_gray16s image(im_width, im_height);
                     image.set(std::numeric_limits<std::int16_t>::max());
                     raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                    raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
+                    raster_io_error = level(band)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                      image.getData(), image.width(), image.height(),
                                                      GDT_Int16, 0, 0);
                     if (raster_io_error == CE_Failure)
@@ -385,7 +421,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         // TODO - we assume here the nodata value for the red band applies to all bands
                         // more details about this at http://trac.osgeo.org/gdal/ticket/2734
                         float* imageData = (float*)image.getBytes();
-                        raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height,
+                        raster_io_error = level(red)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                         imageData, image.width(), image.height(),
                                                         GDT_Float32, 0, 0);
                         if (raster_io_error == CE_Failure) {
@@ -406,7 +442,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
 
                     /* Use dataset RasterIO in priority in 99.9% of the cases */
-                    if( red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
+                    if( overview < 0 && red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
                     {
                         int nBandsToRead = 3;
                         if( alpha != NULL && alpha->GetBand() == 4 && !raster_has_nodata )
@@ -425,17 +461,17 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
                     else
                     {
-                        raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
+                        raster_io_error = level(red)->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
                                                         image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
-                        raster_io_error = green->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 1,
+                        raster_io_error = level(green)->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 1,
                                                         image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
-                        raster_io_error = blue->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 2,
+                        raster_io_error = level(blue)->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 2,
                                                         image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
@@ -474,7 +510,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: applying nodata value for layer=" << apply_nodata;
                         // first read the data in and create an alpha channel from the nodata values
                         float* imageData = (float*)image.getBytes();
-                        raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height,
+                        raster_io_error = level(grey)->RasterIO(GF_Read, x_off, y_off, width, height,
                                                          imageData, image.width(), image.height(),
                                                          GDT_Float32, 0, 0);
                         if (raster_io_error == CE_Failure)
@@ -495,21 +531,21 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         }
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
+                    raster_io_error = level(grey)->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 0,
                                                      image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 1,
+                    raster_io_error = level(grey)->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 1,
                                                      image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
 
-                    raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 2,
+                    raster_io_error = level(grey)->RasterIO(GF_Read,x_off, y_off, width, height, image.getBytes() + 2,
                                                      image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
 
                     if (raster_io_error == CE_Failure)
@@ -546,7 +582,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: processing alpha band...";
                     if (!raster_has_nodata)
                     {
-                        raster_io_error = alpha->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 3,
+                        raster_io_error = level(alpha)->RasterIO(GF_Read, x_off, y_off, width, height, image.getBytes() + 3,
                                                           image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
@@ -629,6 +665,45 @@ feature_ptr gdal_featureset::get_feature_at_point(mapnik::coord2d const& pt)
     return feature_ptr();
 }
 
+// Index of the smallest overview that still has im_width x im_height pixels
+// over a width x height window of the raster, -1 when there is none. Every
+// band read must have the overview at the same size.
+int gdal_featureset::select_overview(int width, int height, int im_width, int im_height) const
+{
+    if ((im_width >= width && im_height >= height) || band_ > nbands_) return -1;
+    int first = band_ > 0 ? band_ : 1;
+    int last = band_ > 0 ? band_ : nbands_;
+    GDALRasterBand * band = dataset_.GetRasterBand(first);
+    if (!band) return -1;
+    int selected = -1;
+    int selected_width = 0;
+    for (int i = 0; i < band->GetOverviewCount(); ++i)
+    {
+        GDALRasterBand * overview = band->GetOverview(i);
+        if (!overview) continue;
+        int overview_width = overview->GetXSize();
+        int overview_height = overview->GetYSize();
+        if (width * (overview_width / double(raster_width_)) < im_width ||
+            height * (overview_height / double(raster_height_)) < im_height ||
+            (selected >= 0 && overview_width >= selected_width))
+        {
+            continue;
+        }
+        bool same_size = true;
+        for (int b = first + 1; b <= last && same_size; ++b)
+        {
+            GDALRasterBand * other = dataset_.GetRasterBand(b)->GetOverview(i);
+            same_size = other && other->GetXSize() == overview_width && other->GetYSize() == overview_height;
+        }
+        if (same_size)
+        {
+            selected = i;
+            selected_width = overview_width;
+        }
+    }
+    return selected;
+}
+
 #ifdef MAPNIK_LOG
 void gdal_featureset::get_overview_meta(GDALRasterBand* band)
 {
@@ -57,7 +57,7 @@ class gdal_featureset : public mapnik::Featureset
     };
 
 public:
-    gdal_featureset(GDALDataset& dataset,
+    gdal_featureset(gdal_dataset_ptr const& dataset,
                     int band,
                     gdal_query q,
                     mapnik::box2d<double> extent,
@@ -75,10 +75,12 @@ private:
     mapnik::feature_ptr get_feature(mapnik::query const& q);
     mapnik::feature_ptr get_feature_at_point(mapnik::coord2d const& p);
 
+    int select_overview(int width, int height, int im_width, int im_height) const;
 #ifdef MAPNIK_LOG
     void get_overview_meta(GDALRasterBand * band);
 #endif
 
+    gdal_dataset_ptr handle_;
     GDALDataset & dataset_;
     mapnik::context_ptr ctx_;
     int band_;
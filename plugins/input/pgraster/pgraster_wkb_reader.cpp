@@ -37,10 +37,11 @@
 #include <mapnik/util/trim.hpp>
 #include <mapnik/box2d.hpp> // for box2d
 
-// boost
-#include <boost/bind.hpp>
-
+// stl
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 namespace {
 
@@ -134,19 +135,6 @@ read_int32(const uint8_t** from, uint8_t littleEndian) {
     return read_uint32(from, littleEndian);
 }
 
-float
-read_float32(const uint8_t** from, uint8_t littleEndian) {
-
-    union {
-        float f;
-        uint32_t i;
-    } ret;
-
-    ret.i = read_uint32(from, littleEndian);
-
-    return ret.f;
-}
-
 
 typedef enum {
     PT_1BB=0,     /* 1-bit boolean            */
@@ -176,32 +164,75 @@ typedef enum {
 #define BANDTYPE_HAS_NODATA(x) ((x)&BANDTYPE_FLAG_HASNODATA)
 #define BANDTYPE_IS_NODATA(x) ((x)&BANDTYPE_FLAG_ISNODATA)
 
+// Pixel stored in a band in the given byte order. Signed pixel types are
+// read as unsigned, mapnik does not support them anyway.
+template <typename T>
+inline T read_pixel(const uint8_t* from, bool swap)
+{
+  uint8_t bytes[sizeof(T)];
+  if (swap) std::reverse_copy(from, from + sizeof(T), bytes);
+  else std::copy(from, from + sizeof(T), bytes);
+  T val;
+  std::memcpy(&val, bytes, sizeof(T));
+  return val;
+}
+
+// Whether pixels in the WKB byte order must be swapped on this machine
+inline bool swap_bytes(uint8_t littleEndian)
+{
+#ifdef MAPNIK_BIG_ENDIAN
+  return littleEndian != 0;
+#else
+  return littleEndian == 0;
+#endif
+}
+
+// Converts count pixels of type T at from into out, with the byte order
+// test hoisted out of the loop
+template <typename T, typename Out, typename Convert>
+void decode_pixels(const uint8_t* from, std::size_t count, bool swap,
+                   Out* out, Convert convert)
+{
+  if (swap) {
+    for (std::size_t i = 0; i < count; ++i, from += sizeof(T)) {
+      out[i] = convert(read_pixel<T>(from, true));
+    }
+  } else {
+    for (std::size_t i = 0; i < count; ++i, from += sizeof(T)) {
+      out[i] = convert(read_pixel<T>(from, false));
+    }
+  }
+}
+
 }
 
 template<typename T>
 mapnik::raster_ptr read_data_band(mapnik::box2d<double> const& bbox,
                     uint16_t width, uint16_t height,
-                    bool hasnodata, T reader)
+                    bool hasnodata, const uint8_t** from, bool swap)
 {
-  mapnik::image_gray32f image(width, height);
+  // the band is decoded from the result buffer straight into the image
+  mapnik::image_gray32f image(width, height, false);
   float* data = image.getData();
-  double val;
-  val = reader(); // nodata value, need to read anyway
-  for (int y=0; y<height; ++y) {
-    for (int x=0; x<width; ++x) {
-      val = reader();
-      int off = y * width + x;
-      data[off] = val;
-    }
+  double nodata = read_pixel<T>(*from, swap); // need to skip it anyway
+  *from += sizeof(T);
+  std::size_t count = std::size_t(width) * height;
+  if (!swap && std::is_same<T, float>::value) {
+    std::memcpy(data, *from, count * sizeof(float));
+  } else {
+    decode_pixels<T>(*from, count, swap, data,
+                     [](T val) { return static_cast<float>(val); });
   }
-  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, image, 1.0);
-  if ( hasnodata ) raster->set_nodata(val);
+  *from += count * sizeof(T);
+  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, std::move(image), 1.0);
+  if ( hasnodata ) raster->set_nodata(nodata);
   return raster;
 }
 
 mapnik::raster_ptr pgraster_wkb_reader::read_indexed(mapnik::box2d<double> const& bbox,
                                                      uint16_t width, uint16_t height)
 {
+  check_size(1);
   uint8_t type = read_uint8(&ptr_);
 
   int pixtype = BANDTYPE_PIXTYPE(type);
@@ -220,6 +251,7 @@ mapnik::raster_ptr pgraster_wkb_reader::read_indexed(mapnik::box2d<double> const
 
   MAPNIK_LOG_DEBUG(pgraster) << "pgraster_wkb_reader: reading " << height_ << "x" << width_ << " pixels";
 
+  bool swap = swap_bytes(endian_);
   switch (pixtype) {
     case PT_1BB:
     case PT_2BUI:
@@ -228,28 +260,28 @@ mapnik::raster_ptr pgraster_wkb_reader::read_indexed(mapnik::box2d<double> const
     case PT_8BSI:
       // mapnik does not support signed anyway
     case PT_8BUI:
-      return read_data_band(bbox, width_, height_, hasnodata,
-                     boost::bind(read_uint8, &ptr_));
+      check_band_size(1);
+      return read_data_band<uint8_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_16BSI:
       // mapnik does not support signed anyway
     case PT_16BUI:
-      return read_data_band(bbox, width_, height_, hasnodata,
-                     boost::bind(read_uint16, &ptr_, endian_));
+      check_band_size(2);
+      return read_data_band<uint16_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_32BSI:
       // mapnik does not support signed anyway
     case PT_32BUI:
-      return read_data_band(bbox, width_, height_, hasnodata,
-                     boost::bind(read_uint32, &ptr_, endian_));
+      check_band_size(4);
+      return read_data_band<uint32_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_32BF:
-      return read_data_band(bbox, width_, height_, hasnodata,
-                     boost::bind(read_float32, &ptr_, endian_));
+      check_band_size(4);
+      return read_data_band<float>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_64BF:
-      return read_data_band(bbox, width_, height_, hasnodata,
-                     boost::bind(read_float64, &ptr_, endian_));
+      check_band_size(8);
+      return read_data_band<double>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     default:
       std::ostringstream err;
@@ -264,37 +296,33 @@ mapnik::raster_ptr pgraster_wkb_reader::read_indexed(mapnik::box2d<double> const
 template<typename T>
 mapnik::raster_ptr read_grayscale_band(mapnik::box2d<double> const& bbox,
                          uint16_t width, uint16_t height,
-                         bool hasnodata, T reader)
+                         bool hasnodata, const uint8_t** from, bool swap)
 {
-  mapnik::image_rgba8 image(width,height, true, true);
-  // Start with plain white (ABGR or RGBA depending on endiannes)
-  // TODO: set to transparent instead?
-  image.set(0xffffffff);
-
-
-  int val;
-  uint8_t * data = image.getBytes();
-  int ps = 4; // sizeof(image::pixel_type)
-  int off;
-  val = reader(); // nodata value, need to read anyway
-  for (int y=0; y<height; ++y) {
-    for (int x=0; x<width; ++x) {
-      val = reader();
-      off = y * width * ps + x * ps;
-      // Pixel space is RGBA
-      data[off+0] = val;
-      data[off+1] = val;
-      data[off+2] = val;
-    }
-  }
-  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, image, 1.0);
-  if ( hasnodata ) raster->set_nodata(val);
+  // every pixel is written, as opaque grey
+  mapnik::image_rgba8 image(width,height, false, true);
+
+  int nodata = read_pixel<T>(*from, swap); // need to skip it anyway
+  *from += sizeof(T);
+  std::size_t count = std::size_t(width) * height;
+  // Pixel space is RGBA, the low byte of the value goes to every channel
+  decode_pixels<T>(*from, count, swap, image.getData(),
+                   [](T val) -> uint32_t {
+                     uint8_t v = static_cast<uint8_t>(val);
+                     uint8_t const rgba[4] = { v, v, v, 0xff };
+                     uint32_t pixel;
+                     std::memcpy(&pixel, rgba, 4);
+                     return pixel;
+                   });
+  *from += count * sizeof(T);
+  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, std::move(image), 1.0);
+  if ( hasnodata ) raster->set_nodata(nodata);
   return raster;
 }
 
 mapnik::raster_ptr pgraster_wkb_reader::read_grayscale(mapnik::box2d<double> const& bbox,
                                                        uint16_t width, uint16_t height)
 {
+  check_size(1);
   uint8_t type = read_uint8(&ptr_);
 
   int pixtype = BANDTYPE_PIXTYPE(type);
@@ -311,6 +339,7 @@ mapnik::raster_ptr pgraster_wkb_reader::read_grayscale(mapnik::box2d<double> con
     return mapnik::raster_ptr();
   }
 
+  bool swap = swap_bytes(endian_);
   switch (pixtype) {
     case PT_1BB:
     case PT_2BUI:
@@ -319,20 +348,20 @@ mapnik::raster_ptr pgraster_wkb_reader::read_grayscale(mapnik::box2d<double> con
     case PT_8BSI:
       // mapnik does not support signed anyway
     case PT_8BUI:
-      return read_grayscale_band(bbox, width_, height_, hasnodata,
-                          boost::bind(read_uint8, &ptr_));
+      check_band_size(1);
+      return read_grayscale_band<uint8_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_16BSI:
       // mapnik does not support signed anyway
     case PT_16BUI:
-      return read_grayscale_band(bbox, width_, height_, hasnodata,
-                          boost::bind(read_uint16, &ptr_, endian_));
+      check_band_size(2);
+      return read_grayscale_band<uint16_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     case PT_32BSI:
       // mapnik does not support signed anyway
     case PT_32BUI:
-      return read_grayscale_band(bbox, width_, height_, hasnodata,
-                          boost::bind(read_uint32, &ptr_, endian_));
+      check_band_size(4);
+      return read_grayscale_band<uint32_t>(bbox, width_, height_, hasnodata, &ptr_, swap);
       break;
     default:
       std::ostringstream err;
@@ -347,12 +376,13 @@ mapnik::raster_ptr pgraster_wkb_reader::read_grayscale(mapnik::box2d<double> con
 mapnik::raster_ptr pgraster_wkb_reader::read_rgba(mapnik::box2d<double> const& bbox,
                                                   uint16_t width, uint16_t height)
 {
-  mapnik::image_rgba8 im(width, height, true, true);
+  mapnik::image_rgba8 im(width, height, false, true);
   // Start with plain white (ABGR or RGBA depending on endiannes)
   im.set(0xffffffff);
 
   uint8_t nodataval;
   for (int bn=0; bn<numBands_; ++bn) {
+    check_size(1);
     uint8_t type = read_uint8(&ptr_);
 
     int pixtype = BANDTYPE_PIXTYPE(type);
@@ -375,6 +405,7 @@ mapnik::raster_ptr pgraster_wkb_reader::read_rgba(mapnik::box2d<double> const& b
       continue;
     }
 
+    check_band_size(1);
     uint8_t tmp = read_uint8(&ptr_);
     if ( ! bn ) nodataval = tmp;
     else if ( tmp != nodataval ) {
@@ -382,27 +413,39 @@ mapnik::raster_ptr pgraster_wkb_reader::read_rgba(mapnik::box2d<double> const& b
             << " nodataval " << tmp << " != band 0 nodataval " << nodataval;
     }
 
+    // Pixel space is RGBA, the band goes to channel bn of every pixel
     int ps = 4; // sizeof(image::pixel_type)
-    uint8_t * image_data = im.getBytes();
-    for (int y=0; y<height_; ++y) {
-      for (int x=0; x<width_; ++x) {
-        uint8_t val = read_uint8(&ptr_);
-        // y * width_ * ps is the row (ps is pixel size)
-        // x * ps is the column
-        int off = y * width_ * ps + x * ps;
-        // Pixel space is RGBA
-        image_data[off+bn] = val;
-      }
+    uint8_t * image_data = im.getBytes() + bn;
+    std::size_t count = std::size_t(width_) * height_;
+    for (std::size_t i = 0; i < count; ++i) {
+      image_data[i * ps] = ptr_[i];
     }
+    ptr_ += count;
   }
-  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, im, 1.0);
+  mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(bbox, std::move(im), 1.0);
   raster->set_nodata(0xffffffff);
   return raster;
 }
 
+void pgraster_wkb_reader::check_size(std::size_t bytes) const
+{
+  if ( static_cast<std::size_t>(end_ - ptr_) < bytes ) {
+    throw mapnik::datasource_exception("pgraster_wkb_reader: truncated raster wkb");
+  }
+}
+
+void pgraster_wkb_reader::check_band_size(std::size_t pixel_size) const
+{
+  // nodata value followed by the pixels
+  check_size((std::size_t(width_) * height_ + 1) * pixel_size);
+}
+
 mapnik::raster_ptr
 pgraster_wkb_reader::get_raster() {
 
+    // byte order, version, band count, 6 doubles, srid, width and height
+    check_size(61);
+
     /* Read endianness */
     endian_ = *ptr_;
     ptr_ += 1;
@@ -31,6 +31,9 @@
 #include <mapnik/feature.hpp> // for raster_ptr
 #include <mapnik/box2d.hpp>
 
+// stl
+#include <cstddef>
+
 enum pgraster_color_interp {
   // Automatic color interpretation:
   // uses grayscale for single band, rgb for 3 bands
@@ -48,7 +51,7 @@ class pgraster_wkb_reader
 public:
 
   pgraster_wkb_reader(const uint8_t* wkb, int size, int bnd=0)
-    : ptr_(wkb), bandno_(bnd)
+    : ptr_(wkb), end_(wkb + size), bandno_(bnd)
   {}
 
   mapnik::raster_ptr get_raster();
@@ -69,11 +72,15 @@ private:
   mapnik::raster_ptr read_indexed(mapnik::box2d<double> const& bbox, uint16_t width, uint16_t height);
   mapnik::raster_ptr read_grayscale(mapnik::box2d<double> const& bbox, uint16_t width, uint16_t height);
   mapnik::raster_ptr read_rgba(mapnik::box2d<double> const& bbox, uint16_t width, uint16_t height);
+  // throw unless the wkb has that many bytes left
+  void check_size(std::size_t bytes) const;
+  void check_band_size(std::size_t pixel_size) const;
 
   //int wkbsize_;
   //const uint8_t* wkb_;
   //const uint8_t* wkbend_;
   const uint8_t* ptr_;
+  const uint8_t* end_;
   uint8_t endian_;
   int bandno_;
   uint16_t numBands_;
@@ -0,0 +1,240 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#include "raster_cache.hpp"
+
+// stl
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace {
+
+// bounds on the bookkeeping that is not counted in max_bytes
+const std::size_t max_idle_readers = 64;
+const std::size_t max_sizes = 65536;
+
+std::size_t block_bytes(std::string const& key, mapnik::image_any const& block)
+{
+    return key.size() + block.getSize();
+}
+
+}
+
+raster_cache::raster_cache()
+    : blocks_(),
+      block_index_(),
+      bytes_(0),
+      max_bytes_(64 * 1024 * 1024),
+      max_bytes_requested_(false),
+      sizes_(),
+      readers_() {}
+
+std::string raster_cache::file_key(std::string const& file)
+{
+#ifdef _WINDOWS
+    struct _stat64 st;
+    if (_wstat64(mapnik::utf8_to_utf16(file).c_str(), &st) != 0)
+#else
+    struct stat st;
+    if (::stat(file.c_str(), &st) != 0)
+#endif
+    {
+        return std::string();
+    }
+    std::string key(file);
+    key += '\n';
+    key += std::to_string(static_cast<long long>(st.st_size));
+    key += ':';
+    key += std::to_string(static_cast<long long>(st.st_mtime));
+    // seconds alone miss a rewrite of the same size within the same second
+#if defined(__APPLE__)
+    key += '.';
+    key += std::to_string(static_cast<long long>(st.st_mtimespec.tv_nsec));
+#elif !defined(_WINDOWS)
+    key += '.';
+    key += std::to_string(static_cast<long long>(st.st_mtim.tv_nsec));
+#endif
+    key += ':';
+    key += std::to_string(static_cast<unsigned long long>(st.st_ino));
+    return key;
+}
+
+std::string raster_cache::block_key(std::string const& file_key, unsigned overview,
+                                    int x, int y, int width, int height)
+{
+    std::string key(file_key);
+    key += '\n';
+    key += std::to_string(overview);
+    key += ':';
+    key += std::to_string(x);
+    key += ',';
+    key += std::to_string(y);
+    key += ',';
+    key += std::to_string(width);
+    key += ',';
+    key += std::to_string(height);
+    return key;
+}
+
+raster_cache::block_ptr raster_cache::find_block(std::string const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    auto itr = block_index_.find(key);
+    if (itr == block_index_.end())
+    {
+        return block_ptr();
+    }
+    blocks_.splice(blocks_.begin(), blocks_, itr->second);
+    return itr->second->second;
+}
+
+void raster_cache::insert_block(std::string const& key, block_ptr const& block)
+{
+    std::size_t bytes = block_bytes(key, *block);
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (bytes > max_bytes_ || block_index_.find(key) != block_index_.end())
+    {
+        return;
+    }
+    blocks_.emplace_front(key, block);
+    block_index_.emplace(key, blocks_.begin());
+    bytes_ += bytes;
+    evict();
+}
+
+void raster_cache::evict()
+{
+    while (bytes_ > max_bytes_ && !blocks_.empty())
+    {
+        auto const& last = blocks_.back();
+        bytes_ -= block_bytes(last.first, *last.second);
+        block_index_.erase(last.first);
+        blocks_.pop_back();
+    }
+}
+
+bool raster_cache::find_size(std::string const& file_key, unsigned & width, unsigned & height)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    auto itr = sizes_.find(file_key);
+    if (itr == sizes_.end())
+    {
+        return false;
+    }
+    width = itr->second.first;
+    height = itr->second.second;
+    return true;
+}
+
+void raster_cache::insert_size(std::string const& file_key, unsigned width, unsigned height)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (sizes_.size() >= max_sizes)
+    {
+        sizes_.clear();
+    }
+    sizes_[file_key] = std::make_pair(width, height);
+}
+
+raster_cache::reader_ptr raster_cache::acquire_reader(std::string const& file_key, std::string const& file,
+                                                     std::string const& format)
+{
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        for (auto itr = readers_.begin(); itr != readers_.end(); ++itr)
+        {
+            if (itr->first == file_key)
+            {
+                reader_ptr reader = std::move(itr->second);
+                readers_.erase(itr);
+                return reader;
+            }
+        }
+    }
+    return reader_ptr(mapnik::get_image_reader(file, format));
+}
+
+void raster_cache::release_reader(std::string const& file_key, reader_ptr && reader)
+{
+    if (!reader) return;
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    readers_.emplace_front(file_key, std::move(reader));
+    if (readers_.size() > max_idle_readers)
+    {
+        readers_.pop_back();
+    }
+}
+
+void raster_cache::set_max_bytes(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    max_bytes_ = bytes;
+    evict();
+}
+
+void raster_cache::request_max_bytes(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    if (!max_bytes_requested_ || bytes > max_bytes_)
+    {
+        max_bytes_ = bytes;
+        max_bytes_requested_ = true;
+        evict();
+    }
+}
+
+std::size_t raster_cache::max_bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return max_bytes_;
+}
+
+void raster_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    blocks_.clear();
+    block_index_.clear();
+    bytes_ = 0;
+    sizes_.clear();
+    readers_.clear();
+}
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef RASTER_CACHE_HPP
+#define RASTER_CACHE_HPP
+
+// mapnik
+#include <mapnik/utils.hpp>
+#include <mapnik/image_any.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Decoded source blocks, open readers and image sizes shared by every raster
+// datasource in the process. Neighbouring output tiles and zoom levels keep
+// asking for the same windows of the same files; with this they are decoded
+// once. Entries are keyed by file_key, so a file replaced on disk is read
+// again. Blocks are evicted least recently used first once their total size
+// goes over max_bytes.
+class raster_cache :
+        public mapnik::singleton<raster_cache, mapnik::CreateStatic>,
+        private mapnik::util::noncopyable
+{
+    friend class mapnik::CreateStatic<raster_cache>;
+public:
+    using block_ptr = std::shared_ptr<mapnik::image_any const>;
+    using reader_ptr = std::unique_ptr<mapnik::image_reader>;
+
+    // path, size, modification time and inode of the file as it is now,
+    // empty if it cannot be stat'ed (the file is then not cached)
+    static std::string file_key(std::string const& file);
+    static std::string block_key(std::string const& file_key, unsigned overview,
+                                 int x, int y, int width, int height);
+    block_ptr find_block(std::string const& key);
+    void insert_block(std::string const& key, block_ptr const& block);
+
+    bool find_size(std::string const& file_key, unsigned & width, unsigned & height);
+    void insert_size(std::string const& file_key, unsigned width, unsigned height);
+
+    // an idle reader for the file or a newly opened one, null if the format
+    // has no reader; hand it back with release_reader once done with it
+    reader_ptr acquire_reader(std::string const& file_key, std::string const& file,
+                              std::string const& format);
+    void release_reader(std::string const& file_key, reader_ptr && reader);
+
+    // Sets the budget of the blocks (64MB by default)
+    void set_max_bytes(std::size_t bytes);
+    // Budget asked for by a datasource's cache_size: the largest request
+    // wins, whatever order layers are loaded in
+    void request_max_bytes(std::size_t bytes);
+    std::size_t max_bytes() const;
+    void clear();
+
+private:
+    raster_cache();
+    void evict();
+
+    using block_list = std::list<std::pair<std::string, block_ptr> >;
+    block_list blocks_; // most recently used first
+    std::unordered_map<std::string, block_list::iterator> block_index_;
+    std::size_t bytes_;
+    std::size_t max_bytes_;
+    bool max_bytes_requested_;
+    std::unordered_map<std::string, std::pair<unsigned, unsigned> > sizes_;
+    std::list<std::pair<std::string, reader_ptr> > readers_; // idle, most recently used first
+};
+
+#endif // RASTER_CACHE_HPP
@@ -33,6 +33,7 @@
 #include "raster_featureset.hpp"
 #include "raster_info.hpp"
 #include "raster_datasource.hpp"
+#include "raster_cache.hpp"
 
 using mapnik::layer_descriptor;
 using mapnik::featureset_ptr;
@@ -64,6 +65,16 @@ raster_datasource::raster_datasource(parameters const& params)
     multi_tiles_ = *params.get<mapnik::boolean_type>("multi", false);
     tile_size_ = *params.get<mapnik::value_integer>("tile_size", 256);
     tile_stride_ = *params.get<mapnik::value_integer>("tile_stride", 1);
+    use_cache_ = *params.get<mapnik::boolean_type>("cache", true);
+    bool use_overviews = *params.get<mapnik::boolean_type>("overviews", true);
+    // decoding JPEG and WebP at a reduced scale is faster but changes the output
+    bool scaled_decode = *params.get<mapnik::boolean_type>("scaled_decode", false);
+    boost::optional<mapnik::value_integer> cache_size = params.get<mapnik::value_integer>("cache_size");
+    if (cache_size && *cache_size >= 0)
+    {
+        // the block cache is shared by all raster layers, which get the largest budget asked for
+        raster_cache::instance().request_max_bytes(static_cast<std::size_t>(*cache_size));
+    }
 
     boost::optional<std::string> format_from_filename = mapnik::type_from_filename(*file);
     format_ = *params.get<std::string>("format",format_from_filename?(*format_from_filename) : "tiff");
@@ -132,6 +143,11 @@ raster_datasource::raster_datasource(parameters const& params)
             {
                 width_ = reader->width();
                 height_ = reader->height();
+                if (reader->scaled_overviews() && !scaled_decode) use_overviews = false;
+                for (unsigned level = 1; use_overviews && level <= reader->overview_count(); ++level)
+                {
+                    overviews_.push_back(reader->overview_size(level));
+                }
             }
         }
         catch (mapnik::image_reader_exception const& ex)
@@ -192,21 +208,47 @@ featureset_ptr raster_datasource::features(query const& q) const
 
     MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Box size=" << width << "," << height;
 
+    // decode from the smallest overview that still has the output resolution
+    // (times the filter factor of the scaling method) instead of the full image
+    unsigned overview = 0;
+    std::pair<unsigned, unsigned> overview_size(width_, height_);
+    if (!overviews_.empty() && intersect.width() > 0 && intersect.height() > 0)
+    {
+        double filter_factor = q.get_filter_factor();
+        double scale_x = ext.width() / (intersect.width() * std::get<0>(q.resolution()) * filter_factor);
+        double scale_y = ext.height() / (intersect.height() * std::get<1>(q.resolution()) * filter_factor);
+        for (std::size_t i = 0; i < overviews_.size(); ++i)
+        {
+            if (static_cast<double>(width_) / overviews_[i].first <= scale_x &&
+                static_cast<double>(height_) / overviews_[i].second <= scale_y)
+            {
+                overview = i + 1;
+                overview_size = overviews_[i];
+            }
+        }
+        MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Overview=" << overview
+                                 << " size=" << overview_size.first << "," << overview_size.second;
+    }
+    // pixels to decode at the resolution of the overview
+    const double pixels = static_cast<double>(width) * overview_size.first / width_ *
+                          height * overview_size.second / height_;
+
     if (multi_tiles_)
     {
         MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Multi-Tiled policy";
 
         tiled_multi_file_policy policy(filename_, format_, tile_size_, extent_, q.get_bbox(), width_, height_, tile_stride_);
 
-        return std::make_shared<raster_featureset<tiled_multi_file_policy> >(policy, extent_, q);
+        return std::make_shared<raster_featureset<tiled_multi_file_policy> >(policy, extent_, q, use_cache_);
     }
-    else if (width * height > static_cast<int>(tile_size_ * tile_size_ << 2))
+    else if (pixels > static_cast<int>(tile_size_ * tile_size_ << 2))
     {
         MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Tiled policy";
 
         tiled_file_policy policy(filename_, format_, tile_size_, extent_, q.get_bbox(), width_, height_);
 
-        return std::make_shared<raster_featureset<tiled_file_policy> >(policy, extent_, q);
+        return std::make_shared<raster_featureset<tiled_file_policy> >(policy, extent_, q, use_cache_,
+                                                                        overview, overview_size);
     }
     else
     {
@@ -215,7 +257,8 @@ featureset_ptr raster_datasource::features(query const& q) const
         raster_info info(filename_, format_, extent_, width_, height_);
         single_file_policy policy(info);
 
-        return std::make_shared<raster_featureset<single_file_policy> >(policy, extent_, q);
+        return std::make_shared<raster_featureset<single_file_policy> >(policy, extent_, q, use_cache_,
+                                                                         overview, overview_size);
     }
 }
 
@@ -39,6 +39,7 @@
 // stl
 #include <vector>
 #include <string>
+#include <utility>
 
 
 class raster_datasource : public mapnik::datasource
@@ -64,8 +65,10 @@ private:
     bool multi_tiles_;
     unsigned tile_size_;
     unsigned tile_stride_;
+    bool use_cache_;
     unsigned width_;
     unsigned height_;
+    std::vector<std::pair<unsigned, unsigned> > overviews_;
 };
 
 #endif // RASTER_DATASOURCE_HPP
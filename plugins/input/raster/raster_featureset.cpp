@@ -38,7 +38,12 @@
 #include <boost/format.hpp>
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cmath>
+
 #include "raster_featureset.hpp"
+#include "raster_cache.hpp"
 
 using mapnik::query;
 using mapnik::image_reader;
@@ -50,14 +55,20 @@ using mapnik::feature_factory;
 template <typename LookupPolicy>
 raster_featureset<LookupPolicy>::raster_featureset(LookupPolicy const& policy,
                                                    box2d<double> const& extent,
-                                                   query const& q)
+                                                   query const& q,
+                                                   bool use_cache,
+                                                   unsigned overview,
+                                                   std::pair<unsigned, unsigned> const& overview_size)
     : policy_(policy),
       feature_id_(1),
       ctx_(std::make_shared<mapnik::context_type>()),
       extent_(extent),
       bbox_(q.get_bbox()),
       curIter_(policy_.begin()),
-      endIter_(policy_.end())
+      endIter_(policy_.end()),
+      use_cache_(use_cache),
+      overview_(overview),
+      overview_size_(overview_size)
 {
 }
 
@@ -75,15 +86,32 @@ feature_ptr raster_featureset<LookupPolicy>::next()
 
         try
         {
-            std::unique_ptr<image_reader> reader(mapnik::get_image_reader(curIter_->file(),curIter_->format()));
+            raster_cache & cache = raster_cache::instance();
+            // checked against the file on every lookup, so a replaced file is read again
+            std::string file_key = use_cache_ ? raster_cache::file_key(curIter_->file()) : std::string();
+            bool cached = !file_key.empty();
+            raster_cache::reader_ptr reader;
+            unsigned src_width = 0;
+            unsigned src_height = 0;
+            if (!cached || !cache.find_size(file_key, src_width, src_height))
+            {
+                if (cached) reader = cache.acquire_reader(file_key, curIter_->file(), curIter_->format());
+                else reader.reset(mapnik::get_image_reader(curIter_->file(),curIter_->format()));
 
-            MAPNIK_LOG_DEBUG(raster) << "raster_featureset: Reader=" << curIter_->format() << "," << curIter_->file()
-                                     << ",size(" << curIter_->width() << "," << curIter_->height() << ")";
+                MAPNIK_LOG_DEBUG(raster) << "raster_featureset: Reader=" << curIter_->format() << "," << curIter_->file()
+                                         << ",size(" << curIter_->width() << "," << curIter_->height() << ")";
+                if (reader.get())
+                {
+                    src_width = reader->width();
+                    src_height = reader->height();
+                    if (cached) cache.insert_size(file_key, src_width, src_height);
+                }
+            }
 
-            if (reader.get())
+            if (src_width > 0 && src_height > 0)
             {
-                int image_width = policy_.img_width(reader->width());
-                int image_height = policy_.img_height(reader->height());
+                int image_width = policy_.img_width(src_width);
+                int image_height = policy_.img_height(src_height);
 
                 if (image_width > 0 && image_height > 0)
                 {
@@ -108,18 +136,69 @@ feature_ptr raster_featureset<LookupPolicy>::next()
                         int width = end_x - x_off;
                         int height = end_y - y_off;
 
+                        // window to decode, in pixels of the overview when reading one
+                        double x0 = x_off;
+                        double y0 = y_off;
+                        double x1 = end_x;
+                        double y1 = end_y;
+                        if (overview_ > 0)
+                        {
+                            double fx = static_cast<double>(overview_size_.first) / image_width;
+                            double fy = static_cast<double>(overview_size_.second) / image_height;
+                            int overview_end_x = std::min(static_cast<int>(std::ceil(end_x * fx)),
+                                                          static_cast<int>(overview_size_.first));
+                            int overview_end_y = std::min(static_cast<int>(std::ceil(end_y * fy)),
+                                                          static_cast<int>(overview_size_.second));
+                            x_off = static_cast<int>(std::floor(x_off * fx));
+                            y_off = static_cast<int>(std::floor(y_off * fy));
+                            width = overview_end_x - x_off;
+                            height = overview_end_y - y_off;
+                            // widened to whole overview pixels
+                            x0 = x_off / fx;
+                            y0 = y_off / fy;
+                            x1 = overview_end_x / fx;
+                            y1 = overview_end_y / fy;
+                        }
+
                         // calculate actual box2d of returned raster
-                        box2d<double> feature_raster_extent(rem.minx() + x_off,
-                                                            rem.miny() + y_off,
-                                                            rem.maxx() + x_off + width,
-                                                            rem.maxy() + y_off + height);
+                        box2d<double> feature_raster_extent(rem.minx() + x0,
+                                                            rem.miny() + y0,
+                                                            rem.maxx() + x1,
+                                                            rem.maxy() + y1);
                         intersect = t.backward(feature_raster_extent);
-                        mapnik::image_any data = reader->read(x_off, y_off, width, height);
-                        mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, std::move(data), 1.0);
-                        feature->set_raster(raster);
+                        mapnik::image_any data;
+                        bool have_data = true;
+                        if (cached)
+                        {
+                            std::string key = raster_cache::block_key(file_key, overview_, x_off, y_off, width, height);
+                            raster_cache::block_ptr block = cache.find_block(key);
+                            if (!block)
+                            {
+                                if (!reader) reader = cache.acquire_reader(file_key, curIter_->file(), curIter_->format());
+                                if (reader)
+                                {
+                                    block = std::make_shared<mapnik::image_any const>(
+                                        reader->read_overview(overview_, x_off, y_off, width, height));
+                                    cache.insert_block(key, block);
+                                }
+                            }
+                            // the feature gets its own copy, symbolizers may modify it
+                            if (block) data = *block;
+                            else have_data = false;
+                        }
+                        else
+                        {
+                            data = reader->read_overview(overview_, x_off, y_off, width, height);
+                        }
+                        if (have_data)
+                        {
+                            mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(intersect, std::move(data), 1.0);
+                            feature->set_raster(raster);
+                        }
                     }
                 }
             }
+            if (cached) cache.release_reader(file_key, std::move(reader));
         }
         catch (mapnik::image_reader_exception const& ex)
         {
@@ -32,6 +32,7 @@
 
 // stl
 #include <vector>
+#include <utility>
 
 // boost
 #include <boost/utility.hpp>
@@ -309,7 +310,10 @@ class raster_featureset : public mapnik::Featureset
 public:
     raster_featureset(LookupPolicy const& policy,
                       box2d<double> const& exttent,
-                      mapnik::query const& q);
+                      mapnik::query const& q,
+                      bool use_cache,
+                      unsigned overview = 0,
+                      std::pair<unsigned, unsigned> const& overview_size = std::pair<unsigned, unsigned>(0, 0));
     virtual ~raster_featureset();
     mapnik::feature_ptr next();
 
@@ -321,6 +325,9 @@ private:
     mapnik::box2d<double> bbox_;
     iterator_type curIter_;
     iterator_type endIter_;
+    bool use_cache_;
+    unsigned overview_;
+    std::pair<unsigned, unsigned> overview_size_;
 };
 
 #endif // RASTER_FEATURESET_HPP
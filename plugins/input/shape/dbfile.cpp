@@ -40,6 +40,7 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -49,7 +50,9 @@ dbf_file::dbf_file()
     : num_records_(0),
       num_fields_(0),
       record_length_(0),
-      record_(0) {}
+      record_(0),
+      span_offset_(0),
+      span_length_(0) {}
 
 dbf_file::dbf_file(std::string const& file_name)
     :num_records_(0),
@@ -62,7 +65,9 @@ dbf_file::dbf_file(std::string const& file_name)
 #else
      file_(file_name.c_str() ,std::ios::in | std::ios::binary),
 #endif
-     record_(0)
+     record_(0),
+     span_offset_(0),
+     span_length_(0)
 {
 
 #ifdef SHAPE_MEMORY_MAPPED_FILE
@@ -84,10 +89,7 @@ dbf_file::dbf_file(std::string const& file_name)
 }
 
 
-dbf_file::~dbf_file()
-{
-    ::operator delete(record_);
-}
+dbf_file::~dbf_file() {}
 
 
 bool dbf_file::is_open()
@@ -111,20 +113,56 @@ int dbf_file::num_fields() const
 }
 
 
+void dbf_file::select_columns(std::vector<int> const& cols)
+{
+    std::size_t begin = record_length_;
+    std::size_t end = 0;
+    for (int col : cols)
+    {
+        if (col >= 0 && col < num_fields_)
+        {
+            std::size_t offset = static_cast<std::size_t>(fields_[col].offset_);
+            begin = std::min(begin, offset);
+            end = std::max(end, offset + fields_[col].length_);
+        }
+    }
+    span_offset_ = (begin < end) ? begin : 0;
+    span_length_ = (begin < end) ? end - begin : 0;
+}
+
 void dbf_file::move_to(int index)
 {
+    // a record that cannot be read leaves no record rather than the previous one
+    record_ = 0;
     if (index>0 && index<=num_records_)
     {
-        std::streampos pos=(num_fields_<<5)+34+(index-1)*(record_length_+1);
-        file_.seekg(pos,std::ios::beg);
-        file_.read(record_,record_length_);
+        std::size_t pos = (num_fields_<<5) + 34 + static_cast<std::size_t>(index-1) * (record_length_+1);
+#ifdef SHAPE_MEMORY_MAPPED_FILE
+        // fields are decoded straight from the mapping, nothing is copied
+        if (pos + record_length_ <= file_.buffer().second)
+        {
+            record_ = file_.buffer().first + pos;
+        }
+#else
+        if (record_buffer_.empty()) return;
+        if (span_length_ > 0)
+        {
+            file_.seekg(pos + span_offset_, std::ios::beg);
+            if (!file_.read(record_buffer_.data() + span_offset_, span_length_))
+            {
+                file_.clear();
+                return;
+            }
+        }
+        record_ = record_buffer_.data();
+#endif
     }
 }
 
 
 std::string dbf_file::string_value(int col) const
 {
-    if (col>=0 && col<num_fields_)
+    if (record_ && col>=0 && col<num_fields_)
     {
         return std::string(record_+fields_[col].offset_,fields_[col].length_);
     }
@@ -143,7 +181,7 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
 {
     using namespace boost::spirit;
 
-    if (col>=0 && col<num_fields_)
+    if (record_ && col>=0 && col<num_fields_)
     {
         std::string const& name=fields_[col].name_;
 
@@ -153,10 +191,13 @@ void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feat
         case 'C':
         case 'D':
         {
-            // FIXME - avoid constructing std::string on stack
-            std::string str(record_+fields_[col].offset_,fields_[col].length_);
-            mapnik::util::trim(str);
-            f.put(name,tr.transcode(str.c_str()));
+            // trimmed in place, text ends at the first NUL as a C string would
+            const char *itr = record_+fields_[col].offset_;
+            const char *end = itr + fields_[col].length_;
+            itr = std::find_if(itr, end, mapnik::util::not_whitespace);
+            while (end != itr && !mapnik::util::not_whitespace(*(end - 1))) --end;
+            end = std::find(itr, end, '\0');
+            f.put(name,tr.transcode(itr, static_cast<std::int32_t>(end - itr)));
             break;
         }
         case 'L':
@@ -249,10 +290,15 @@ void dbf_file::read_header()
             fields_.push_back(desc);
         }
         record_length_=offset;
+        span_offset_ = 0;
+        span_length_ = record_length_;
+#ifndef SHAPE_MEMORY_MAPPED_FILE
         if (record_length_>0)
         {
-            record_=static_cast<char*>(::operator new (sizeof(char)*record_length_));
+            record_buffer_.resize(record_length_);
+            record_ = record_buffer_.data();
         }
+#endif
     }
 }
 
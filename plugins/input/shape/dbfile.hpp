@@ -64,8 +64,13 @@ private:
     mapnik::mapped_region_ptr mapped_region_;
 #else
     std::ifstream file_;
+    std::vector<char> record_buffer_;
 #endif
-    char* record_;
+    // current record, in place in the mapping when memory mapped
+    const char* record_;
+    // bytes of a record spanning the selected columns
+    std::size_t span_offset_;
+    std::size_t span_length_;
 public:
     dbf_file();
     dbf_file(std::string const& file_name);
@@ -74,6 +79,9 @@ public:
     int num_records() const;
     int num_fields() const;
     field_descriptor const& descriptor(int col) const;
+    // Restricts the record bytes move_to reads to those of the given columns,
+    // other columns must not be decoded until the selection is widened again.
+    void select_columns(std::vector<int> const& cols);
     void move_to(int index);
     std::string string_value(int col) const;
     void add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const throw();
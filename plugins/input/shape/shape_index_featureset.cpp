@@ -40,6 +40,7 @@
 #include "shape_index_featureset.hpp"
 #include "shape_utils.hpp"
 #include "shp_index.hpp"
+#include "shp_rtree.hpp"
 
 using mapnik::feature_factory;
 using mapnik::geometry_type;
@@ -57,13 +58,20 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
     tr_(new mapnik::transcoder(encoding)),
     row_limit_(row_limit),
     count_(0),
+    filtered_(false),
     feature_bbox_()
 {
     shape_ptr_->shp().skip(100);
     setup_attributes(ctx_, attribute_names, shape_name, *shape_ptr_,attr_ids_);
 
     auto index = shape_ptr_->index();
-    if (index)
+    if (index && shape_ptr_->has_rtree())
+    {
+        // leaf boxes are the record boxes, so every record returned passes
+        // and none is read just to be thrown away
+        filtered_ = shp_rtree<filterT>::query(filter, *index, offsets_);
+    }
+    else if (index)
     {
 #ifdef SHAPE_MEMORY_MAPPED_FILE
         //shp_index<filterT,stream<mapped_file_source> >::query(filter, index->file(), offsets_);
@@ -114,7 +122,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_multipointz:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filtered_ && !filter_.pass(feature_bbox_)) continue;
             int num_points = record.read_ndr_integer();
             for (int i = 0; i < num_points; ++i)
             {
@@ -131,7 +139,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_polylinez:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filtered_ && !filter_.pass(feature_bbox_)) continue;
             shape_io::read_polyline(record,feature->paths());
             break;
         }
@@ -140,7 +148,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         case shape_io::shape_polygonz:
         {
             shape_io::read_bbox(record, feature_bbox_);
-            if (!filter_.pass(feature_bbox_)) continue;
+            if (!filtered_ && !filter_.pass(feature_bbox_)) continue;
             shape_io::read_polygon(record,feature->paths());
             break;
         }
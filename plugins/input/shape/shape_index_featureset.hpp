@@ -68,6 +68,7 @@ private:
     std::vector<int> attr_ids_;
     mapnik::value_integer row_limit_;
     mutable int count_;
+    bool filtered_;
     mutable box2d<double> feature_bbox_;
 };
 
@@ -21,12 +21,14 @@
  *****************************************************************************/
 
 #include "shape_io.hpp"
+#include "shp_rtree.hpp"
 
 // mapnik
 #include <mapnik/debug.hpp>
 #include <mapnik/make_unique.hpp>
 #include <mapnik/datasource.hpp>
 #include <mapnik/geom_util.hpp>
+#include <mapnik/util/fs.hpp>
 // boost
 
 using mapnik::datasource_exception;
@@ -35,11 +37,13 @@ using mapnik::hit_test_first;
 const std::string shape_io::SHP = ".shp";
 const std::string shape_io::DBF = ".dbf";
 const std::string shape_io::INDEX = ".index";
+const std::string shape_io::RTREE = ".rtree";
 
 shape_io::shape_io(std::string const& shape_name, bool open_index)
     : type_(shape_null),
       shp_(shape_name + SHP),
       dbf_(shape_name + DBF),
+      rtree_(false),
       reclength_(0),
       id_(0)
 {
@@ -49,7 +53,24 @@ shape_io::shape_io(std::string const& shape_name, bool open_index)
         throw datasource_exception("Shape Plugin: cannot read shape file '" + shape_name + "'");
     }
 
-    if (open_index)
+    if (open_index && mapnik::util::exists(shape_name + RTREE))
+    {
+        // prefer the packed r-tree written by `shapeindex --rtree`
+        try
+        {
+            index_ = std::make_unique<shape_file>(shape_name + RTREE);
+            shp_rtree_format::header hdr;
+            rtree_ = index_->is_open() && shp_rtree_format::read_header(*index_, hdr);
+        }
+        catch (...) {}
+        if (!rtree_)
+        {
+            MAPNIK_LOG_WARN(shape) << "shape_io: Could not read index=" << shape_name << RTREE;
+            index_.reset();
+        }
+    }
+
+    if (open_index && !rtree_)
     {
         try
         {
@@ -75,6 +75,12 @@ public:
         return (index_ && index_->is_open());
     }
 
+    // true when the index is the packed r-tree rather than the quadtree
+    inline bool has_rtree() const
+    {
+        return has_index() && rtree_;
+    }
+
     void move_to(std::streampos pos);
     static void read_bbox(shape_file::record_type & record, mapnik::box2d<double> & bbox);
     static void read_polyline(shape_file::record_type & record,mapnik::geometry_container & geom);
@@ -84,6 +90,7 @@ public:
     shape_file shp_;
     dbf_file   dbf_;
     std::unique_ptr<shape_file> index_;
+    bool rtree_;
     unsigned reclength_;
     unsigned id_;
     box2d<double> cur_extent_;
@@ -91,6 +98,7 @@ public:
     static const std::string SHP;
     static const std::string DBF;
     static const std::string INDEX;
+    static const std::string RTREE;
 };
 
 #endif //SHAPE_IO_HPP
@@ -70,4 +70,6 @@ void setup_attributes(mapnik::context_ptr const& ctx,
             throw mapnik::datasource_exception("Shape Plugin: " + s);
         }
     }
+    // records only need the bytes of the requested columns
+    shape.dbf().select_columns(attr_ids);
 }
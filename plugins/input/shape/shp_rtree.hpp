@@ -0,0 +1,235 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef SHP_RTREE_HPP
+#define SHP_RTREE_HPP
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <vector>
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/global.hpp>
+
+#include "shapefile.hpp"
+
+// Packed Hilbert R-tree written by `shapeindex --rtree`, stored next to the
+// shapefile as <name>.rtree. Everything is little endian:
+//
+//   header (64 bytes)
+//     0  char[6]   "mapnik"
+//     6  uint16    version (2)
+//     8  uint32    node size, entries per node
+//     12 uint32    reserved
+//     16 uint64    number of shapes
+//     24 double[4] extent of all shapes
+//     56 uint64    reserved
+//   nodes, node size entries of 40 bytes each
+//     double[4] minx, miny, maxx, maxy
+//     uint64    shp record offset (leaves) or node number (inner nodes)
+//
+// Shapes are sorted along the Hilbert curve of their centres and packed into
+// full leaves, leaves first and every level above them after the previous one,
+// so the root is the last node. Only the last node of a level can have fewer
+// entries, the unused ones are zero filled. Node sizes and counts follow from
+// the header, nodes are 8 byte aligned and can be read straight from a mapping.
+namespace shp_rtree_format {
+
+static const unsigned header_size = 64;
+static const unsigned entry_size = 40;
+static const std::uint16_t version = 2;
+
+// Number of entries on every level, leaves first; the last level is the root
+inline std::vector<std::uint64_t> level_entries(std::uint64_t count, std::uint32_t node_size)
+{
+    std::vector<std::uint64_t> levels;
+    if (count == 0 || node_size < 2) return levels;
+    levels.push_back(count);
+    while (count > node_size)
+    {
+        count = (count + node_size - 1) / node_size;
+        levels.push_back(count);
+    }
+    return levels;
+}
+
+inline std::uint64_t read_uint64_ndr(const char* data)
+{
+    std::int32_t lo, hi;
+    mapnik::read_int32_ndr(data, lo);
+    mapnik::read_int32_ndr(data + 4, hi);
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(lo)) |
+        static_cast<std::uint64_t>(static_cast<std::uint32_t>(hi)) << 32;
+}
+
+struct header
+{
+    std::uint32_t node_size = 0;
+    std::uint64_t count = 0;
+    box2d<double> extent;
+
+    bool read(const char* data, std::uint64_t file_size)
+    {
+        if (file_size < header_size || std::memcmp(data, "mapnik", 6) != 0) return false;
+        std::int16_t ver;
+        mapnik::read_int16_ndr(data + 6, ver);
+        if (ver != version) return false;
+        std::int32_t size;
+        mapnik::read_int32_ndr(data + 8, size);
+        node_size = static_cast<std::uint32_t>(size);
+        count = read_uint64_ndr(data + 16);
+        double minx, miny, maxx, maxy;
+        mapnik::read_double_ndr(data + 24, minx);
+        mapnik::read_double_ndr(data + 32, miny);
+        mapnik::read_double_ndr(data + 40, maxx);
+        mapnik::read_double_ndr(data + 48, maxy);
+        extent.init(minx, miny, maxx, maxy);
+        if (node_size < 2 || count > (file_size - header_size) / entry_size) return false;
+        return file_size == header_size + num_nodes() * node_size * entry_size;
+    }
+
+    std::uint64_t num_nodes() const
+    {
+        std::uint64_t nodes = 0;
+        for (auto entries : level_entries(count, node_size))
+        {
+            nodes += (entries + node_size - 1) / node_size;
+        }
+        return nodes;
+    }
+};
+
+// Reads and checks the header of an opened index file
+inline bool read_header(shape_file & file, header & hdr)
+{
+#ifdef SHAPE_MEMORY_MAPPED_FILE
+    return hdr.read(file.file().buffer().first, file.file().buffer().second);
+#else
+    auto & stream = file.file();
+    stream.clear();
+    stream.seekg(0, std::ios::end);
+    std::uint64_t file_size = static_cast<std::uint64_t>(stream.tellg());
+    char data[header_size];
+    stream.seekg(0, std::ios::beg);
+    return file_size >= header_size && stream.read(data, header_size) && hdr.read(data, file_size);
+#endif
+}
+
+}
+
+template <typename filterT>
+class shp_rtree
+{
+public:
+    // Appends the record offsets of the shapes whose box passes the filter.
+    // Returns false when the file isn't a valid r-tree index.
+    static bool query(filterT const& filter, shape_file & file, std::vector<std::streampos> & pos);
+private:
+    shp_rtree();
+    template <typename NodeReader>
+    static void search(filterT const& filter, shp_rtree_format::header const& hdr,
+                       NodeReader & read_node, std::vector<std::streampos> & pos);
+};
+
+template <typename filterT>
+template <typename NodeReader>
+void shp_rtree<filterT>::search(filterT const& filter, shp_rtree_format::header const& hdr,
+                                NodeReader & read_node, std::vector<std::streampos> & pos)
+{
+    using namespace shp_rtree_format;
+    std::vector<std::uint64_t> levels = level_entries(hdr.count, hdr.node_size);
+    if (levels.empty()) return;
+    // first node number of every level
+    std::vector<std::uint64_t> first_node(levels.size(), 0);
+    for (std::size_t level = 1; level < levels.size(); ++level)
+    {
+        first_node[level] = first_node[level - 1] + (levels[level - 1] + hdr.node_size - 1) / hdr.node_size;
+    }
+
+    // (node, level) pairs left to visit, depth first from the root
+    std::vector<std::pair<std::uint64_t, std::size_t>> stack;
+    stack.emplace_back(first_node.back(), levels.size() - 1);
+    while (!stack.empty())
+    {
+        std::uint64_t node = stack.back().first;
+        std::size_t level = stack.back().second;
+        stack.pop_back();
+        std::uint64_t first_entry = (node - first_node[level]) * hdr.node_size;
+        if (first_entry >= levels[level]) continue; // corrupt child pointer
+        std::uint64_t entries = std::min<std::uint64_t>(hdr.node_size, levels[level] - first_entry);
+        const char* data = read_node(node);
+        if (!data) return;
+        for (std::uint64_t i = 0; i < entries; ++i, data += entry_size)
+        {
+            double minx, miny, maxx, maxy;
+            mapnik::read_double_ndr(data, minx);
+            mapnik::read_double_ndr(data + 8, miny);
+            mapnik::read_double_ndr(data + 16, maxx);
+            mapnik::read_double_ndr(data + 24, maxy);
+            if (!filter.pass(box2d<double>(minx, miny, maxx, maxy))) continue;
+            std::uint64_t value = read_uint64_ndr(data + 32);
+            if (level == 0)
+            {
+                pos.push_back(static_cast<std::streamoff>(value));
+            }
+            else if (value >= first_node[level - 1] && value < first_node[level])
+            {
+                stack.emplace_back(value, level - 1);
+            }
+        }
+    }
+}
+
+template <typename filterT>
+bool shp_rtree<filterT>::query(filterT const& filter, shape_file & file, std::vector<std::streampos> & pos)
+{
+    using namespace shp_rtree_format;
+    header hdr;
+    if (!read_header(file, hdr)) return false;
+    std::uint64_t node_bytes = std::uint64_t(hdr.node_size) * entry_size;
+#ifdef SHAPE_MEMORY_MAPPED_FILE
+    // nodes are read in place from the mapping
+    const char* base = file.file().buffer().first;
+    auto read_node = [&](std::uint64_t node) -> const char*
+    {
+        return base + header_size + node * node_bytes;
+    };
+    search(filter, hdr, read_node, pos);
+#else
+    auto & stream = file.file();
+    std::vector<char> buffer(node_bytes);
+    auto read_node = [&](std::uint64_t node) -> const char*
+    {
+        stream.seekg(static_cast<std::streamoff>(header_size + node * node_bytes), std::ios::beg);
+        if (!stream.read(buffer.data(), node_bytes)) return nullptr;
+        return buffer.data();
+    };
+    search(filter, hdr, read_node, pos);
+#endif
+    return true;
+}
+
+#endif // SHP_RTREE_HPP
@@ -43,6 +43,8 @@
 #include <mapnik/image_filter.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_any.hpp>
+#include <mapnik/image_buffer_pool.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 // agg
 #include "agg_rendering_buffer.h"
 #include "agg_pixfmt_rgba.h"
@@ -72,6 +74,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      solid_(false),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
 {
     setup(m);
@@ -87,6 +90,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, request const& req, attributes c
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      solid_(false),
       common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
 {
     setup(m);
@@ -103,6 +107,7 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
+      solid_(false),
       common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector)
 {
     setup(m);
@@ -153,6 +158,10 @@ struct setup_agg_bg_visitor
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::setup(Map const &m)
 {
+    if (m.deferred_labels())
+    {
+        deferred_labels_.reset(new deferred_labels);
+    }
     mapnik::set_premultiplied_alpha(pixmap_, true);
     boost::optional<color> const& bg = m.background();
     if (bg)
@@ -172,6 +181,8 @@ void agg_renderer<T0,T1>::setup(Map const &m)
     }
 
     boost::optional<std::string> const& image_filename = m.background_image();
+    // a plain background colour leaves the image solid until something is drawn
+    solid_ = bg && !image_filename;
     if (image_filename)
     {
         // NOTE: marker_cache returns premultiplied image, if needed
@@ -198,6 +209,10 @@ void agg_renderer<T0,T1>::start_map_processing(Map const& map)
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::end_map_processing(Map const& )
 {
+    if (deferred_labels_)
+    {
+        render_deferred_labels();
+    }
     mapnik::demultiply_alpha(pixmap_);
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End map processing";
 }
@@ -214,6 +229,11 @@ void agg_renderer<T0,T1>::start_layer_processing(layer const& lay, box2d<double>
         common_.detector_->clear();
     }
 
+    if (deferred_labels_)
+    {
+        deferred_labels_->start_layer(lay.clear_label_cache());
+    }
+
     common_.query_extent_ = query_extent;
     boost::optional<box2d<double> > const& maximum_extent = lay.maximum_extent();
     if (maximum_extent)
@@ -222,6 +242,36 @@ void agg_renderer<T0,T1>::start_layer_processing(layer const& lay, box2d<double>
     }
 }
 
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::render_deferred_labels()
+{
+    MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: Start placing deferred labels";
+    // labels are rendered straight into the target image, style level
+    // compositing and image filters do not apply to them
+    current_buffer_ = &pixmap_;
+    common_.t_.set_offset(0);
+    ras_ptr->clip_box(0,0,common_.width_,common_.height_);
+    unsigned group = 0;
+    for (deferred_labels::candidate const& c : deferred_labels_->sorted())
+    {
+        // a later group comes from a layer with clear-label-cache
+        if (c.group != group)
+        {
+            common_.detector_->clear();
+            group = c.group;
+        }
+        if (c.text_sym)
+        {
+            render_label(*c.text_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+        else
+        {
+            render_label(*c.shield_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+    }
+    deferred_labels_->clear();
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::end_layer_processing(layer const&)
 {
@@ -263,22 +313,23 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
                (internal_buffer_->width() < target_width ||
                 internal_buffer_->height() < target_height))
             {
-                internal_buffer_ = std::make_shared<buffer_type>(target_width,target_height);
+                internal_buffer_.reset();
+                internal_buffer_ = image_buffer_pool::instance().acquire(target_width,target_height);
             }
             else
             {
-                mapnik::fill(*internal_buffer_, 0); // fill with transparent colour
+                clear_painted(*internal_buffer_); // back to transparent
             }
         }
         else
         {
             if (!internal_buffer_)
             {
-                internal_buffer_ = std::make_shared<buffer_type>(common_.width_,common_.height_);
+                internal_buffer_ = image_buffer_pool::instance().acquire(common_.width_,common_.height_);
             }
             else
             {
-                mapnik::fill(*internal_buffer_, 0); // fill with transparent colour
+                clear_painted(*internal_buffer_); // back to transparent
             }
             common_.t_.set_offset(0);
             ras_ptr->clip_box(0,0,common_.width_,common_.height_);
@@ -297,6 +348,12 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
 {
+    // compositing even an empty style buffer (e.g. dst-in) or filtering
+    // the image may change it
+    if (style_level_compositing_ || !st.direct_image_filters().empty())
+    {
+        solid_ = false;
+    }
     if (style_level_compositing_)
     {
         bool blend_from = false;
@@ -526,6 +583,7 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
                                     double opacity,
                                     composite_mode_e comp_op)
 {
+    solid_ = false;
     agg_render_marker_visitor<buffer_type> visitor(common_,
                                                    current_buffer_,
                                                    ras_ptr, 
@@ -547,9 +605,16 @@ bool agg_renderer<T0,T1>::painted()
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::painted(bool painted)
 {
+    if (painted) solid_ = false;
     pixmap_.painted(painted);
 }
 
+template <typename T0, typename T1>
+bool agg_renderer<T0,T1>::solid() const
+{
+    return solid_;
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::debug_draw_box(box2d<double> const& box,
                                      double x, double y, double angle)
@@ -28,6 +28,7 @@
 #include <mapnik/pixel_position.hpp>
 #include <mapnik/text/renderer.hpp>
 #include <mapnik/renderer_common/clipping_extent.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 
 namespace mapnik {
 
@@ -40,6 +41,22 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
     agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
     if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+    if (deferred_labels_)
+    {
+        double priority = get<double>(sym, keys::priority, feature, common_.vars_, 0.0);
+        deferred_labels_->add(sym, priority, feature, prj_trans, clip_box, tr);
+        return;
+    }
+    render_label(sym, feature, prj_trans, clip_box, tr);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::render_label(shield_symbolizer const& sym,
+                                       mapnik::feature_impl const& feature,
+                                       proj_transform const& prj_trans,
+                                       box2d<double> const& clip_box,
+                                       agg::trans_affine const& tr)
+{
     text_symbolizer_helper helper(
         sym, feature, common_.vars_, prj_trans,
         common_.width_, common_.height_,
@@ -78,5 +95,10 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
 template void agg_renderer<image_rgba8>::process(shield_symbolizer const&,
                                               mapnik::feature_impl &,
                                               proj_transform const&);
+template void agg_renderer<image_rgba8>::render_label(shield_symbolizer const&,
+                                                   mapnik::feature_impl const&,
+                                                   proj_transform const&,
+                                                   box2d<double> const&,
+                                                   agg::trans_affine const&);
 
 }
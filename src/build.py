@@ -150,6 +150,7 @@ source = Split(
     params.cpp
     image_filter_types.cpp
     miniz_png.cpp
+    png_filter.cpp
     color.cpp
     conversions.cpp
     image_copy.cpp
@@ -206,12 +207,14 @@ source = Split(
     unicode.cpp
     raster_colorizer.cpp
     mapped_memory_cache.cpp
+    image_buffer_pool.cpp
     marker_cache.cpp
     svg/svg_parser.cpp
     svg/svg_path_parser.cpp
     svg/svg_points_parser.cpp
     svg/svg_transform_parser.cpp
     warp.cpp
+    warp_mesh_cache.cpp
     css_color_grammar.cpp
     vertex_cache.cpp
     text/font_library.cpp
@@ -248,6 +251,7 @@ source = Split(
     renderer_common/render_pattern.cpp
     renderer_common/process_group_symbolizer.cpp
     math.cpp
+    parallel.cpp
     """
     )
 
@@ -36,6 +36,7 @@
 #include <mapnik/label_collision_detector.hpp>
 #include <mapnik/marker.hpp>
 #include <mapnik/marker_cache.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 
 // agg
 #include "agg/include/agg_trans_affine.h"  // for trans_affine, etc
@@ -138,6 +139,10 @@ struct setup_marker_visitor
 template <typename T>
 void cairo_renderer<T>::setup(Map const& map)
 {
+    if (map.deferred_labels())
+    {
+        deferred_labels_.reset(new deferred_labels);
+    }
     boost::optional<color> bg = m_.background();
     if (bg)
     {
@@ -167,6 +172,10 @@ void cairo_renderer<T>::start_map_processing(Map const& map)
 template <typename T>
 void cairo_renderer<T>::end_map_processing(Map const&)
 {
+    if (deferred_labels_)
+    {
+        render_deferred_labels();
+    }
     MAPNIK_LOG_DEBUG(cairo_renderer) << "cairo_renderer: End map processing";
 }
 
@@ -181,9 +190,38 @@ void cairo_renderer<T>::start_layer_processing(layer const& lay, box2d<double> c
     {
         common_.detector_->clear();
     }
+    if (deferred_labels_)
+    {
+        deferred_labels_->start_layer(lay.clear_label_cache());
+    }
     common_.query_extent_ = query_extent;
 }
 
+template <typename T>
+void cairo_renderer<T>::render_deferred_labels()
+{
+    MAPNIK_LOG_DEBUG(cairo_renderer) << "cairo_renderer: Start placing deferred labels";
+    unsigned group = 0;
+    for (deferred_labels::candidate const& c : deferred_labels_->sorted())
+    {
+        // a later group comes from a layer with clear-label-cache
+        if (c.group != group)
+        {
+            common_.detector_->clear();
+            group = c.group;
+        }
+        if (c.text_sym)
+        {
+            render_label(*c.text_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+        else
+        {
+            render_label(*c.shield_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+    }
+    deferred_labels_->clear();
+}
+
 template <typename T>
 void cairo_renderer<T>::end_layer_processing(layer const&)
 {
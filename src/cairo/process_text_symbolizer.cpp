@@ -27,6 +27,7 @@
 #include <mapnik/text/symbolizer_helpers.hpp>
 #include <mapnik/pixel_position.hpp>
 #include <mapnik/symbolizer.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 
 namespace mapnik
 {
@@ -42,12 +43,28 @@ void cairo_renderer<T>::process(shield_symbolizer const& sym,
     agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
     if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+    if (deferred_labels_)
+    {
+        double priority = get<double>(sym, keys::priority, feature, common_.vars_, 0.0);
+        deferred_labels_->add(sym, priority, feature, prj_trans, common_.query_extent_, tr);
+        return;
+    }
+    render_label(sym, feature, prj_trans, common_.query_extent_, tr);
+}
+
+template <typename T>
+void cairo_renderer<T>::render_label(shield_symbolizer const& sym,
+                                     mapnik::feature_impl const& feature,
+                                     proj_transform const& prj_trans,
+                                     box2d<double> const& clip_box,
+                                     agg::trans_affine const& tr)
+{
     text_symbolizer_helper helper(
             sym, feature, common_.vars_, prj_trans,
             common_.width_, common_.height_,
             common_.scale_factor_,
             common_.t_, common_.font_manager_, *common_.detector_,
-            common_.query_extent_, tr);
+            clip_box, tr);
 
     cairo_save_restore guard(context_);
     composite_mode_e comp_op = get<composite_mode_e>(sym, keys::comp_op, feature, common_.vars_, src_over);
@@ -72,6 +89,11 @@ void cairo_renderer<T>::process(shield_symbolizer const& sym,
 template void cairo_renderer<cairo_ptr>::process(shield_symbolizer const&,
                                                  mapnik::feature_impl &,
                                                  proj_transform const&);
+template void cairo_renderer<cairo_ptr>::render_label(shield_symbolizer const&,
+                                                      mapnik::feature_impl const&,
+                                                      proj_transform const&,
+                                                      box2d<double> const&,
+                                                      agg::trans_affine const&);
 
 template <typename T>
 void cairo_renderer<T>::process(text_symbolizer const& sym,
@@ -81,12 +103,28 @@ void cairo_renderer<T>::process(text_symbolizer const& sym,
     agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
     if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+    if (deferred_labels_)
+    {
+        double priority = get<double>(sym, keys::priority, feature, common_.vars_, 0.0);
+        deferred_labels_->add(sym, priority, feature, prj_trans, common_.query_extent_, tr);
+        return;
+    }
+    render_label(sym, feature, prj_trans, common_.query_extent_, tr);
+}
+
+template <typename T>
+void cairo_renderer<T>::render_label(text_symbolizer const& sym,
+                                     mapnik::feature_impl const& feature,
+                                     proj_transform const& prj_trans,
+                                     box2d<double> const& clip_box,
+                                     agg::trans_affine const& tr)
+{
     text_symbolizer_helper helper(
             sym, feature, common_.vars_, prj_trans,
             common_.width_, common_.height_,
             common_.scale_factor_,
             common_.t_, common_.font_manager_, *common_.detector_,
-            common_.query_extent_, tr);
+            clip_box, tr);
 
     cairo_save_restore guard(context_);
     composite_mode_e comp_op = get<composite_mode_e>(sym, keys::comp_op, feature, common_.vars_,  src_over);
@@ -102,6 +140,11 @@ void cairo_renderer<T>::process(text_symbolizer const& sym,
 template void cairo_renderer<cairo_ptr>::process(text_symbolizer const&,
                                                  mapnik::feature_impl &,
                                                  proj_transform const&);
+template void cairo_renderer<cairo_ptr>::render_label(text_symbolizer const&,
+                                                      mapnik::feature_impl const&,
+                                                      proj_transform const&,
+                                                      box2d<double> const&,
+                                                      agg::trans_affine const&);
 
 }
 
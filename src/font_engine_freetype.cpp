@@ -366,7 +366,8 @@ face_manager::face_manager(font_library & library,
     : face_ptr_cache_(),
       library_(library),
       font_file_mapping_(font_file_mapping),
-      font_memory_cache_(font_cache)
+      font_memory_cache_(font_cache),
+      layout_cache_()
       {
             FT_Stroker s;
             FT_Error error = FT_Stroker_New(library_.get(), &s);
@@ -399,6 +400,25 @@ face_ptr face_manager::get_face(std::string const& name)
     }
 }
 
+std::shared_ptr<text_layout> face_manager::get_layout(std::string const& key) const
+{
+    auto itr = layout_cache_.find(key);
+    if (itr != layout_cache_.end())
+    {
+        return itr->second;
+    }
+    return std::shared_ptr<text_layout>();
+}
+
+void face_manager::add_layout(std::string const& key, std::shared_ptr<text_layout> const& layout)
+{
+    // bound memory use for renders with mostly unique labels
+    if (layout_cache_.size() < 4096)
+    {
+        layout_cache_.emplace(key, layout);
+    }
+}
+
 face_set_ptr face_manager::get_face_set(std::string const& name)
 {
     face_set_ptr face_set = std::make_unique<font_face_set>();
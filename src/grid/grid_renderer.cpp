@@ -46,6 +46,7 @@
 #include <mapnik/svg/svg_renderer_agg.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
 #include <mapnik/pixel_position.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 
 // boost
 #include <boost/math/special_functions/round.hpp>
@@ -80,7 +81,10 @@ template <typename T>
 void grid_renderer<T>::setup(Map const& m)
 {
     MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: Scale=" << m.scale();
-    // nothing to do for grids yet on setup
+    if (m.deferred_labels())
+    {
+        deferred_labels_.reset(new deferred_labels);
+    }
 }
 
 template <typename T>
@@ -97,6 +101,10 @@ void grid_renderer<T>::start_map_processing(Map const& m)
 template <typename T>
 void grid_renderer<T>::end_map_processing(Map const& /*m*/)
 {
+    if (deferred_labels_)
+    {
+        render_deferred_labels();
+    }
     MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: End map processing";
 }
 
@@ -111,6 +119,10 @@ void grid_renderer<T>::start_layer_processing(layer const& lay, box2d<double> co
     {
         common_.detector_->clear();
     }
+    if (deferred_labels_)
+    {
+        deferred_labels_->start_layer(lay.clear_label_cache());
+    }
     common_.query_extent_ = query_extent;
     boost::optional<box2d<double> > const& maximum_extent = lay.maximum_extent();
     if (maximum_extent)
@@ -119,6 +131,31 @@ void grid_renderer<T>::start_layer_processing(layer const& lay, box2d<double> co
     }
 }
 
+template <typename T>
+void grid_renderer<T>::render_deferred_labels()
+{
+    MAPNIK_LOG_DEBUG(grid_renderer) << "grid_renderer: Start placing deferred labels";
+    unsigned group = 0;
+    for (deferred_labels::candidate const& c : deferred_labels_->sorted())
+    {
+        // a later group comes from a layer with clear-label-cache
+        if (c.group != group)
+        {
+            common_.detector_->clear();
+            group = c.group;
+        }
+        if (c.text_sym)
+        {
+            render_label(*c.text_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+        else
+        {
+            render_label(*c.shield_sym, *c.feature, *c.prj_trans, c.clip_box, c.tr);
+        }
+    }
+    deferred_labels_->clear();
+}
+
 template <typename T>
 void grid_renderer<T>::end_layer_processing(layer const&)
 {
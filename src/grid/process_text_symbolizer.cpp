@@ -29,6 +29,7 @@
 #include <mapnik/pixel_position.hpp>
 #include <mapnik/text/renderer.hpp>
 #include <mapnik/renderer_common/clipping_extent.hpp>
+#include <mapnik/renderer_common/deferred_labels.hpp>
 
 namespace mapnik {
 
@@ -41,6 +42,22 @@ void grid_renderer<T>::process(text_symbolizer const& sym,
     agg::trans_affine tr;
     auto transform = get_optional<transform_type>(sym, keys::geometry_transform);
     if (transform) evaluate_transform(tr, feature, common_.vars_, *transform, common_.scale_factor_);
+    if (deferred_labels_)
+    {
+        double priority = get<double>(sym, keys::priority, feature, common_.vars_, 0.0);
+        deferred_labels_->add(sym, priority, feature, prj_trans, clip_box, tr);
+        return;
+    }
+    render_label(sym, feature, prj_trans, clip_box, tr);
+}
+
+template <typename T>
+void grid_renderer<T>::render_label(text_symbolizer const& sym,
+                                    mapnik::feature_impl const& feature,
+                                    proj_transform const& prj_trans,
+                                    box2d<double> const& clip_box,
+                                    agg::trans_affine const& tr)
+{
     text_symbolizer_helper helper(
         sym, feature, common_.vars_, prj_trans,
         common_.width_, common_.height_,
@@ -81,6 +98,11 @@ void grid_renderer<T>::process(text_symbolizer const& sym,
 template void grid_renderer<grid>::process(text_symbolizer const&,
                                            mapnik::feature_impl &,
                                            proj_transform const&);
+template void grid_renderer<grid>::render_label(text_symbolizer const&,
+                                                mapnik::feature_impl const&,
+                                                proj_transform const&,
+                                                box2d<double> const&,
+                                                agg::trans_affine const&);
 
 }
 
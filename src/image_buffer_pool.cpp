@@ -0,0 +1,223 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/image_buffer_pool.hpp>
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <utility>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
+
+namespace mapnik
+{
+
+namespace {
+
+using pixel_type = image_rgba8::pixel_type;
+
+// index of the first non zero pixel in [x, width), width if there is none
+std::size_t first_painted(pixel_type const* row, std::size_t x, std::size_t width)
+{
+#ifdef SSE_MATH
+    __m128i const zero = _mm_setzero_si128();
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x)),
+                                 _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x + 4)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xffff) break;
+    }
+#endif
+    while (x < width && row[x] == 0) ++x;
+    return x;
+}
+
+// one past the last non zero pixel in [begin, end), begin if there is none
+std::size_t last_painted(pixel_type const* row, std::size_t begin, std::size_t end)
+{
+#ifdef SSE_MATH
+    __m128i const zero = _mm_setzero_si128();
+    for (; end >= begin + 8; end -= 8)
+    {
+        __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(row + end - 8)),
+                                 _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + end - 4)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xffff) break;
+    }
+#endif
+    while (end > begin && row[end - 1] == 0) --end;
+    return end;
+}
+
+}
+
+void clear_painted(image_rgba8 & image)
+{
+    std::size_t width = image.width();
+    std::size_t height = image.height();
+    std::size_t x0 = width;
+    std::size_t x1 = 0;
+    std::size_t y0 = height;
+    std::size_t y1 = 0;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        pixel_type const* row = image.getRow(y);
+        std::size_t first = first_painted(row, 0, width);
+        if (first == width) continue;
+        // pixels left of x1 are cleared anyway
+        std::size_t last = last_painted(row, std::max(first, x1), width);
+        x0 = std::min(x0, first);
+        x1 = std::max(x1, last);
+        y0 = std::min(y0, y);
+        y1 = y + 1;
+    }
+    for (std::size_t y = y0; y < y1; ++y)
+    {
+        pixel_type * row = image.getRow(y);
+        std::fill(row + x0, row + x1, 0);
+    }
+}
+
+struct image_buffer_pool::store
+{
+    using key_type = std::pair<unsigned, unsigned>;
+    std::multimap<key_type, std::unique_ptr<image_rgba8> > idle;
+    std::size_t idle_bytes = 0;
+    std::size_t max_bytes = 64 * 1024 * 1024;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex;
+#endif
+
+    void release(std::unique_ptr<image_rgba8> buffer)
+    {
+        std::size_t bytes = buffer->getSize();
+        {
+#ifdef MAPNIK_THREADSAFE
+            mapnik::scoped_lock lock(mutex);
+#endif
+            if (bytes > max_bytes) return;
+        }
+        clear_painted(*buffer);
+        buffer->set_premultiplied(false);
+        buffer->painted(false);
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex);
+#endif
+        if (idle_bytes + bytes <= max_bytes)
+        {
+            idle_bytes += bytes;
+            idle.emplace(key_type(buffer->width(), buffer->height()), std::move(buffer));
+        }
+    }
+};
+
+image_buffer_pool::image_buffer_pool()
+    : store_(std::make_shared<store>()) {}
+
+image_buffer_pool::~image_buffer_pool() {}
+
+image_buffer_pool::buffer_ptr image_buffer_pool::acquire(unsigned width, unsigned height)
+{
+    std::unique_ptr<image_rgba8> buffer;
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(store_->mutex);
+#endif
+        auto itr = store_->idle.find(store::key_type(width, height));
+        if (itr != store_->idle.end())
+        {
+            buffer = std::move(itr->second);
+            store_->idle_bytes -= buffer->getSize();
+            store_->idle.erase(itr);
+        }
+    }
+    if (!buffer)
+    {
+        buffer.reset(new image_rgba8(width, height));
+    }
+    std::weak_ptr<store> pool(store_);
+    return buffer_ptr(buffer.release(), [pool](image_rgba8 * p)
+    {
+        std::unique_ptr<image_rgba8> owned(p);
+        std::shared_ptr<store> s = pool.lock();
+        if (!s) return;
+        try
+        {
+            s->release(std::move(owned));
+        }
+        catch (...)
+        {
+            // not pooling a buffer is harmless, throwing from a deleter is not
+        }
+    });
+}
+
+void image_buffer_pool::set_max_bytes(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(store_->mutex);
+#endif
+    store_->max_bytes = bytes;
+    // drop the widest buffers first until the idle ones fit
+    while (store_->idle_bytes > bytes && !store_->idle.empty())
+    {
+        auto itr = std::prev(store_->idle.end());
+        store_->idle_bytes -= itr->second->getSize();
+        store_->idle.erase(itr);
+    }
+}
+
+std::size_t image_buffer_pool::max_bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(store_->mutex);
+#endif
+    return store_->max_bytes;
+}
+
+std::size_t image_buffer_pool::idle_bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(store_->mutex);
+#endif
+    return store_->idle_bytes;
+}
+
+void image_buffer_pool::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(store_->mutex);
+#endif
+    store_->idle.clear();
+    store_->idle_bytes = 0;
+}
+
+}
@@ -42,6 +42,12 @@
 #include "agg_pixfmt_gray.h"
 #include "agg_color_rgba.h"
 
+// stl
+#include <cstdint>
+
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 namespace mapnik
 {
@@ -146,6 +152,237 @@ struct rendering_buffer
     image_type const& data_;
 };
 
+#ifdef SSE_MATH
+
+// Row kernels for the most used modes. Each computes exactly what the agg
+// comp_op_rgba_* functor of the same name does per pixel, integer rounding and
+// 8 bit wrap around included, on four pixels at a time. Pixels are widened to
+// 16 bit lanes, two per register, with alpha in lanes 3 and 7.
+
+inline __m128i alpha_lanes(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+inline __m128i inverse(__m128i v)
+{
+    return _mm_sub_epi16(_mm_set1_epi16(255), v);
+}
+
+// (x * y + 255) >> 8 with x * y < 65281
+inline __m128i mul_255(__m128i x, __m128i y)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(255)), 8);
+}
+
+inline __m128i min_epu16(__m128i x, __m128i y)
+{
+    __m128i const bias = _mm_set1_epi16(-32768);
+    return _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias)), bias);
+}
+
+inline __m128i max_epu16(__m128i x, __m128i y)
+{
+    __m128i const bias = _mm_set1_epi16(-32768);
+    return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias)), bias);
+}
+
+// (m + s.d1a + d.s1a + 255) >> 8 in 32 bit precision, m being 16 bit lanes
+inline __m128i blend_sum(__m128i m, __m128i s, __m128i d, __m128i d1a, __m128i s1a)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const round = _mm_set1_epi32(255);
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(s, d), _mm_unpacklo_epi16(d1a, s1a));
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(s, d), _mm_unpackhi_epi16(d1a, s1a));
+    lo = _mm_add_epi32(_mm_add_epi32(lo, _mm_unpacklo_epi16(m, zero)), round);
+    hi = _mm_add_epi32(_mm_add_epi32(hi, _mm_unpackhi_epi16(m, zero)), round);
+    return _mm_packs_epi32(_mm_srli_epi32(lo, 8), _mm_srli_epi32(hi, 8));
+}
+
+// color lanes from `color`, alpha lanes from `alpha`
+inline __m128i merge_alpha(__m128i color, __m128i alpha)
+{
+    __m128i const mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    return _mm_or_si128(_mm_and_si128(mask, alpha), _mm_andnot_si128(mask, color));
+}
+
+// Da' = Sa + Da - Sa.Da, also the color formula of screen
+inline __m128i screen_lanes(__m128i s, __m128i d)
+{
+    return _mm_sub_epi16(_mm_add_epi16(s, d), mul_255(s, d));
+}
+
+struct sse_src_over
+{
+    using agg_op = agg::comp_op_rgba_src_over<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = false;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        return _mm_add_epi16(s, mul_255(d, inverse(alpha_lanes(s))));
+    }
+};
+
+struct sse_dst_out
+{
+    using agg_op = agg::comp_op_rgba_dst_out<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = false;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        // agg rounds with + base_shift here
+        __m128i r = _mm_mullo_epi16(d, inverse(alpha_lanes(s)));
+        return _mm_srli_epi16(_mm_add_epi16(r, _mm_set1_epi16(8)), 8);
+    }
+};
+
+struct sse_plus
+{
+    using agg_op = agg::comp_op_rgba_plus<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = true;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        return _mm_min_epi16(_mm_add_epi16(s, d), _mm_set1_epi16(255));
+    }
+};
+
+struct sse_screen
+{
+    using agg_op = agg::comp_op_rgba_screen<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = true;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        return screen_lanes(s, d);
+    }
+};
+
+struct sse_multiply
+{
+    using agg_op = agg::comp_op_rgba_multiply<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = true;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        // Sca.Dca + Sca.(1 - Da) + Dca.(1 - Sa) == Sca.(Dca + 1 - Da) + Dca.(1 - Sa)
+        __m128i const zero = _mm_setzero_si128();
+        __m128i d1a = inverse(alpha_lanes(d));
+        __m128i color = blend_sum(zero, s, d, _mm_add_epi16(d, d1a), inverse(alpha_lanes(s)));
+        return merge_alpha(color, screen_lanes(s, d));
+    }
+};
+
+struct sse_darken
+{
+    using agg_op = agg::comp_op_rgba_darken<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = true;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        __m128i sa = alpha_lanes(s);
+        __m128i da = alpha_lanes(d);
+        __m128i m = min_epu16(_mm_mullo_epi16(s, da), _mm_mullo_epi16(d, sa));
+        return merge_alpha(blend_sum(m, s, d, inverse(da), inverse(sa)), screen_lanes(s, d));
+    }
+};
+
+struct sse_lighten
+{
+    using agg_op = agg::comp_op_rgba_lighten<agg::rgba8, agg::order_rgba>;
+    static const bool skip_transparent = true;
+    static __m128i blend(__m128i s, __m128i d)
+    {
+        __m128i sa = alpha_lanes(s);
+        __m128i da = alpha_lanes(d);
+        __m128i m = max_epu16(_mm_mullo_epi16(s, da), _mm_mullo_epi16(d, sa));
+        return merge_alpha(blend_sum(m, s, d, inverse(da), inverse(sa)), screen_lanes(s, d));
+    }
+};
+
+template <typename Op>
+void composite_row(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const cover_lanes = _mm_set1_epi16(static_cast<short>(cover));
+    __m128i const low_byte = _mm_set1_epi16(0xff);
+    __m128i const alpha_byte = _mm_set1_epi32(0xff000000);
+    unsigned x = 0;
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + 4 * x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + 4 * x));
+        __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+        __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+        if (cover < 255)
+        {
+            s_lo = mul_255(s_lo, cover_lanes);
+            s_hi = mul_255(s_hi, cover_lanes);
+            s = _mm_packus_epi16(s_lo, s_hi);
+        }
+        __m128i r_lo = Op::blend(s_lo, _mm_unpacklo_epi8(d, zero));
+        __m128i r_hi = Op::blend(s_hi, _mm_unpackhi_epi8(d, zero));
+        // results are truncated to 8 bits like the value_type casts in agg
+        __m128i r = _mm_packus_epi16(_mm_and_si128(r_lo, low_byte), _mm_and_si128(r_hi, low_byte));
+        if (Op::skip_transparent)
+        {
+            __m128i keep = _mm_cmpeq_epi32(_mm_and_si128(s, alpha_byte), zero);
+            r = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, r));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), r);
+    }
+    for (; x < len; ++x)
+    {
+        std::uint8_t const* p = src + 4 * x;
+        Op::agg_op::blend_pix(dst + 4 * x, p[0], p[1], p[2], p[3], cover);
+    }
+}
+
+using composite_row_func = void (*)(std::uint8_t *, std::uint8_t const*, unsigned, unsigned);
+
+inline composite_row_func composite_row_kernel(composite_mode_e mode)
+{
+    switch (mode)
+    {
+    case src_over: return &composite_row<sse_src_over>;
+    case dst_out: return &composite_row<sse_dst_out>;
+    case plus: return &composite_row<sse_plus>;
+    case multiply: return &composite_row<sse_multiply>;
+    case screen: return &composite_row<sse_screen>;
+    case darken: return &composite_row<sse_darken>;
+    case lighten: return &composite_row<sse_lighten>;
+    default: return nullptr;
+    }
+}
+
+// pixfmt_custom_blend_rgba handing rows to a kernel when there is one for the mode
+template <typename Blender, typename RenBuf>
+class pixfmt_composite_rgba : public agg::pixfmt_custom_blend_rgba<Blender, RenBuf>
+{
+    using base_type = agg::pixfmt_custom_blend_rgba<Blender, RenBuf>;
+public:
+    pixfmt_composite_rgba(RenBuf & rb, composite_row_func kernel)
+        : base_type(rb),
+          kernel_(kernel) {}
+
+    template <typename SrcPixelFormatRenderer>
+    void blend_from(SrcPixelFormatRenderer const& from,
+                    int xdst, int ydst,
+                    int xsrc, int ysrc,
+                    unsigned len,
+                    agg::int8u cover)
+    {
+        std::uint8_t const* psrc = from.row_ptr(ysrc);
+        if (kernel_ && psrc)
+        {
+            kernel_(this->pix_ptr(xdst, ydst), psrc + (xsrc << 2), len, cover);
+        }
+        else
+        {
+            base_type::blend_from(from, xdst, ydst, xsrc, ysrc, len, cover);
+        }
+    }
+
+private:
+    composite_row_func kernel_;
+};
+
+#endif
+
 } // end detail ns
 
 template <>
@@ -158,12 +395,21 @@ MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_
     using order = agg::order_rgba;
     using const_rendering_buffer = detail::rendering_buffer<image_rgba8>;
     using blender_type = agg::comp_op_adaptor_rgba_pre<color, order>;
+#ifdef SSE_MATH
+    using pixfmt_type = detail::pixfmt_composite_rgba<blender_type, agg::rendering_buffer>;
+#else
     using pixfmt_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
+#endif
     using renderer_type = agg::renderer_base<pixfmt_type>;
 
     agg::rendering_buffer dst_buffer(dst.getBytes(),dst.width(),dst.height(),dst.getRowSize());
     const_rendering_buffer src_buffer(src);
+#ifdef SSE_MATH
+    // compositing an image onto itself must keep agg's overlap aware loop
+    pixfmt_type pixf(dst_buffer, (&dst == &src) ? nullptr : detail::composite_row_kernel(mode));
+#else
     pixfmt_type pixf(dst_buffer);
+#endif
     pixf.comp_op(static_cast<agg::comp_op_e>(mode));
     agg::pixfmt_alpha_blend_rgba<agg::blender_rgba32, const_rendering_buffer, agg::pixel32_type> pixf_mask(src_buffer);
 #ifdef MAPNIK_DEBUG
@@ -24,6 +24,12 @@
 #include <mapnik/image.hpp>
 #include <mapnik/image_scaling.hpp>
 #include <mapnik/image_scaling_traits.hpp>
+#include <mapnik/utils.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/parallel.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 // does not handle alpha correctly
 //#include <mapnik/span_image_filter.hpp>
 
@@ -51,6 +57,15 @@
 #include "agg_trans_affine.h"
 #include "agg_image_filters.h"
 
+// stl
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 namespace mapnik
 {
 
@@ -97,11 +112,437 @@ boost::optional<std::string> scaling_method_to_string(scaling_method_e scaling_m
     return mode;
 }
 
+namespace {
+
+// Filter weight tables only depend on the method and its factor, so they are
+// computed once and shared by every raster scaled afterwards.
+class scaling_filter_cache :
+        public singleton<scaling_filter_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<scaling_filter_cache>;
+public:
+    using filter_ptr = std::shared_ptr<agg::image_filter_lut const>;
+
+    filter_ptr get(scaling_method_e scaling_method, double filter_factor)
+    {
+        key_type key(scaling_method, filter_factor);
+#ifdef MAPNIK_THREADSAFE
+        mapnik::scoped_lock lock(mutex_);
+#endif
+        auto itr = filters_.find(key);
+        if (itr != filters_.end()) return itr->second;
+        auto filter = std::make_shared<agg::image_filter_lut>();
+        detail::set_scaling_method(*filter, scaling_method, filter_factor);
+        // filter factors come from styles, keep the table from growing unbounded
+        if (filters_.size() >= 64) filters_.clear();
+        filters_.emplace(key, filter);
+        return filter;
+    }
+
+private:
+    using key_type = std::pair<int, double>;
+    scaling_filter_cache()
+        : filters_() {}
+    std::map<key_type, filter_ptr> filters_;
+};
+
+// Source taps of every output column (or row): the first source pixel the
+// filter touches and the weights of the pixels following it, in the order
+// agg's span_image_resample_*_affine visits them.
+struct scaling_taps
+{
+    std::vector<int> first;
+    std::vector<unsigned> offset;
+    std::vector<agg::int16> weights;
+    unsigned count(std::size_t i) const { return offset[i + 1] - offset[i]; }
+    agg::int16 const* weights_at(std::size_t i) const { return weights.data() + offset[i]; }
+};
+
+void build_taps(scaling_taps & taps, std::vector<int> const& coords,
+                int radius, int r_inv, int filter_scale, agg::int16 const* weight_array)
+{
+    taps.first.reserve(coords.size());
+    taps.offset.reserve(coords.size() + 1);
+    taps.offset.push_back(0);
+    for (int c : coords)
+    {
+        c += agg::image_subpixel_scale / 2 - radius;
+        taps.first.push_back(c >> agg::image_subpixel_shift);
+        int hr = ((agg::image_subpixel_mask - (c & agg::image_subpixel_mask)) * r_inv) >>
+            agg::image_subpixel_shift;
+        do
+        {
+            taps.weights.push_back(weight_array[hr]);
+            hr += r_inv;
+        }
+        while (hr < filter_scale);
+        taps.offset.push_back(taps.weights.size());
+    }
+}
+
+// Sub-pixel source coordinates of the output columns and rows, from the same
+// interpolator the agg span generators use.
+template <typename Interpolator>
+void scaling_coords(Interpolator & interpolator, unsigned width, unsigned height,
+                    std::vector<int> & xs, std::vector<int> & ys)
+{
+    int x, y;
+    xs.resize(width);
+    interpolator.begin(0.5, 0.5, width);
+    for (unsigned i = 0; i < width; ++i)
+    {
+        interpolator.coordinates(&x, &y);
+        xs[i] = x;
+        ++interpolator;
+    }
+    ys.resize(height);
+    for (unsigned i = 0; i < height; ++i)
+    {
+        interpolator.begin(0.5, i + 0.5, width);
+        interpolator.coordinates(&x, &y);
+        ys[i] = y;
+    }
+}
+
+// Memory positions of the colour channels, gray pixel formats have a fake int order
+template <typename Order>
+struct channel_order
+{
+    enum { R = Order::R, G = Order::G, B = Order::B, A = Order::A };
+};
+
+template <>
+struct channel_order<int>
+{
+    enum { R = 0, G = 0, B = 0, A = 0 };
+};
+
+inline int clamp_index(int i, int size)
+{
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+template <typename Color, typename Long>
+inline void store_resampled(Color & c, Long const* fg, std::true_type /* rgba */)
+{
+    c.r = static_cast<typename Color::value_type>(fg[0]);
+    c.g = static_cast<typename Color::value_type>(fg[1]);
+    c.b = static_cast<typename Color::value_type>(fg[2]);
+    c.a = static_cast<typename Color::value_type>(fg[3]);
+}
+
+template <typename Color, typename Long>
+inline void store_resampled(Color & c, Long const* fg, std::false_type /* gray */)
+{
+    c.v = static_cast<typename Color::value_type>(fg[0]);
+    c.a = Color::base_mask;
+}
+
+// Scales into a target the rasterized polygon covers completely, which is the
+// case whenever there is no sub-pixel offset. Every output pixel gets the same
+// taps, weights, rounding and clamping as agg's resampling span generators so
+// results are unchanged, but the tap positions are computed once per column
+// and row instead of once per pixel, bands of rows run in parallel and rgba8
+// accumulates its channels with SSE2. Gray images keep the scalar sum: with a
+// single channel there is nothing to share a tap weight across, 16 and 32 bit
+// values don't fit the signed 16 bit lanes of _mm_madd_epi16, and gray8 would
+// need a weight per lane, computed per tap just like the scalar loop does.
+template <typename PixFmt>
+class aligned_scaler
+{
+public:
+    using color_type = typename PixFmt::color_type;
+    using order_type = channel_order<typename PixFmt::order_type>;
+    using value_type = typename color_type::value_type;
+    using long_type = typename color_type::long_type;
+    using is_rgba = std::integral_constant<bool, PixFmt::pix_width == 4 * sizeof(value_type)>;
+    static constexpr unsigned channels = PixFmt::pix_width / sizeof(value_type);
+
+    aligned_scaler(PixFmt & pixf_dst, PixFmt const& pixf_src)
+        : pixf_dst_(pixf_dst),
+          src_(reinterpret_cast<value_type const*>(pixf_src.pix_ptr(0, 0))),
+          src_width_(static_cast<int>(pixf_src.width())),
+          src_height_(static_cast<int>(pixf_src.height())) {}
+
+    template <typename Interpolator>
+    void nearest(Interpolator & interpolator)
+    {
+        std::vector<int> xs, ys;
+        scaling_coords(interpolator, pixf_dst_.width(), pixf_dst_.height(), xs, ys);
+        for (int & x : xs) x = clamp_index(x >> agg::image_subpixel_shift, src_width_);
+        for (int & y : ys) y = clamp_index(y >> agg::image_subpixel_shift, src_height_);
+        unsigned width = pixf_dst_.width();
+        util::parallel_rows(pixf_dst_.height(), width, [&](unsigned begin, unsigned end)
+        {
+            std::vector<color_type> span(width);
+            std::vector<agg::int8u> covers(width, agg::cover_full);
+            for (unsigned y = begin; y < end; ++y)
+            {
+                value_type const* row = src_ + static_cast<std::size_t>(ys[y]) * src_width_ * channels;
+                for (unsigned x = 0; x < width; ++x)
+                {
+                    value_type const* p = row + xs[x] * channels;
+                    long_type fg[channels];
+                    for (unsigned k = 0; k < channels; ++k) fg[k] = p[order(k)];
+                    store_resampled(span[x], fg, is_rgba());
+                }
+                pixf_dst_.blend_color_hspan(0, y, width, span.data(), covers.data(), agg::cover_full);
+            }
+        });
+    }
+
+    template <typename Interpolator>
+    void resample(Interpolator & interpolator, agg::image_filter_lut const& filter)
+    {
+        // span_image_resample_affine::prepare() with its default scale limit and blur
+        double scale_x;
+        double scale_y;
+        interpolator.transformer().scaling_abs(&scale_x, &scale_y);
+        double const scale_limit = 200.0;
+        if (scale_x * scale_y > scale_limit)
+        {
+            scale_x = scale_x * scale_limit / (scale_x * scale_y);
+            scale_y = scale_y * scale_limit / (scale_x * scale_y);
+        }
+        if (scale_x < 1) scale_x = 1;
+        if (scale_y < 1) scale_y = 1;
+        if (scale_x > scale_limit) scale_x = scale_limit;
+        if (scale_y > scale_limit) scale_y = scale_limit;
+        int rx = agg::uround(scale_x * double(agg::image_subpixel_scale));
+        int rx_inv = agg::uround(1.0 / scale_x * double(agg::image_subpixel_scale));
+        int ry = agg::uround(scale_y * double(agg::image_subpixel_scale));
+        int ry_inv = agg::uround(1.0 / scale_y * double(agg::image_subpixel_scale));
+
+        int diameter = filter.diameter();
+        int filter_scale = diameter << agg::image_subpixel_shift;
+        len_x_lr_ = (diameter * rx + agg::image_subpixel_mask) >> agg::image_subpixel_shift;
+
+        std::vector<int> xs, ys;
+        scaling_coords(interpolator, pixf_dst_.width(), pixf_dst_.height(), xs, ys);
+        build_taps(x_taps_, xs, (diameter * rx) >> 1, rx_inv, filter_scale, filter.weight_array());
+        build_taps(y_taps_, ys, (diameter * ry) >> 1, ry_inv, filter_scale, filter.weight_array());
+        clamped_x_.resize(x_taps_.weights.size());
+        for (std::size_t i = 0; i < xs.size(); ++i)
+        {
+            for (unsigned t = 0; t < x_taps_.count(i); ++t)
+            {
+                clamped_x_[x_taps_.offset[i] + t] = clamp_index(x_taps_.first[i] + t, src_width_);
+            }
+        }
+        simd_weights_ = true;
+        for (int i = 0; i < filter_scale; ++i)
+        {
+            int w = filter.weight_array()[i];
+            if (w > 23170 || w < -23170) simd_weights_ = false;
+        }
+
+        unsigned width = pixf_dst_.width();
+        util::parallel_rows(pixf_dst_.height(), width, [&](unsigned begin, unsigned end)
+        {
+            std::vector<color_type> span(width);
+            std::vector<agg::int8u> covers(width, agg::cover_full);
+            for (unsigned y = begin; y < end; ++y)
+            {
+                for (unsigned x = 0; x < width; ++x)
+                {
+                    resample_pixel(span[x], x, y, is_rgba());
+                }
+                pixf_dst_.blend_color_hspan(0, y, width, span.data(), covers.data(), agg::cover_full);
+            }
+        });
+    }
+
+private:
+    static unsigned order(unsigned k)
+    {
+        return k == 0 ? order_type::R : (k == 1 ? order_type::G : (k == 2 ? order_type::B : order_type::A));
+    }
+
+    // Rows of the filter window which image_accessor_clone reads straight from
+    // the source without clamping columns: all of them up to the bottom edge
+    // when the window starts inside the image and len_x_lr columns fit.
+    unsigned unclamped_rows(unsigned x, unsigned y) const
+    {
+        int x_lr = x_taps_.first[x];
+        int y_lr = y_taps_.first[y];
+        if (y_lr < 0 || y_lr >= src_height_ || x_lr < 0 || x_lr + len_x_lr_ > src_width_) return 0;
+        return std::min<unsigned>(y_taps_.count(y), src_height_ - y_lr);
+    }
+
+    // Start of one row of the filter window. Unclamped rows are read as
+    // consecutive pixels, which may run past the row end into the next one
+    // like the accessor does; columns then stays null. Anything else, and the
+    // window on the last row that would leave the buffer, goes through the
+    // clamped column indices.
+    value_type const* tap_row(unsigned x, int yy, bool unclamped, int const*& columns) const
+    {
+        if (unclamped)
+        {
+            std::size_t start = static_cast<std::size_t>(yy) * src_width_ + x_taps_.first[x];
+            if (start + x_taps_.count(x) <= static_cast<std::size_t>(src_width_) * src_height_)
+            {
+                columns = nullptr;
+                return src_ + start * channels;
+            }
+        }
+        columns = clamped_x_.data() + x_taps_.offset[x];
+        return src_ + static_cast<std::size_t>(clamp_index(yy, src_height_)) * src_width_ * channels;
+    }
+
+    void resample_pixel(color_type & c, unsigned x, unsigned y, std::false_type) const
+    {
+        long_type fg[channels];
+        int total_weight = accumulate(fg, x, y);
+        for (unsigned k = 0; k < channels; ++k)
+        {
+            fg[k] /= total_weight;
+            if (fg[k] < 0) fg[k] = 0;
+            if (fg[k] > color_type::base_mask) fg[k] = color_type::base_mask;
+        }
+        store_resampled(c, fg, std::false_type());
+    }
+
+    void resample_pixel(color_type & c, unsigned x, unsigned y, std::true_type) const
+    {
+        long_type mem[4];
+#ifdef SSE_MATH
+        int total_weight = simd_weights_ ? accumulate_sse(mem, x, y) : accumulate(mem, x, y);
+#else
+        int total_weight = accumulate(mem, x, y);
+#endif
+        for (unsigned k = 0; k < 4; ++k)
+        {
+            mem[k] /= total_weight;
+            if (mem[k] < 0) mem[k] = 0;
+        }
+        if (mem[order_type::A] > color_type::base_mask) mem[order_type::A] = color_type::base_mask;
+        if (mem[order_type::R] > mem[order_type::A]) mem[order_type::R] = mem[order_type::A];
+        if (mem[order_type::G] > mem[order_type::A]) mem[order_type::G] = mem[order_type::A];
+        if (mem[order_type::B] > mem[order_type::A]) mem[order_type::B] = mem[order_type::A];
+        long_type fg[4] = { mem[order_type::R], mem[order_type::G], mem[order_type::B], mem[order_type::A] };
+        store_resampled(c, fg, std::true_type());
+    }
+
+    static int accumulate_tap(long_type * fg, value_type const* p, int weight_y, int weight_x)
+    {
+        int weight = (weight_y * weight_x + agg::image_filter_scale / 2) >> agg::image_filter_shift;
+        for (unsigned k = 0; k < channels; ++k) fg[k] += p[k] * weight;
+        return weight;
+    }
+
+    // Sums the weighted source channels in memory order and returns the total weight
+    int accumulate(long_type * fg, unsigned x, unsigned y) const
+    {
+        // summed in a local so the byte sized source reads can't alias it
+        long_type sum[channels];
+        for (unsigned k = 0; k < channels; ++k) sum[k] = agg::image_filter_scale / 2;
+        int total_weight = 0;
+        unsigned rows = y_taps_.count(y);
+        unsigned unclamped = unclamped_rows(x, y);
+        unsigned cols = x_taps_.count(x);
+        agg::int16 const* wy = y_taps_.weights_at(y);
+        agg::int16 const* wx = x_taps_.weights_at(x);
+        for (unsigned j = 0; j < rows; ++j)
+        {
+            int const* columns;
+            value_type const* row = tap_row(x, y_taps_.first[y] + j, j < unclamped, columns);
+            int weight_y = wy[j];
+            if (columns)
+            {
+                for (unsigned t = 0; t < cols; ++t)
+                {
+                    total_weight += accumulate_tap(sum, row + columns[t] * channels, weight_y, wx[t]);
+                }
+            }
+            else
+            {
+                for (unsigned t = 0; t < cols; ++t)
+                {
+                    total_weight += accumulate_tap(sum, row + t * channels, weight_y, wx[t]);
+                }
+            }
+        }
+        std::copy(sum, sum + channels, fg);
+        return total_weight;
+    }
+
+#ifdef SSE_MATH
+    // Two horizontal taps per _mm_madd_epi16: the channels of both pixels are
+    // interleaved as 16 bit lanes against their pair of weights, which fit in
+    // 16 bits as long as the filter weights stay within sqrt(2^29).
+    int accumulate_sse(agg::int32 * fg, unsigned x, unsigned y) const
+    {
+        __m128i const zero = _mm_setzero_si128();
+        __m128i acc = _mm_set1_epi32(agg::image_filter_scale / 2);
+        int total_weight = 0;
+        unsigned rows = y_taps_.count(y);
+        unsigned unclamped = unclamped_rows(x, y);
+        unsigned cols = x_taps_.count(x);
+        agg::int16 const* wy = y_taps_.weights_at(y);
+        agg::int16 const* wx = x_taps_.weights_at(x);
+        for (unsigned j = 0; j < rows; ++j)
+        {
+            int const* columns;
+            value_type const* row = tap_row(x, y_taps_.first[y] + j, j < unclamped, columns);
+            int weight_y = wy[j];
+            unsigned t = 0;
+            for (; t + 1 < cols; t += 2)
+            {
+                int w0 = (weight_y * wx[t] + agg::image_filter_scale / 2) >> agg::image_filter_shift;
+                int w1 = (weight_y * wx[t + 1] + agg::image_filter_scale / 2) >> agg::image_filter_shift;
+                __m128i pixels;
+                if (columns)
+                {
+                    agg::int32 p0, p1;
+                    std::memcpy(&p0, row + columns[t] * channels, 4);
+                    std::memcpy(&p1, row + columns[t + 1] * channels, 4);
+                    pixels = _mm_unpacklo_epi32(_mm_cvtsi32_si128(p0), _mm_cvtsi32_si128(p1));
+                }
+                else
+                {
+                    pixels = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(row + t * channels));
+                }
+                pixels = _mm_unpacklo_epi8(pixels, zero);
+                __m128i w = _mm_set1_epi32(static_cast<agg::int32>((static_cast<agg::int32u>(w1) << 16) |
+                                                                   (static_cast<agg::int32u>(w0) & 0xffff)));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8)), w));
+                total_weight += w0 + w1;
+            }
+            if (t < cols)
+            {
+                int w0 = (weight_y * wx[t] + agg::image_filter_scale / 2) >> agg::image_filter_shift;
+                agg::int32 p0;
+                std::memcpy(&p0, columns ? row + columns[t] * channels : row + t * channels, 4);
+                __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(p0), zero);
+                __m128i w = _mm_set1_epi32(static_cast<agg::int32>(static_cast<agg::int32u>(w0) & 0xffff));
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(pixel, zero), w));
+                total_weight += w0;
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(fg), acc);
+        return total_weight;
+    }
+#endif
+
+    PixFmt & pixf_dst_;
+    value_type const* src_;
+    int src_width_;
+    int src_height_;
+    int len_x_lr_ = 0;
+    bool simd_weights_ = false;
+    scaling_taps x_taps_;
+    scaling_taps y_taps_;
+    std::vector<int> clamped_x_;
+};
+
+} // anonymous namespace
+
+namespace detail {
 
 template <typename T>
-void scale_image_agg(T & target, T const& source, scaling_method_e scaling_method,
-                     double image_ratio_x, double image_ratio_y, double x_off_f, double y_off_f,
-                     double filter_factor)
+void scale_image_agg(T & target, T const& source, agg::image_filter_lut const* filter,
+                     double image_ratio_x, double image_ratio_y, double x_off_f, double y_off_f)
 {
     // "the image filters should work namely in the premultiplied color space"
     // http://old.nabble.com/Re:--AGG--Basic-image-transformations-p1110665.html
@@ -139,6 +580,22 @@ void scale_image_agg(T & target, T const& source, scaling_method_e scaling_metho
 
     // create a linear interpolator for our scaling matrix
     interpolator_type interpolator(img_mtx);
+
+    if (x_off_f == 0 && y_off_f == 0 && pixel_size == pixfmt_pre::pix_width &&
+        source.width() > 0 && source.height() > 0 && target.width() > 0 && target.height() > 0)
+    {
+        aligned_scaler<pixfmt_pre> scaler(pixf_dst, pixf_src);
+        if (filter == nullptr)
+        {
+            scaler.nearest(interpolator);
+        }
+        else
+        {
+            scaler.resample(interpolator, *filter);
+        }
+        return;
+    }
+
     // draw an anticlockwise polygon to render our image into
     double scaled_width = target.width();
     double scaled_height = target.height();
@@ -148,7 +605,7 @@ void scale_image_agg(T & target, T const& source, scaling_method_e scaling_metho
     ras.line_to_d(x_off_f + scaled_width, y_off_f + scaled_height);
     ras.line_to_d(x_off_f,                y_off_f + scaled_height);
 
-    if (scaling_method == SCALING_NEAR)
+    if (filter == nullptr)
     {
         using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
         span_gen_type sg(img_src, interpolator);
@@ -157,14 +614,30 @@ void scale_image_agg(T & target, T const& source, scaling_method_e scaling_metho
     else
     {
         using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
-        agg::image_filter_lut filter;
-        detail::set_scaling_method(filter, scaling_method, filter_factor);
-        span_gen_type sg(img_src, interpolator, filter);
+        span_gen_type sg(img_src, interpolator, *filter);
         agg::render_scanlines_aa(ras, sl, rb_dst_pre, sa, sg);
     }
 
 }
 
+} // namespace detail
+
+template <typename T>
+void scale_image_agg(T & target, T const& source, scaling_method_e scaling_method,
+                     double image_ratio_x, double image_ratio_y, double x_off_f, double y_off_f,
+                     double filter_factor)
+{
+    if (scaling_method == SCALING_NEAR)
+    {
+        detail::scale_image_agg(target, source, nullptr, image_ratio_x, image_ratio_y, x_off_f, y_off_f);
+    }
+    else
+    {
+        auto filter = scaling_filter_cache::instance().get(scaling_method, filter_factor);
+        detail::scale_image_agg(target, source, filter.get(), image_ratio_x, image_ratio_y, x_off_f, y_off_f);
+    }
+}
+
 template MAPNIK_DECL void scale_image_agg(image_rgba8 &, image_rgba8 const&, scaling_method_e,
                               double, double , double, double , double);
 
@@ -197,4 +670,41 @@ template MAPNIK_DECL void scale_image_agg(image_gray64s &, image_gray64s const&,
 
 template MAPNIK_DECL void scale_image_agg(image_gray64f &, image_gray64f const&, scaling_method_e,
                               double, double , double, double , double);
+namespace detail {
+
+template MAPNIK_DECL void scale_image_agg(image_rgba8 &, image_rgba8 const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray8 &, image_gray8 const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray8s &, image_gray8s const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray16 &, image_gray16 const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray16s &, image_gray16s const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray32 &, image_gray32 const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray32s &, image_gray32s const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray32f &, image_gray32f const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray64 &, image_gray64 const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray64s &, image_gray64s const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+template MAPNIK_DECL void scale_image_agg(image_gray64f &, image_gray64f const&, agg::image_filter_lut const*,
+                              double, double , double, double);
+
+} // namespace detail
+
 }
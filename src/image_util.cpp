@@ -26,6 +26,7 @@
 #include <mapnik/image_util_png.hpp>
 #include <mapnik/image_util_tiff.hpp>
 #include <mapnik/image_util_webp.hpp>
+#include <mapnik/image_sink.hpp>
 #include <mapnik/image.hpp>
 #include <mapnik/image_any.hpp>
 #include <mapnik/image_view_any.hpp>
@@ -47,9 +48,17 @@
 
 // stl
 #include <string>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
 
 // boost
 #include <boost/numeric/conversion/cast.hpp>
@@ -67,18 +76,20 @@ MAPNIK_DECL std::string save_to_string(T const& image,
                            std::string const& type,
                            rgba_palette const& palette)
 {
-    std::ostringstream ss(std::ios::out|std::ios::binary);
-    save_to_stream(image, ss, type, palette);
-    return ss.str();
+    std::string buffer;
+    string_sink sink(buffer);
+    save_to_sink(image, sink, type, palette);
+    return buffer;
 }
 
 template <typename T>
 MAPNIK_DECL std::string save_to_string(T const& image,
                            std::string const& type)
 {
-    std::ostringstream ss(std::ios::out|std::ios::binary);
-    save_to_stream(image, ss, type);
-    return ss.str();
+    std::string buffer;
+    string_sink sink(buffer);
+    save_to_sink(image, sink, type);
+    return buffer;
 }
 
 template <typename T>
@@ -115,12 +126,39 @@ MAPNIK_DECL void save_to_stream(T const& image,
                     rgba_palette const& palette)
 {
     if (stream && image.width() > 0 && image.height() > 0)
+    {
+        stream_sink sink(stream);
+        save_to_sink(image, sink, type, palette);
+    }
+    else throw ImageWriterException("Could not write to empty stream" );
+}
+
+template <typename T>
+MAPNIK_DECL void save_to_stream(T const& image,
+                    std::ostream & stream,
+                    std::string const& type)
+{
+    if (stream && image.width() > 0 && image.height() > 0)
+    {
+        stream_sink sink(stream);
+        save_to_sink(image, sink, type);
+    }
+    else throw ImageWriterException("Could not write to empty stream" );
+}
+
+template <typename T>
+MAPNIK_DECL void save_to_sink(T const& image,
+                    image_sink & sink,
+                    std::string const& type,
+                    rgba_palette const& palette)
+{
+    if (image.width() > 0 && image.height() > 0)
     {
         std::string t = type;
         std::transform(t.begin(), t.end(), t.begin(), ::tolower);
         if (t == "png" || boost::algorithm::starts_with(t, "png"))
         {
-            png_saver_pal visitor(stream, t, palette);
+            png_saver_pal visitor(sink, t, palette);
             mapnik::util::apply_visitor(visitor, image);
         }
         else if (boost::algorithm::starts_with(t, "tif"))
@@ -133,26 +171,25 @@ MAPNIK_DECL void save_to_stream(T const& image,
         }
         else throw ImageWriterException("unknown file type: " + type);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+    else throw ImageWriterException("Could not write an empty image");
 }
 
 // This can be removed once image_any and image_view_any are the only 
 // items using this template
 template <>
-MAPNIK_DECL void save_to_stream<image_rgba8>(image_rgba8 const& image,
-                    std::ostream & stream,
+MAPNIK_DECL void save_to_sink<image_rgba8>(image_rgba8 const& image,
+                    image_sink & sink,
                     std::string const& type,
                     rgba_palette const& palette)
 {
-    if (stream && image.width() > 0 && image.height() > 0)
+    if (image.width() > 0 && image.height() > 0)
     {
         std::string t = type;
         std::transform(t.begin(), t.end(), t.begin(), ::tolower);
         if (t == "png" || boost::algorithm::starts_with(t, "png"))
         {
-            png_saver_pal visitor(stream, t, palette);
+            png_saver_pal visitor(sink, t, palette);
             visitor(image);
-            //mapnik::util::apply_visitor(visitor, image);
         }
         else if (boost::algorithm::starts_with(t, "tif"))
         {
@@ -164,26 +201,25 @@ MAPNIK_DECL void save_to_stream<image_rgba8>(image_rgba8 const& image,
         }
         else throw ImageWriterException("unknown file type: " + type);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+    else throw ImageWriterException("Could not write an empty image");
 }
 
 // This can be removed once image_any and image_view_any are the only 
 // items using this template
 template <>
-MAPNIK_DECL void save_to_stream<image_view_rgba8>(image_view_rgba8 const& image,
-                    std::ostream & stream,
+MAPNIK_DECL void save_to_sink<image_view_rgba8>(image_view_rgba8 const& image,
+                    image_sink & sink,
                     std::string const& type,
                     rgba_palette const& palette)
 {
-    if (stream && image.width() > 0 && image.height() > 0)
+    if (image.width() > 0 && image.height() > 0)
     {
         std::string t = type;
         std::transform(t.begin(), t.end(), t.begin(), ::tolower);
         if (t == "png" || boost::algorithm::starts_with(t, "png"))
         {
-            png_saver_pal visitor(stream, t, palette);
+            png_saver_pal visitor(sink, t, palette);
             visitor(image);
-            //mapnik::util::apply_visitor(visitor, image);
         }
         else if (boost::algorithm::starts_with(t, "tif"))
         {
@@ -195,121 +231,190 @@ MAPNIK_DECL void save_to_stream<image_view_rgba8>(image_view_rgba8 const& image,
         }
         else throw ImageWriterException("unknown file type: " + type);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+    else throw ImageWriterException("Could not write an empty image");
 }
 
+namespace detail {
+
+template <typename Visitor>
+void apply_saver(Visitor const& visitor, image_rgba8 const& image)
+{
+    visitor(image);
+}
+
+template <typename Visitor>
+void apply_saver(Visitor const& visitor, image_view_rgba8 const& image)
+{
+    visitor(image);
+}
+
+template <typename Visitor, typename T>
+void apply_saver(Visitor const& visitor, T const& image)
+{
+    util::apply_visitor(visitor, image);
+}
+
+// `t` is the lower case format string
 template <typename T>
-MAPNIK_DECL void save_to_stream(T const& image,
-                    std::ostream & stream,
-                    std::string const& type)
+void encode_to_sink(T const& image, image_sink & sink, std::string const& t)
 {
-    if (stream && image.width() > 0 && image.height() > 0)
+    if (t == "png" || boost::algorithm::starts_with(t, "png"))
     {
-        std::string t = type;
-        std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-        if (t == "png" || boost::algorithm::starts_with(t, "png"))
-        {
-            png_saver visitor(stream, t);
-            util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "tif"))
-        {
-            tiff_saver visitor(stream, t);  
-            util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "jpeg"))
-        {
-            jpeg_saver visitor(stream, t);
-            util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "webp"))
+        apply_saver(png_saver(sink, t), image);
+    }
+    else if (boost::algorithm::starts_with(t, "tif"))
+    {
+        apply_saver(tiff_saver(sink, t), image);
+    }
+    else if (boost::algorithm::starts_with(t, "jpeg"))
+    {
+        apply_saver(jpeg_saver(sink, t), image);
+    }
+    else if (boost::algorithm::starts_with(t, "webp"))
+    {
+        apply_saver(webp_saver(sink, t), image);
+    }
+    else throw ImageWriterException("unknown file type: " + t);
+}
+
+// Encoded solid images, shared by all threads. Rendered tiles that are all
+// background (ocean, empty areas) come in few sizes and colours, so a small
+// table catches them. Uncompressed formats (tiff) of large images can be big,
+// so least recently used entries are dropped past max_bytes.
+class solid_image_cache
+{
+public:
+    static const std::size_t max_entries = 256;
+    static const std::size_t max_bytes = 4 * 1024 * 1024;
+
+    solid_image_cache()
+        : bytes_(0) {}
+
+    std::shared_ptr<std::string const> find(std::string const& key)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr == index_.end()) return std::shared_ptr<std::string const>();
+        entries_.splice(entries_.begin(), entries_, itr->second);
+        return itr->second->second;
+    }
+
+    void insert(std::string const& key, std::shared_ptr<std::string const> const& bytes)
+    {
+        std::size_t size = entry_bytes(key, *bytes);
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        if (size > max_bytes || index_.find(key) != index_.end()) return;
+        entries_.emplace_front(key, bytes);
+        index_.emplace(key, entries_.begin());
+        bytes_ += size;
+        while (bytes_ > max_bytes || index_.size() > max_entries)
         {
-            webp_saver visitor(stream, t);
-            util::apply_visitor(visitor, image);
+            auto const& last = entries_.back();
+            bytes_ -= entry_bytes(last.first, *last.second);
+            index_.erase(last.first);
+            entries_.pop_back();
         }
-        else throw ImageWriterException("unknown file type: " + type);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+
+private:
+    static std::size_t entry_bytes(std::string const& key, std::string const& bytes)
+    {
+        return key.size() + bytes.size();
+    }
+
+    using entry_list = std::list<std::pair<std::string, std::shared_ptr<std::string const> > >;
+    entry_list entries_; // most recently used first
+    std::unordered_map<std::string, entry_list::iterator> index_;
+    std::size_t bytes_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+};
+
+std::shared_ptr<std::string const> save_solid(image_rgba8 const& image, std::string const& t)
+{
+    static solid_image_cache cache;
+    // the pixel value, size and premultiplied flag determine the output of every encoder
+    std::string key(t);
+    key += '|';
+    key += std::to_string(image.width());
+    key += 'x';
+    key += std::to_string(image.height());
+    key += '|';
+    key += std::to_string(image(0, 0));
+    key += image.get_premultiplied() ? "|p" : "|u";
+    std::shared_ptr<std::string const> bytes = cache.find(key);
+    if (!bytes)
+    {
+        std::shared_ptr<std::string> encoded = std::make_shared<std::string>();
+        string_sink sink(*encoded);
+        encode_to_sink(image, sink, t);
+        bytes = encoded;
+        cache.insert(key, bytes);
+    }
+    return bytes;
 }
 
-// This can be removed once image_any and image_view_any are the only 
-// items using this template
-template <>
-MAPNIK_DECL void save_to_stream<image_rgba8>(image_rgba8 const& image,
-                    std::ostream & stream,
-                    std::string const& type)
+inline image_rgba8 const* solid_candidate(image_rgba8 const& image)
 {
-    if (stream && image.width() > 0 && image.height() > 0)
+    return &image;
+}
+
+inline image_rgba8 const* solid_candidate(image_any const& image)
+{
+    return image.is<image_rgba8>() ? &util::get<image_rgba8>(image) : nullptr;
+}
+
+template <typename T>
+inline image_rgba8 const* solid_candidate(T const&)
+{
+    return nullptr;
+}
+
+} // end detail ns
+
+template <typename T>
+MAPNIK_DECL void save_to_sink(T const& image,
+                    image_sink & sink,
+                    std::string const& type,
+                    bool known_solid)
+{
+    if (image.width() > 0 && image.height() > 0)
     {
         std::string t = type;
         std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-        if (t == "png" || boost::algorithm::starts_with(t, "png"))
-        {
-            png_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "tif"))
+        // single colour images are served pre-encoded; the scan stops at
+        // the first differing pixel for everything else
+        image_rgba8 const* rgba = detail::solid_candidate(image);
+        if (rgba && (known_solid || is_solid(*rgba)))
         {
-            tiff_saver visitor(stream, t);  
-            visitor(image);
-            //util::apply_visitor(visitor, image);
+            std::shared_ptr<std::string const> bytes = detail::save_solid(*rgba, t);
+            sink.reserve(bytes->size());
+            sink.write(bytes->data(), bytes->size());
+            sink.flush();
         }
-        else if (boost::algorithm::starts_with(t, "jpeg"))
+        else
         {
-            jpeg_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
+            detail::encode_to_sink(image, sink, t);
         }
-        else if (boost::algorithm::starts_with(t, "webp"))
-        {
-            webp_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else throw ImageWriterException("unknown file type: " + type);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+    else throw ImageWriterException("Could not write an empty image");
 }
 
-// This can be removed once image_any and image_view_any are the only 
-// items using this template
-template <>
-MAPNIK_DECL void save_to_stream<image_view_rgba8>(image_view_rgba8 const& image,
-                    std::ostream & stream,
-                    std::string const& type)
+MAPNIK_DECL std::shared_ptr<std::string const> save_solid_to_string(image_rgba8 const& image,
+                                                                    std::string const& type)
 {
-    if (stream && image.width() > 0 && image.height() > 0)
+    if (image.width() > 0 && image.height() > 0)
     {
         std::string t = type;
         std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-        if (t == "png" || boost::algorithm::starts_with(t, "png"))
-        {
-            png_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "tif"))
-        {
-            tiff_saver visitor(stream, t);  
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "jpeg"))
-        {
-            jpeg_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else if (boost::algorithm::starts_with(t, "webp"))
-        {
-            webp_saver visitor(stream, t);
-            visitor(image);
-            //util::apply_visitor(visitor, image);
-        }
-        else throw ImageWriterException("unknown file type: " + type);
+        return detail::save_solid(image, t);
     }
-    else throw ImageWriterException("Could not write to empty stream" );
+    else throw ImageWriterException("Could not write an empty image");
 }
 
 template <typename T>
@@ -358,6 +463,35 @@ template MAPNIK_DECL std::string save_to_string<image_rgba8>(image_rgba8 const&,
                                                       std::string const&,
                                                       rgba_palette const& palette);
 
+template MAPNIK_DECL void save_to_stream<image_rgba8>(image_rgba8 const&,
+                                             std::ostream &,
+                                             std::string const&);
+
+template MAPNIK_DECL void save_to_stream<image_rgba8>(image_rgba8 const&,
+                                             std::ostream &,
+                                             std::string const&,
+                                             rgba_palette const& palette);
+
+template MAPNIK_DECL void save_to_sink<image_rgba8>(image_rgba8 const&,
+                                           image_sink &,
+                                           std::string const&,
+                                           bool);
+
+// image_view_rgba8
+template MAPNIK_DECL void save_to_stream<image_view_rgba8>(image_view_rgba8 const&,
+                                                  std::ostream &,
+                                                  std::string const&);
+
+template MAPNIK_DECL void save_to_stream<image_view_rgba8>(image_view_rgba8 const&,
+                                                  std::ostream &,
+                                                  std::string const&,
+                                                  rgba_palette const& palette);
+
+template MAPNIK_DECL void save_to_sink<image_view_rgba8>(image_view_rgba8 const&,
+                                                image_sink &,
+                                                std::string const&,
+                                                bool);
+
 // image_view_any
 template MAPNIK_DECL void save_to_file<image_view_any> (image_view_any const&,
                                               std::string const&,
@@ -382,6 +516,25 @@ template MAPNIK_DECL std::string save_to_string<image_view_any> (image_view_any
                                                        std::string const&,
                                                        rgba_palette const& palette);
 
+template MAPNIK_DECL void save_to_stream<image_view_any>(image_view_any const&,
+                                             std::ostream &,
+                                             std::string const&);
+
+template MAPNIK_DECL void save_to_stream<image_view_any>(image_view_any const&,
+                                             std::ostream &,
+                                             std::string const&,
+                                             rgba_palette const& palette);
+
+template MAPNIK_DECL void save_to_sink<image_view_any>(image_view_any const&,
+                                           image_sink &,
+                                           std::string const&,
+                                           bool);
+
+template MAPNIK_DECL void save_to_sink<image_view_any>(image_view_any const&,
+                                           image_sink &,
+                                           std::string const&,
+                                           rgba_palette const& palette);
+
 // image_any
 template MAPNIK_DECL void save_to_file<image_any>(image_any const&,
                                            std::string const&,
@@ -406,8 +559,66 @@ template MAPNIK_DECL std::string save_to_string<image_any>(image_any const&,
                                                     std::string const&,
                                                     rgba_palette const& palette);
 
+template MAPNIK_DECL void save_to_stream<image_any>(image_any const&,
+                                             std::ostream &,
+                                             std::string const&);
+
+template MAPNIK_DECL void save_to_stream<image_any>(image_any const&,
+                                             std::ostream &,
+                                             std::string const&,
+                                             rgba_palette const& palette);
+
+template MAPNIK_DECL void save_to_sink<image_any>(image_any const&,
+                                           image_sink &,
+                                           std::string const&,
+                                           bool);
+
+template MAPNIK_DECL void save_to_sink<image_any>(image_any const&,
+                                           image_sink &,
+                                           std::string const&,
+                                           rgba_palette const& palette);
+
 namespace detail {
 
+// floating point pixels compare by value (-0.0 == 0.0, NaN != NaN)
+template <typename T>
+inline typename std::enable_if<!std::is_integral<T>::value, bool>::type
+is_solid_row(T const* row, std::size_t width, T value)
+{
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        if (value != row[x]) return false;
+    }
+    return true;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+is_solid_row(T const* row, std::size_t width, T value)
+{
+    std::size_t x = 0;
+#ifdef SSE_MATH
+    // compare 32 bytes per iteration against the value repeated across a register
+    std::size_t const step = 16 / sizeof(T);
+    T pattern[16 / sizeof(T)];
+    std::fill(pattern, pattern + step, value);
+    __m128i const p = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pattern));
+    __m128i const zero = _mm_setzero_si128();
+    for (; x + 2 * step <= width; x += 2 * step)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x + step));
+        __m128i diff = _mm_or_si128(_mm_xor_si128(v0, p), _mm_xor_si128(v1, p));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) != 0xffff) return false;
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        if (value != row[x]) return false;
+    }
+    return true;
+}
+
 struct is_solid_visitor
 {
     bool operator() (image_null const&)
@@ -425,13 +636,9 @@ struct is_solid_visitor
             pixel_type const first_pixel = first_row[0];
             for (unsigned y = 0; y < data.height(); ++y)
             {
-                pixel_type const * row = data.getRow(y);
-                for (unsigned x = 0; x < data.width(); ++x)
+                if (!is_solid_row(data.getRow(y), data.width(), first_pixel))
                 {
-                    if (first_pixel != row[x])
-                    {
-                        return false;
-                    }
+                    return false;
                 }
             }
         }
@@ -472,15 +679,109 @@ template MAPNIK_DECL bool is_solid(image_gray64f const&);
 
 namespace detail {
 
+// 255 / a per alpha value, nudged up by 2^-20 so that truncating c * factor in
+// single precision gives agg's (c * 255) / a exactly for every result below 256
+// and something >= 255 otherwise. Replaces the three divisions per pixel of
+// multiplier_rgba::demultiply.
+struct demultiply_table
+{
+    demultiply_table()
+    {
+        factor[0] = 0.0f;
+        for (unsigned a = 1; a < 255; ++a)
+        {
+            factor[a] = static_cast<float>(255.0 / a * (1.0 + 1.0 / (1 << 20)));
+        }
+        factor[255] = 1.0f;
+    }
+    float factor[256];
+};
+
+inline float const* demultiply_factors()
+{
+    static const demultiply_table table;
+    return table.factor;
+}
+
+inline void premultiply_row(image_rgba8::pixel_type * row, std::size_t width)
+{
+    std::size_t x = 0;
+#ifdef SSE_MATH
+    // (c * a + 255) >> 8 leaves c alone for a == 255 and zeroes it for a == 0,
+    // so four pixels go through the same formula as agg without branches
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const round = _mm_set1_epi16(255);
+    __m128i const alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+        __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+        __m128i p_lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, a_lo), round), 8);
+        __m128i p_hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, a_hi), round), 8);
+        p_lo = _mm_or_si128(_mm_and_si128(alpha_lanes, lo), _mm_andnot_si128(alpha_lanes, p_lo));
+        p_hi = _mm_or_si128(_mm_and_si128(alpha_lanes, hi), _mm_andnot_si128(alpha_lanes, p_hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_packus_epi16(p_lo, p_hi));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        agg::multiplier_rgba<agg::rgba8, agg::order_rgba>::premultiply(reinterpret_cast<agg::int8u*>(row + x));
+    }
+}
+
+inline void demultiply_row(image_rgba8::pixel_type * row, std::size_t width)
+{
+    float const* factor = demultiply_factors();
+    std::size_t x = 0;
+#ifdef SSE_MATH
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const alpha_byte = _mm_set1_epi32(0xff000000);
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + x));
+        // opaque pixels are left untouched
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, alpha_byte), alpha_byte)) == 0xffff) continue;
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128 f0 = _mm_set_ps(1.0f, factor[row[x] >> 24], factor[row[x] >> 24], factor[row[x] >> 24]);
+        __m128 f1 = _mm_set_ps(1.0f, factor[row[x + 1] >> 24], factor[row[x + 1] >> 24], factor[row[x + 1] >> 24]);
+        __m128 f2 = _mm_set_ps(1.0f, factor[row[x + 2] >> 24], factor[row[x + 2] >> 24], factor[row[x + 2] >> 24]);
+        __m128 f3 = _mm_set_ps(1.0f, factor[row[x + 3] >> 24], factor[row[x + 3] >> 24], factor[row[x + 3] >> 24]);
+        __m128i q0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), f0));
+        __m128i q1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), f1));
+        __m128i q2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), f2));
+        __m128i q3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), f3));
+        // saturating packs clamp to 255 like agg does
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x),
+                         _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3)));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        std::uint8_t * p = reinterpret_cast<std::uint8_t*>(row + x);
+        if (p[3] == 255) continue;
+        float f = factor[p[3]];
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            unsigned c = static_cast<unsigned>(p[i] * f);
+            p[i] = static_cast<std::uint8_t>(c > 255 ? 255 : c);
+        }
+    }
+}
+
 struct premultiply_visitor
 {
     bool operator() (image_rgba8 & data)
     {
         if (!data.get_premultiplied())
         {
-            agg::rendering_buffer buffer(data.getBytes(),data.width(),data.height(),data.getRowSize());
-            agg::pixfmt_rgba32 pixf(buffer);
-            pixf.premultiply();
+            for (unsigned y = 0; y < data.height(); ++y)
+            {
+                premultiply_row(data.getRow(y), data.width());
+            }
             data.set_premultiplied(true);
             return true;
         }
@@ -500,9 +801,10 @@ struct demultiply_visitor
     {
         if (data.get_premultiplied())
         {
-            agg::rendering_buffer buffer(data.getBytes(),data.width(),data.height(),data.getRowSize());
-            agg::pixfmt_rgba32_pre pixf(buffer);
-            pixf.demultiply();
+            for (unsigned y = 0; y < data.height(); ++y)
+            {
+                demultiply_row(data.getRow(y), data.width());
+            }
             data.set_premultiplied(false);
             return true;
         }
@@ -617,7 +919,19 @@ struct visitor_set_alpha
         for (unsigned int y = 0; y < data.height(); ++y)
         {
             pixel_type* row_to =  data.getRow(y);
-            for (unsigned int x = 0; x < data.width(); ++x)
+            unsigned int x = 0;
+#ifdef SSE_MATH
+            __m128 const opacity = _mm_set1_ps(opacity_);
+            __m128i const rgb = _mm_set1_epi32(0x00ffffff);
+            for (; x + 4 <= data.width(); x += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row_to + x));
+                __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(v, 24)), opacity));
+                v = _mm_or_si128(_mm_and_si128(v, rgb), _mm_slli_epi32(a, 24));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row_to + x), v);
+            }
+#endif
+            for (; x < data.width(); ++x)
             {
                 pixel_type rgba = row_to[x];
                 pixel_type a0 = (rgba >> 24) & 0xff;
@@ -685,6 +999,37 @@ template MAPNIK_DECL void set_alpha(image_gray64f &, float);
 
 namespace detail {
 
+#ifdef SSE_MATH
+// ceil((r * .3) + (g * .59) + (b * .11)) << 24 | rgb for the two pixels in the
+// low half of `v`, in double precision to match the scalar loops bit for bit
+inline __m128i grayscale_to_alpha_2(__m128i v, __m128i rgb)
+{
+    __m128i const low_byte = _mm_set1_epi32(0xff);
+    __m128d r = _mm_cvtepi32_pd(_mm_and_si128(v, low_byte));
+    __m128d g = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(v, 8), low_byte));
+    __m128d b = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(v, 16), low_byte));
+    __m128d gray = _mm_add_pd(_mm_add_pd(_mm_mul_pd(r, _mm_set1_pd(.3)),
+                                         _mm_mul_pd(g, _mm_set1_pd(.59))),
+                              _mm_mul_pd(b, _mm_set1_pd(.11)));
+    __m128i a = _mm_cvttpd_epi32(gray);
+    // round truncated values up where there was a fraction
+    __m128i up = _mm_castpd_si128(_mm_cmpgt_pd(gray, _mm_cvtepi32_pd(a)));
+    a = _mm_sub_epi32(a, _mm_shuffle_epi32(up, _MM_SHUFFLE(0,0,2,0)));
+    return _mm_or_si128(_mm_slli_epi32(a, 24), rgb);
+}
+
+inline void grayscale_to_alpha_row(image_rgba8::pixel_type * row, unsigned int & x, unsigned int width,
+                                   image_rgba8::pixel_type rgb)
+{
+    __m128i const fill = _mm_set1_epi32(rgb);
+    for (; x + 2 <= width; x += 2)
+    {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(row + x));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row + x), grayscale_to_alpha_2(v, fill));
+    }
+}
+#endif
+
 struct visitor_set_grayscale_to_alpha
 {
     void operator() (image_rgba8 & data)
@@ -693,7 +1038,11 @@ struct visitor_set_grayscale_to_alpha
         for (unsigned int y = 0; y < data.height(); ++y)
         {
             pixel_type* row_from = data.getRow(y);
-            for (unsigned int x = 0; x < data.width(); ++x)
+            unsigned int x = 0;
+#ifdef SSE_MATH
+            grayscale_to_alpha_row(row_from, x, data.width(), 0x00ffffff);
+#endif
+            for (; x < data.width(); ++x)
             {
                 pixel_type rgba = row_from[x];
                 pixel_type r = rgba & 0xff;
@@ -726,7 +1075,12 @@ struct visitor_set_grayscale_to_alpha_c
         for (unsigned int y = 0; y < data.height(); ++y)
         {
             pixel_type* row_from = data.getRow(y);
-            for (unsigned int x = 0; x < data.width(); ++x)
+            unsigned int x = 0;
+#ifdef SSE_MATH
+            grayscale_to_alpha_row(row_from, x, data.width(),
+                                   (c_.blue() << 16) | (c_.green() << 8) | c_.red());
+#endif
+            for (; x < data.width(); ++x)
             {
                 pixel_type rgba = row_from[x];
                 pixel_type r = rgba & 0xff;
@@ -838,7 +1192,18 @@ struct visitor_set_color_to_alpha
         for (unsigned y = 0; y < data.height(); ++y)
         {
             pixel_type* row_from = data.getRow(y);
-            for (unsigned x = 0; x < data.width(); ++x)
+            unsigned x = 0;
+#ifdef SSE_MATH
+            __m128i const key = _mm_set1_epi32((c_.blue() << 16) | (c_.green() << 8) | c_.red());
+            __m128i const rgb = _mm_set1_epi32(0x00ffffff);
+            for (; x + 4 <= data.width(); x += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row_from + x));
+                __m128i match = _mm_cmpeq_epi32(_mm_and_si128(v, rgb), key);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row_from + x), _mm_andnot_si128(match, v));
+            }
+#endif
+            for (; x < data.width(); ++x)
             {
                 pixel_type rgba = row_from[x];
                 pixel_type r = rgba & 0xff;
@@ -40,11 +40,11 @@
 namespace mapnik
 {
 
-jpeg_saver::jpeg_saver(std::ostream & stream, std::string const& t):
+jpeg_saver::jpeg_saver(image_sink & stream, std::string const& t):
     stream_(stream), t_(t) {}
 
 template <typename T>
-void process_rgba8_jpeg(T const& image, std::string const& type, std::ostream & stream)
+void process_rgba8_jpeg(T const& image, std::string const& type, image_sink & stream)
 {
 #if defined(HAVE_JPEG)
     int quality = 85;
@@ -68,6 +68,7 @@ void handle_png_options(std::string const& type,
     boost::tokenizer< boost::char_separator<char> > tokens(type, sep);
     bool set_colors = false;
     bool set_gamma = false;
+    bool set_threads = false;
     for (std::string const& t : tokens)
     {
         if (t == "png8" || t == "png256")
@@ -105,6 +106,16 @@ void handle_png_options(std::string const& type,
                 throw ImageWriterException("invalid trans_mode parameter: " + t.substr(2));
             }
         }
+        else if (boost::algorithm::starts_with(t, "p="))
+        {
+            set_threads = true;
+            int threads = 1;
+            if (!mapnik::util::string2int(t.substr(2),threads) || threads < 0)
+            {
+                throw ImageWriterException("invalid threads parameter: " + t.substr(2));
+            }
+            opts.threads = static_cast<unsigned>(threads);
+        }
         else if (boost::algorithm::starts_with(t, "g="))
         {
             set_gamma = true;
@@ -113,6 +124,22 @@ void handle_png_options(std::string const& type,
                 throw ImageWriterException("invalid gamma parameter: " + t.substr(2));
             }
         }
+        else if (t == "f=none")
+        {
+            opts.adaptive_filters = false;
+        }
+        else if (t == "f=adaptive")
+        {
+            opts.adaptive_filters = true;
+        }
+        else if (t == "z=fast")
+        {
+            // latency oriented preset: flat map imagery compresses well with
+            // per row filters and run length matching alone
+            opts.compression = Z_BEST_SPEED;
+            opts.strategy = Z_RLE;
+            opts.adaptive_filters = true;
+        }
         else if (boost::algorithm::starts_with(t, "z="))
         {
             /*
@@ -170,6 +197,10 @@ void handle_png_options(std::string const& type,
     {
         throw ImageWriterException("invalid gamma parameter: unavailable for true color (non-paletted) images");
     }
+    if (opts.paletted && set_threads)
+    {
+        throw ImageWriterException("invalid threads parameter: unavailable for paletted images");
+    }
     if ((opts.use_miniz == false) && opts.compression > Z_BEST_COMPRESSION)
     {
         throw ImageWriterException("invalid compression value: (only -1 through 9 are valid)");
@@ -177,10 +208,10 @@ void handle_png_options(std::string const& type,
 }
 #endif
 
-png_saver::png_saver(std::ostream & stream, std::string const& t):
+png_saver::png_saver(image_sink & stream, std::string const& t):
     stream_(stream), t_(t) {}
 
-png_saver_pal::png_saver_pal(std::ostream & stream, std::string const& t, rgba_palette const& pal):
+png_saver_pal::png_saver_pal(image_sink & stream, std::string const& t, rgba_palette const& pal):
     stream_(stream), t_(t), pal_(pal) {}
 
 template<>
@@ -198,7 +229,7 @@ void png_saver_pal::operator()<image_null> (image_null const& image) const
 template <typename T>
 void process_rgba8_png_pal(T const& image, 
                           std::string const& t,
-                          std::ostream & stream,
+                          image_sink & stream,
                           rgba_palette const& pal)
 {
 #if defined(HAVE_PNG)
@@ -233,7 +264,7 @@ void process_rgba8_png_pal(T const& image,
 template <typename T>
 void process_rgba8_png(T const& image, 
                           std::string const& t,
-                          std::ostream & stream)
+                          image_sink & stream)
 {
 #if defined(HAVE_PNG)
     png_options opts;
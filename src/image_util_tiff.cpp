@@ -161,7 +161,7 @@ void handle_tiff_options(std::string const& type,
 }
 #endif
 
-tiff_saver::tiff_saver(std::ostream & stream, std::string const& t):
+tiff_saver::tiff_saver(image_sink & stream, std::string const& t):
     stream_(stream), t_(t) {}
 template<>
 void tiff_saver::operator()<image_null> (image_null const& image) const
@@ -175,7 +175,21 @@ void tiff_saver::operator() (T const& image) const
 #if defined(HAVE_TIFF)
     tiff_config opts;
     handle_tiff_options(t_, opts);
-    save_as_tiff(stream_, image, opts);
+    // libtiff seeks while writing: encode in place when the sink is backed
+    // by a buffer, through a temporary otherwise
+    if (std::string * buffer = stream_.buffer())
+    {
+        tiff_memory_stream out(*buffer);
+        save_as_tiff(out, image, opts);
+    }
+    else
+    {
+        std::string buffer;
+        tiff_memory_stream out(buffer);
+        save_as_tiff(out, image, opts);
+        stream_.write(buffer.data(), buffer.size());
+    }
+    stream_.flush();
 #else
     throw ImageWriterException("tiff output is not enabled in your build of Mapnik");
 #endif
@@ -331,7 +331,7 @@ void handle_webp_options(std::string const& type,
 }
 #endif
 
-webp_saver::webp_saver(std::ostream & stream, std::string const& t):
+webp_saver::webp_saver(image_sink & stream, std::string const& t):
     stream_(stream), t_(t) {}
 
 template<>
@@ -341,7 +341,7 @@ void webp_saver::operator()<image_null> (image_null const& image) const
 }
 
 template <typename T>
-void process_rgba8_webp(T const& image, std::string const& t, std::ostream & stream)
+void process_rgba8_webp(T const& image, std::string const& t, image_sink & stream)
 {
 #if defined(HAVE_WEBP)
     WebPConfig config;
@@ -39,9 +39,15 @@ extern "C"
 #pragma GCC diagnostic pop
 
 // std
+#include <algorithm>
 #include <cstdio>
 #include <memory>
 
+// libjpeg-turbo can skip rows and crop columns of the output while decoding
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) && LIBJPEG_TURBO_VERSION_NUMBER >= 2000000
+#define MAPNIK_JPEG_SKIP_AND_CROP
+#endif
+
 namespace mapnik
 {
 
@@ -52,6 +58,8 @@ public:
     using source_type = T;
     using input_stream = boost::iostreams::stream<source_type>;
     const static unsigned BUF_SIZE = 4096;
+    // DCT scaling decodes at 1/2, 1/4 and 1/8 of the full size
+    const static unsigned MAX_SCALE_LEVEL = 3;
 private:
     struct jpeg_stream_wrapper
     {
@@ -87,8 +95,13 @@ public:
     inline bool has_alpha() const final { return false; }
     void read(unsigned x,unsigned y,image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    unsigned overview_count() const final;
+    std::pair<unsigned, unsigned> overview_size(unsigned level) const final;
+    bool scaled_overviews() const final { return true; }
+    image_any read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height) final;
 private:
     void init();
+    void read_scaled(unsigned level, unsigned x, unsigned y, image_rgba8& image);
     static void on_error(j_common_ptr cinfo);
     static void on_error_message(j_common_ptr cinfo);
     static void init_source(j_decompress_ptr cinfo);
@@ -264,8 +277,29 @@ boost::optional<box2d<double> > jpeg_reader<T>::bounding_box() const
     return boost::optional<box2d<double> >();
 }
 
+template <typename T>
+unsigned jpeg_reader<T>::overview_count() const
+{
+    return MAX_SCALE_LEVEL;
+}
+
+template <typename T>
+std::pair<unsigned, unsigned> jpeg_reader<T>::overview_size(unsigned level) const
+{
+    if (level > MAX_SCALE_LEVEL) throw image_reader_exception("JPEG Reader: no such overview level");
+    // rounded up, as libjpeg sizes its scaled output
+    unsigned scale = 1u << level;
+    return std::make_pair((width_ + scale - 1) / scale, (height_ + scale - 1) / scale);
+}
+
 template <typename T>
 void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
+{
+    read_scaled(0, x0, y0, image);
+}
+
+template <typename T>
+void jpeg_reader<T>::read_scaled(unsigned level, unsigned x0, unsigned y0, image_rgba8& image)
 {
     stream_.clear();
     stream_.seekg(0, std::ios_base::beg);
@@ -280,26 +314,55 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
     attach_stream(&cinfo, &stream_);
     int ret = jpeg_read_header(&cinfo, TRUE);
     if (ret != JPEG_HEADER_OK) throw image_reader_exception("JPEG Reader read(): failed to read header");
+    // scaling happens in the inverse DCT, at 1/8 only the DC coefficient
+    // of each block is used
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1u << level;
     jpeg_start_decompress(&cinfo);
+    unsigned output_width = cinfo.output_width;
+    unsigned output_height = cinfo.output_height;
+    if (x0 >= output_width || y0 >= output_height)
+    {
+        jpeg_abort_decompress(&cinfo);
+        return;
+    }
+    unsigned w = std::min(unsigned(image.width()), output_width - x0);
+    unsigned h = std::min(unsigned(image.height()), output_height - y0);
+    unsigned col0 = x0;
+#if defined(MAPNIK_JPEG_SKIP_AND_CROP)
+    if (w < output_width)
+    {
+        // only decode the iMCU columns under the window, the crop is widened
+        // to iMCU boundaries and output_width becomes the cropped width. One
+        // more column on either side keeps fancy upsampling from replicating
+        // the crop edge into the window.
+        JDIMENSION crop_x = x0 > 0 ? x0 - 1 : 0;
+        JDIMENSION crop_width = std::min(x0 + w + 1, output_width) - crop_x;
+        jpeg_crop_scanline(&cinfo, &crop_x, &crop_width);
+        col0 = x0 - crop_x;
+    }
+    if (y0 > 0)
+    {
+        jpeg_skip_scanlines(&cinfo, y0);
+    }
+#endif
     JSAMPARRAY buffer;
     int row_stride;
     unsigned char a,r,g,b;
     row_stride = cinfo.output_width * cinfo.output_components;
     buffer = (*cinfo.mem->alloc_sarray) ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
 
-    unsigned w = std::min(unsigned(image.width()),width_ - x0);
-    unsigned h = std::min(unsigned(image.height()),height_ - y0);
-
     const std::unique_ptr<unsigned int[]> out_row(new unsigned int[w]);
-    unsigned row = 0;
-    while (cinfo.output_scanline < cinfo.output_height)
+    // rows below the window are never decoded
+    while (cinfo.output_scanline < y0 + h)
     {
-        jpeg_read_scanlines(&cinfo, buffer, 1);
-        if (row >= y0 && row < y0 + h)
+        unsigned row = cinfo.output_scanline;
+        if (jpeg_read_scanlines(&cinfo, buffer, 1) != 1) break;
+        if (row >= y0)
         {
             for (unsigned int x = 0; x < w; ++x)
             {
-                unsigned col = x + x0;
+                unsigned col = x + col0;
                 a = 255; // alpha not supported in jpg
                 r = buffer[0][cinfo.output_components * col];
                 if (cinfo.output_components > 2)
@@ -314,9 +377,8 @@ void jpeg_reader<T>::read(unsigned x0, unsigned y0, image_rgba8& image)
             }
             image.setRow(row - y0, out_row.get(), w);
         }
-        ++row;
     }
-    jpeg_finish_decompress(&cinfo);
+    jpeg_abort_decompress(&cinfo);
 }
 
 template <typename T>
@@ -327,4 +389,13 @@ image_any jpeg_reader<T>::read(unsigned x, unsigned y, unsigned width, unsigned
     return image_any(std::move(data));
 }
 
+template <typename T>
+image_any jpeg_reader<T>::read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+    if (level > MAX_SCALE_LEVEL) throw image_reader_exception("JPEG Reader: no such overview level");
+    image_rgba8 data(width,height, true, true);
+    read_scaled(level, x, y, data);
+    return image_any(std::move(data));
+}
+
 }
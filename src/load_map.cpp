@@ -243,6 +243,12 @@ void map_parser::parse_map(Map & map, xml_node const& node, std::string const& b
                 map.set_buffer_size(*buffer_size);
             }
 
+            optional<mapnik::boolean_type> deferred_labels = map_node.get_opt_attr<mapnik::boolean_type>("deferred-labels");
+            if (deferred_labels)
+            {
+                map.set_deferred_labels(*deferred_labels);
+            }
+
             optional<std::string> maximum_extent = map_node.get_opt_attr<std::string>("maximum-extent");
             if (maximum_extent)
             {
@@ -1111,6 +1117,7 @@ void map_parser::parse_text_symbolizer(rule & rule, xml_node const& node)
         set_symbolizer_property<symbolizer_base,composite_mode_e>(sym, keys::halo_comp_op, node);
         set_symbolizer_property<symbolizer_base,halo_rasterizer_enum>(sym, keys::halo_rasterizer, node);
         set_symbolizer_property<symbolizer_base,transform_type>(sym, keys::halo_transform, node);
+        set_symbolizer_property<symbolizer_base,double>(sym, keys::priority, node);
         rule.append(std::move(sym));
     }
     catch (config_error const& ex)
@@ -1147,6 +1154,7 @@ void map_parser::parse_shield_symbolizer(rule & rule, xml_node const& node)
         set_symbolizer_property<symbolizer_base,double>(sym, keys::shield_dy, node);
         set_symbolizer_property<symbolizer_base,double>(sym, keys::opacity, node);
         set_symbolizer_property<symbolizer_base,mapnik::boolean_type>(sym, keys::unlock_image, node);
+        set_symbolizer_property<symbolizer_base,double>(sym, keys::priority, node);
 
         std::string file = node.get_attr<std::string>("file");
         if (file.empty())
@@ -23,6 +23,7 @@
 // mapnik
 #include <mapnik/palette.hpp>
 #include <mapnik/miniz_png.hpp>
+#include <mapnik/png_filter.hpp>
 #include <mapnik/image.hpp>
 #include <mapnik/image_view.hpp>
 
@@ -37,13 +38,15 @@ extern "C" {
 #include <zlib.h>
 
 // stl
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <stdexcept>
 
 namespace mapnik { namespace MiniZ {
 
-PNGWriter::PNGWriter(int level, int strategy)
+PNGWriter::PNGWriter(int level, int strategy, bool adaptive_filters)
+    : adaptive_filters_(adaptive_filters)
 {
     buffer = nullptr;
     compressor = nullptr;
@@ -243,7 +246,23 @@ void PNGWriter::writeIDAT(T const& image)
     int bytes_per_pixel = sizeof(typename T::pixel_type);
     int stride = image.width() * bytes_per_pixel;
 
-    for (unsigned int y = 0; y < image.height(); y++)
+    // filtering is only worthwhile for true color, not for palette indices
+    if (adaptive_filters_ && bytes_per_pixel > 1)
+    {
+        std::vector<mz_uint8> filtered(stride + 1);
+        for (unsigned int y = 0; y < image.height(); y++)
+        {
+            png_filter_row(reinterpret_cast<mz_uint8 const*>(image.getRow(y)),
+                           y > 0 ? reinterpret_cast<mz_uint8 const*>(image.getRow(y - 1)) : nullptr,
+                           stride, bytes_per_pixel, filtered.data());
+            status = tdefl_compress_buffer(compressor, filtered.data(), filtered.size(), TDEFL_NO_FLUSH);
+            if (status != TDEFL_STATUS_OKAY)
+            {
+                throw std::runtime_error("failed to compress image");
+            }
+        }
+    }
+    else for (unsigned int y = 0; y < image.height(); y++)
     {
         // Write filter_type
         status = tdefl_compress_buffer(compressor, &filter_type, 1, TDEFL_NO_FLUSH);
@@ -279,14 +298,20 @@ void PNGWriter::writeIDATStripAlpha(T const& image) {
     size_t stride = image.width() * 3;
     size_t i, j;
     mz_uint8 *scanline = (mz_uint8 *)MZ_MALLOC(stride);
+    // previous stripped scanline and filter output, for adaptive filtering only
+    std::vector<mz_uint8> previous(adaptive_filters_ ? stride : 0);
+    std::vector<mz_uint8> filtered(adaptive_filters_ ? stride + 1 : 0);
 
     for (unsigned int y = 0; y < image.height(); y++) {
-        // Write filter_type
-        status = tdefl_compress_buffer(compressor, &filter_type, 1, TDEFL_NO_FLUSH);
-        if (status != TDEFL_STATUS_OKAY)
+        if (!adaptive_filters_)
         {
-            MZ_FREE(scanline);
-            throw std::runtime_error("failed to compress image");
+            // Write filter_type
+            status = tdefl_compress_buffer(compressor, &filter_type, 1, TDEFL_NO_FLUSH);
+            if (status != TDEFL_STATUS_OKAY)
+            {
+                MZ_FREE(scanline);
+                throw std::runtime_error("failed to compress image");
+            }
         }
 
         // Strip alpha bytes from scanline
@@ -298,7 +323,16 @@ void PNGWriter::writeIDATStripAlpha(T const& image) {
         }
 
         // Write scanline
-        status = tdefl_compress_buffer(compressor, scanline, stride, TDEFL_NO_FLUSH);
+        if (adaptive_filters_)
+        {
+            png_filter_row(scanline, y > 0 ? previous.data() : nullptr, stride, 3, filtered.data());
+            std::copy(scanline, scanline + stride, previous.begin());
+            status = tdefl_compress_buffer(compressor, filtered.data(), filtered.size(), TDEFL_NO_FLUSH);
+        }
+        else
+        {
+            status = tdefl_compress_buffer(compressor, scanline, stride, TDEFL_NO_FLUSH);
+        }
         if (status != TDEFL_STATUS_OKAY) {
             MZ_FREE(scanline);
             throw std::runtime_error("failed to compress image");
@@ -325,6 +359,12 @@ void PNGWriter::toStream(std::ostream& stream)
     stream.write((char *)buffer->m_pBuf, buffer->m_size);
 }
 
+void PNGWriter::toStream(image_sink & sink)
+{
+    sink.reserve(buffer->m_size);
+    sink.write((char *)buffer->m_pBuf, buffer->m_size);
+}
+
 const mz_uint8 PNGWriter::preamble[] = {
     0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a
 };
@@ -106,79 +106,107 @@ std::string rgba_palette::to_string() const
     return str.str();
 }
 
+rgba_palette::cache::cache()
+    : keys_(new unsigned[size]()),
+      values_(new unsigned char[size]()) {}
+
 // return color index in returned earlier palette
 unsigned char rgba_palette::quantize(unsigned val) const
 {
-    unsigned char index = 0;
-    if (colors_ == 1 || val == 0) return index;
-
-    rgba_hash_table::iterator it = color_hashmap_.find(val);
+    if (colors_ == 1 || val == 0) return 0;
+    rgba_hash_table::const_iterator it = color_hashmap_.find(val);
     if (it != color_hashmap_.end())
     {
-        index = it->second;
+        return it->second;
     }
-    else
+    return closest(val);
+}
+
+void rgba_palette::quantize(unsigned const* row, unsigned char * out, std::size_t size, cache & c) const
+{
+    unsigned last = 0;
+    unsigned char last_index = quantize(0);
+    for (std::size_t x = 0; x < size; ++x)
     {
-        rgba c(val);
-        int dr, dg, db, da;
-        int dist, newdist;
-
-        // find closest match based on mean of r,g,b,a
-        std::vector<rgba>::const_iterator pit =
-            std::lower_bound(sorted_pal_.begin(), sorted_pal_.end(), c, rgba::mean_sort_cmp());
-        index = std::distance(sorted_pal_.begin(),pit);
-        if (index == sorted_pal_.size()) index--;
-
-        dr = sorted_pal_[index].r - c.r;
-        dg = sorted_pal_[index].g - c.g;
-        db = sorted_pal_[index].b - c.b;
-        da = sorted_pal_[index].a - c.a;
-        dist = dr*dr + dg*dg + db*db + da*da;
-        int poz = index;
-
-        // search neighbour positions in both directions for better match
-        for (int i = poz - 1; i >= 0; i--)
+        unsigned val = row[x];
+        if (val != last)
         {
-            dr = sorted_pal_[i].r - c.r;
-            dg = sorted_pal_[i].g - c.g;
-            db = sorted_pal_[i].b - c.b;
-            da = sorted_pal_[i].a - c.a;
-            // stop criteria based on properties of used sorting
-            if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
+            last = val;
+            // key 0 marks empty slots, which is fine as 0 never gets here
+            unsigned slot = (val * 2654435761u) >> 20;
+            if (c.keys_[slot] == val)
             {
-                break;
+                last_index = c.values_[slot];
             }
-            newdist = dr*dr + dg*dg + db*db + da*da;
-            if (newdist < dist)
+            else
             {
-                index = i;
-                dist = newdist;
+                last_index = quantize(val);
+                c.keys_[slot] = val;
+                c.values_[slot] = last_index;
             }
         }
+        out[x] = last_index;
+    }
+}
+
+unsigned char rgba_palette::closest(unsigned val) const
+{
+    unsigned char index = 0;
+    rgba c(val);
+    int dr, dg, db, da;
+    int dist, newdist;
+
+    // find closest match based on mean of r,g,b,a
+    std::vector<rgba>::const_iterator pit =
+        std::lower_bound(sorted_pal_.begin(), sorted_pal_.end(), c, rgba::mean_sort_cmp());
+    index = std::distance(sorted_pal_.begin(),pit);
+    if (index == sorted_pal_.size()) index--;
+
+    dr = sorted_pal_[index].r - c.r;
+    dg = sorted_pal_[index].g - c.g;
+    db = sorted_pal_[index].b - c.b;
+    da = sorted_pal_[index].a - c.a;
+    dist = dr*dr + dg*dg + db*db + da*da;
+    int poz = index;
 
-        for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
+    // search neighbour positions in both directions for better match
+    for (int i = poz - 1; i >= 0; i--)
+    {
+        dr = sorted_pal_[i].r - c.r;
+        dg = sorted_pal_[i].g - c.g;
+        db = sorted_pal_[i].b - c.b;
+        da = sorted_pal_[i].a - c.a;
+        // stop criteria based on properties of used sorting
+        if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
         {
-            dr = sorted_pal_[i].r - c.r;
-            dg = sorted_pal_[i].g - c.g;
-            db = sorted_pal_[i].b - c.b;
-            da = sorted_pal_[i].a - c.a;
-            // stop criteria based on properties of used sorting
-            if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
-            {
-                break;
-            }
-            newdist = dr*dr + dg*dg + db*db + da*da;
-            if (newdist < dist)
-            {
-                index = i;
-                dist = newdist;
-            }
+            break;
+        }
+        newdist = dr*dr + dg*dg + db*db + da*da;
+        if (newdist < dist)
+        {
+            index = i;
+            dist = newdist;
         }
-
-        // Cache found index for the color c into the hashmap.
-        color_hashmap_[val] = index;
     }
 
+    for (unsigned i = poz + 1; i < sorted_pal_.size(); i++)
+    {
+        dr = sorted_pal_[i].r - c.r;
+        dg = sorted_pal_[i].g - c.g;
+        db = sorted_pal_[i].b - c.b;
+        da = sorted_pal_[i].a - c.a;
+        // stop criteria based on properties of used sorting
+        if ((dr+db+dg+da) * (dr+db+dg+da) / 4 > dist)
+        {
+            break;
+        }
+        newdist = dr*dr + dg*dg + db*db + da*da;
+        if (newdist < dist)
+        {
+            index = i;
+            dist = newdist;
+        }
+    }
     return index;
 }
 
@@ -0,0 +1,233 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/util/parallel.hpp>
+#include <mapnik/utils.hpp>
+
+// stl
+#include <atomic>
+#ifdef MAPNIK_THREADSAFE
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#endif
+
+namespace mapnik {
+
+namespace util {
+
+namespace {
+
+std::atomic<unsigned> band_threads_(1);
+
+#ifdef MAPNIK_THREADSAFE
+
+// One call to run_bands. Bands are claimed through `next`, so the caller
+// and any pool thread that picks the batch up share the work; the caller
+// alone is enough to finish it.
+class band_batch
+{
+public:
+    band_batch(unsigned rows, unsigned bands, detail::band_func call, void const* func)
+        : call_(call),
+          func_(func),
+          rows_(rows),
+          step_((rows + bands - 1) / bands),
+          bands_(bands),
+          next_(0),
+          done_(0) {}
+
+    // Runs one unclaimed band, false once every band has been claimed
+    bool run_one()
+    {
+        unsigned index = next_.fetch_add(1);
+        if (index >= bands_) return false;
+        unsigned begin = index * step_;
+        unsigned end = std::min(rows_, begin + step_);
+        std::exception_ptr error;
+        if (begin < end && !failed_.load())
+        {
+            try
+            {
+                call_(func_, begin, end);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_)
+        {
+            error_ = error;
+            failed_.store(true);
+        }
+        if (++done_ == bands_) finished_.notify_all();
+        return true;
+    }
+
+    bool exhausted() const
+    {
+        return next_.load() >= bands_;
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this] { return done_ == bands_; });
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    detail::band_func call_;
+    void const* func_;
+    unsigned rows_;
+    unsigned step_;
+    unsigned bands_;
+    std::atomic<unsigned> next_;
+    std::atomic<bool> failed_{false};
+    unsigned done_;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable finished_;
+};
+
+// Threads helping run_bands callers. Grown on demand up to band_threads() - 1
+// and shared by every caller in the process.
+class band_pool : public singleton<band_pool, CreateStatic>
+{
+    friend class CreateStatic<band_pool>;
+public:
+    void run(std::shared_ptr<band_batch> const& batch, unsigned helpers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            grow(helpers);
+            queue_.push_back(batch);
+        }
+        wake_.notify_all();
+        while (batch->run_one()) {}
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            auto itr = std::find(queue_.begin(), queue_.end(), batch);
+            if (itr != queue_.end()) queue_.erase(itr);
+        }
+        batch->wait();
+    }
+
+private:
+    band_pool()
+        : stop_(false) {}
+
+    ~band_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread & t : workers_)
+        {
+            t.join();
+        }
+    }
+
+    // called with pool_mutex_ held
+    void grow(unsigned helpers)
+    {
+        try
+        {
+            while (workers_.size() < helpers)
+            {
+                workers_.emplace_back([this] { work(); });
+            }
+        }
+        catch (std::system_error const&)
+        {
+            // out of threads: callers run the remaining bands themselves
+        }
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex_);
+        for (;;)
+        {
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            std::shared_ptr<band_batch> batch = queue_.front();
+            if (batch->exhausted())
+            {
+                queue_.pop_front();
+                continue;
+            }
+            lock.unlock();
+            while (batch->run_one()) {}
+            lock.lock();
+        }
+    }
+
+    bool stop_;
+    std::vector<std::thread> workers_;
+    std::deque<std::shared_ptr<band_batch> > queue_;
+    std::mutex pool_mutex_;
+    std::condition_variable wake_;
+};
+
+#endif
+
+}
+
+    unsigned band_threads()
+    {
+        return band_threads_.load(std::memory_order_relaxed);
+    }
+
+    void set_band_threads(unsigned threads)
+    {
+        band_threads_.store(std::max(1u, threads), std::memory_order_relaxed);
+    }
+
+namespace detail {
+
+void run_bands(unsigned rows, unsigned bands, band_func call, void const* func)
+{
+#ifdef MAPNIK_THREADSAFE
+    auto batch = std::make_shared<band_batch>(rows, bands, call, func);
+    band_pool::instance().run(batch, bands - 1);
+#else
+    call(func, 0, rows);
+#endif
+}
+
+}
+
+} // end namespace util
+
+} // end namespace mapnik
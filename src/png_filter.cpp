@@ -0,0 +1,253 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// stl
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+
+// mapnik
+#include <mapnik/png_filter.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
+
+namespace mapnik {
+
+namespace {
+
+// Each filter computes the residual of byte x from its left (a), upper (b)
+// and upper left (c) neighbours, as a scalar and for 16 bytes at a time.
+
+struct filter_none
+{
+    static constexpr unsigned char type = 0;
+    static unsigned char apply(int x, int, int, int) { return static_cast<unsigned char>(x); }
+#ifdef SSE_MATH
+    static __m128i apply(__m128i x, __m128i, __m128i, __m128i) { return x; }
+#endif
+};
+
+struct filter_sub
+{
+    static constexpr unsigned char type = 1;
+    static unsigned char apply(int x, int a, int, int) { return static_cast<unsigned char>(x - a); }
+#ifdef SSE_MATH
+    static __m128i apply(__m128i x, __m128i a, __m128i, __m128i) { return _mm_sub_epi8(x, a); }
+#endif
+};
+
+struct filter_up
+{
+    static constexpr unsigned char type = 2;
+    static unsigned char apply(int x, int, int b, int) { return static_cast<unsigned char>(x - b); }
+#ifdef SSE_MATH
+    static __m128i apply(__m128i x, __m128i, __m128i b, __m128i) { return _mm_sub_epi8(x, b); }
+#endif
+};
+
+struct filter_average
+{
+    static constexpr unsigned char type = 3;
+    static unsigned char apply(int x, int a, int b, int) { return static_cast<unsigned char>(x - ((a + b) >> 1)); }
+#ifdef SSE_MATH
+    static __m128i apply(__m128i x, __m128i a, __m128i b, __m128i)
+    {
+        // _mm_avg_epu8 rounds up, png rounds down
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+        return _mm_sub_epi8(x, avg);
+    }
+#endif
+};
+
+struct filter_paeth
+{
+    static constexpr unsigned char type = 4;
+    static unsigned char apply(int x, int a, int b, int c)
+    {
+        int pa = std::abs(b - c);
+        int pb = std::abs(a - c);
+        int pc = std::abs(a + b - c - c);
+        int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        return static_cast<unsigned char>(x - pred);
+    }
+#ifdef SSE_MATH
+    static __m128i abs_epi16(__m128i v)
+    {
+        return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+    }
+    static __m128i predict_epi16(__m128i a, __m128i b, __m128i c)
+    {
+        __m128i pa = abs_epi16(_mm_sub_epi16(b, c));
+        __m128i pb = abs_epi16(_mm_sub_epi16(a, c));
+        __m128i pc = abs_epi16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+        __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+        __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+        __m128i bc = _mm_or_si128(_mm_andnot_si128(use_c, b), _mm_and_si128(use_c, c));
+        return _mm_or_si128(_mm_andnot_si128(not_a, a), _mm_and_si128(not_a, bc));
+    }
+    static __m128i apply(__m128i x, __m128i a, __m128i b, __m128i c)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = predict_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+        __m128i hi = predict_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+        return _mm_sub_epi8(x, _mm_packus_epi16(lo, hi));
+    }
+#endif
+};
+
+// Sums the residuals as signed bytes, the heuristic recommended by the png spec.
+struct residual_sum
+{
+    std::size_t sum = 0;
+#ifdef SSE_MATH
+    __m128i acc = _mm_setzero_si128();
+    void operator()(std::size_t, __m128i v)
+    {
+        __m128i abs = _mm_min_epu8(v, _mm_sub_epi8(_mm_setzero_si128(), v));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(abs, _mm_setzero_si128()));
+    }
+    std::size_t total() const
+    {
+        m128_int s;
+        s.v = acc;
+        return sum + s.u32[0] + s.u32[2];
+    }
+#else
+    std::size_t total() const { return sum; }
+#endif
+    void operator()(std::size_t, unsigned char v)
+    {
+        sum += static_cast<std::size_t>(std::abs(static_cast<int>(static_cast<signed char>(v))));
+    }
+};
+
+struct residual_writer
+{
+    unsigned char * out;
+#ifdef SSE_MATH
+    void operator()(std::size_t i, __m128i v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+    }
+#endif
+    void operator()(std::size_t i, unsigned char v)
+    {
+        out[i] = v;
+    }
+};
+
+template <typename Filter, typename Output>
+void filter_row(unsigned char const* row, unsigned char const* prev,
+                std::size_t size, unsigned bpp, Output & output)
+{
+    std::size_t i = 0;
+    for (; i < bpp && i < size; ++i)
+    {
+        output(i, Filter::apply(row[i], 0, prev[i], 0));
+    }
+#ifdef SSE_MATH
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + i));
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row + i - bpp));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(prev + i));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(prev + i - bpp));
+        output(i, Filter::apply(x, a, b, c));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        output(i, Filter::apply(row[i], row[i - bpp], prev[i], prev[i - bpp]));
+    }
+}
+
+template <typename Filter>
+void try_filter(unsigned char const* row, unsigned char const* prev,
+                std::size_t size, unsigned bpp,
+                std::size_t & best_sum, unsigned char & best_type)
+{
+    residual_sum sum;
+    filter_row<Filter>(row, prev, size, bpp, sum);
+    if (sum.total() < best_sum)
+    {
+        best_sum = sum.total();
+        best_type = Filter::type;
+    }
+}
+
+template <typename Filter>
+void write_filtered(unsigned char const* row, unsigned char const* prev,
+                    std::size_t size, unsigned bpp, unsigned char * out)
+{
+    *out = Filter::type;
+    residual_writer writer{out + 1};
+    filter_row<Filter>(row, prev, size, bpp, writer);
+}
+
+}
+
+void png_filter_row(unsigned char const* row,
+                    unsigned char const* prev,
+                    std::size_t size,
+                    unsigned bpp,
+                    unsigned char * out)
+{
+    std::size_t best_sum = std::numeric_limits<std::size_t>::max();
+    unsigned char best_type = filter_none::type;
+    if (prev == nullptr)
+    {
+        // only filters ignoring the (all zero) previous row are worth trying,
+        // so `row` can stand in for it
+        try_filter<filter_none>(row, row, size, bpp, best_sum, best_type);
+        try_filter<filter_sub>(row, row, size, bpp, best_sum, best_type);
+        prev = row;
+    }
+    else
+    {
+        try_filter<filter_none>(row, prev, size, bpp, best_sum, best_type);
+        try_filter<filter_sub>(row, prev, size, bpp, best_sum, best_type);
+        try_filter<filter_up>(row, prev, size, bpp, best_sum, best_type);
+        try_filter<filter_average>(row, prev, size, bpp, best_sum, best_type);
+        try_filter<filter_paeth>(row, prev, size, bpp, best_sum, best_type);
+    }
+    switch (best_type)
+    {
+    case filter_sub::type:
+        write_filtered<filter_sub>(row, prev, size, bpp, out);
+        break;
+    case filter_up::type:
+        write_filtered<filter_up>(row, prev, size, bpp, out);
+        break;
+    case filter_average::type:
+        write_filtered<filter_average>(row, prev, size, bpp, out);
+        break;
+    case filter_paeth::type:
+        write_filtered<filter_paeth>(row, prev, size, bpp, out);
+        break;
+    default:
+        write_filtered<filter_none>(row, prev, size, bpp, out);
+    }
+}
+
+}
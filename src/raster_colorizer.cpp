@@ -28,10 +28,14 @@
 #include <mapnik/raster.hpp>
 #include <mapnik/raster_colorizer.hpp>
 #include <mapnik/enumeration.hpp>
+#include <mapnik/util/parallel.hpp>
 
 // stl
+#include <algorithm>
 #include <limits>
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 namespace mapnik
 {
@@ -122,6 +126,91 @@ bool raster_colorizer::add_stop(colorizer_stop const& stop)
     return true;
 }
 
+namespace {
+
+// Same as std::upper_bound on a non-empty range but without branching on the
+// comparisons, which mispredict on rasters wandering across many stops
+inline std::size_t upper_bound_index(float const* values, std::size_t size, float value)
+{
+    float const* base = values;
+    while (size > 1)
+    {
+        std::size_t half = size / 2;
+        base = (value < base[half]) ? base : base + half;
+        size -= half;
+    }
+    return static_cast<std::size_t>(base - values) + !(value < *base);
+}
+
+// A stop with what raster_colorizer::color_for_stop works out for it resolved
+// up front: the effective mode, the next stop and the channels as floats
+struct stop_segment
+{
+    float value;
+    float next_value;
+    colorizer_mode_enum mode;
+    std::uint32_t rgba;
+    float start[4];
+    float delta[4];
+};
+
+template <typename PixelType, typename ColorFunc>
+void colorize_pixels(std::uint32_t * out, PixelType const* in, unsigned width, unsigned height,
+                     ColorFunc const& pixel_color, std::false_type)
+{
+    util::parallel_rows(height, width, [=, &pixel_color](unsigned begin, unsigned end)
+    {
+        // neighbouring pixels often repeat (flat areas, nodata), reuse the
+        // colour of the previous one when they do
+        std::size_t i = static_cast<std::size_t>(begin) * width;
+        std::size_t i_end = static_cast<std::size_t>(end) * width;
+        if (i == i_end) return;
+        PixelType last = in[i];
+        std::uint32_t last_color = pixel_color(last);
+        for (; i < i_end; ++i)
+        {
+            PixelType value = in[i];
+            if (!(value == last))
+            {
+                last = value;
+                last_color = pixel_color(value);
+            }
+            out[i] = last_color;
+        }
+    });
+}
+
+// 8 and 16 bit rasters have at most 65536 distinct values, each is coloured
+// once and pixels are looked up
+template <typename PixelType, typename ColorFunc>
+void colorize_pixels(std::uint32_t * out, PixelType const* in, unsigned width, unsigned height,
+                     ColorFunc const& pixel_color, std::true_type)
+{
+    using limits = std::numeric_limits<PixelType>;
+    std::size_t lut_size = static_cast<std::size_t>(static_cast<long>(limits::max()) - limits::min() + 1);
+    if (static_cast<std::size_t>(width) * height < lut_size)
+    {
+        colorize_pixels(out, in, width, height, pixel_color, std::false_type());
+        return;
+    }
+    std::vector<std::uint32_t> lut(lut_size);
+    for (std::size_t i = 0; i < lut_size; ++i)
+    {
+        lut[i] = pixel_color(static_cast<PixelType>(limits::min() + static_cast<long>(i)));
+    }
+    std::uint32_t const* lut_data = lut.data();
+    util::parallel_rows(height, width, [=](unsigned begin, unsigned end)
+    {
+        std::size_t i_end = static_cast<std::size_t>(end) * width;
+        for (std::size_t i = static_cast<std::size_t>(begin) * width; i < i_end; ++i)
+        {
+            out[i] = lut_data[in[i] - limits::min()];
+        }
+    });
+}
+
+}
+
 template <typename T>
 void raster_colorizer::colorize(image_rgba8 & out, T const& in,
                                 boost::optional<double> const& nodata,
@@ -132,19 +221,83 @@ void raster_colorizer::colorize(image_rgba8 & out, T const& in,
     // TODO: assuming in/out have the same width/height for now
     std::uint32_t * out_data = out.getData();
     pixel_type const* in_data = in.getData();
-    int len = out.width() * out.height();
-    for (int i=0; i<len; ++i)
+
+    // stops from add_stop are increasing and can be binary searched,
+    // set_stops does not check
+    std::vector<float> values;
+    std::vector<stop_segment> segments;
+    values.reserve(stops_.size());
+    segments.reserve(stops_.size());
+    bool sorted = true;
+    for (std::size_t i = 0; i < stops_.size(); ++i)
+    {
+        colorizer_stop const& stop = stops_[i];
+        colorizer_stop const& next = stops_[std::min(i + 1, stops_.size() - 1)];
+        if (!values.empty() && !(values.back() <= stop.get_value())) sorted = false;
+        values.push_back(stop.get_value());
+        color const& c0 = stop.get_color();
+        color const& c1 = next.get_color();
+        colorizer_mode mode = stop.get_mode();
+        stop_segment seg;
+        seg.value = stop.get_value();
+        seg.next_value = next.get_value();
+        seg.mode = (mode == COLORIZER_INHERIT) ? default_mode_ : mode;
+        seg.rgba = c0.rgba();
+        unsigned const start[4] = { c0.red(), c0.green(), c0.blue(), c0.alpha() };
+        unsigned const end[4] = { c1.red(), c1.green(), c1.blue(), c1.alpha() };
+        for (int k = 0; k < 4; ++k)
+        {
+            seg.start[k] = static_cast<float>(start[k]);
+            seg.delta[k] = static_cast<float>(end[k]) - static_cast<float>(start[k]);
+        }
+        segments.push_back(seg);
+    }
+    std::uint32_t default_rgba = default_color_.rgba();
+    auto pixel_color = [&](pixel_type value) -> std::uint32_t
     {
-        pixel_type value = in_data[i];
         if (nodata && (std::fabs(value - *nodata) < epsilon_))
         {
-            out_data[i] = 0; // rgba(0,0,0,0)
+            return 0; // rgba(0,0,0,0)
         }
-        else
+        if (stops_.empty())
         {
-            out_data[i] = get_color(value);
+            return default_rgba;
         }
-    }
+        if (!sorted)
+        {
+            return color_for_stop(value, find_stop(value));
+        }
+        float v = value;
+        std::size_t idx = upper_bound_index(values.data(), values.size(), v);
+        if (idx == 0)
+        {
+            return color_for_stop(v, -1);
+        }
+        // same arithmetic as color_for_stop, so colours match get_color exactly
+        stop_segment const& seg = segments[idx - 1];
+        switch (seg.mode)
+        {
+        case COLORIZER_LINEAR:
+        {
+            if (seg.next_value == seg.value)
+            {
+                return seg.rgba;
+            }
+            float fraction = (v - seg.value) / (seg.next_value - seg.value);
+            return color(static_cast<unsigned>(fraction * seg.delta[0] + seg.start[0]),
+                         static_cast<unsigned>(fraction * seg.delta[1] + seg.start[1]),
+                         static_cast<unsigned>(fraction * seg.delta[2] + seg.start[2]),
+                         static_cast<unsigned>(fraction * seg.delta[3] + seg.start[3])).rgba();
+        }
+        case COLORIZER_DISCRETE:
+            return seg.rgba;
+        case COLORIZER_EXACT:
+        default:
+            return (std::fabs(v - seg.value) < epsilon_) ? seg.rgba : default_rgba;
+        }
+    };
+    colorize_pixels(out_data, in_data, out.width(), out.height(), pixel_color,
+                    std::integral_constant<bool, std::is_integral<pixel_type>::value && sizeof(pixel_type) <= 2>());
 }
 
 inline unsigned interpolate(unsigned start, unsigned end, float fraction)
@@ -152,35 +305,35 @@ inline unsigned interpolate(unsigned start, unsigned end, float fraction)
     return static_cast<unsigned>(fraction * ((float)end - (float)start) + start);
 }
 
-unsigned raster_colorizer::get_color(float value) const
+int raster_colorizer::find_stop(float value) const
 {
     int stopCount = stops_.size();
-
-    //use default color if no stops
-    if (stopCount == 0)
-    {
-        return default_color_.rgba();
-    }
-
-    //1 - Find the stop that the value is in
-    int stopIdx = -1;
-    bool foundStopIdx = false;
-
     for(int i=0; i<stopCount; ++i)
     {
         if(value < stops_[i].get_value())
         {
-            stopIdx = i-1;
-            foundStopIdx = true;
-            break;
+            return i-1;
         }
     }
+    return stopCount-1;
+}
 
-    if(!foundStopIdx)
+unsigned raster_colorizer::get_color(float value) const
+{
+    //use default color if no stops
+    if (stops_.empty())
     {
-        stopIdx = stopCount-1;
+        return default_color_.rgba();
     }
 
+    //1 - Find the stop that the value is in
+    return color_for_stop(value, find_stop(value));
+}
+
+unsigned raster_colorizer::color_for_stop(float value, int stopIdx) const
+{
+    int stopCount = stops_.size();
+
     //2 - Find the next stop
     int nextStopIdx = stopIdx + 1;
     if(nextStopIdx >= stopCount)
@@ -206,24 +359,14 @@ unsigned raster_colorizer::get_color(float value) const
     }
 
     //4 - Calculate the colour
-    color stopColor;
-    color nextStopColor;
-    float stopValue = 0;
-    float nextStopValue = 0;
-    color outputColor = get_default_color();
-    if(stopIdx == -1)
+    color const* stopColor = &default_color_;
+    color const& nextStopColor = stops_[nextStopIdx].get_color();
+    float stopValue = value;
+    float nextStopValue = stops_[nextStopIdx].get_value();
+    if(stopIdx != -1)
     {
-        stopColor = default_color_;
-        nextStopColor = stops_[nextStopIdx].get_color();
-        stopValue = value;
-        nextStopValue = stops_[nextStopIdx].get_value();
-    }
-    else
-    {
-        stopColor = stops_[stopIdx].get_color();
-        nextStopColor = stops_[nextStopIdx].get_color();
+        stopColor = &stops_[stopIdx].get_color();
         stopValue = stops_[stopIdx].get_value();
-        nextStopValue = stops_[nextStopIdx].get_value();
     }
 
     switch(stopMode)
@@ -233,56 +376,27 @@ unsigned raster_colorizer::get_color(float value) const
         //deal with this separately so we don't have to worry about div0
         if(nextStopValue == stopValue)
         {
-            outputColor = stopColor;
-        }
-        else
-        {
-            float fraction = (value - stopValue) / (nextStopValue - stopValue);
-
-            unsigned r = interpolate(stopColor.red(), nextStopColor.red(),fraction);
-            unsigned g = interpolate(stopColor.green(), nextStopColor.green(),fraction);
-            unsigned b = interpolate(stopColor.blue(), nextStopColor.blue(),fraction);
-            unsigned a = interpolate(stopColor.alpha(), nextStopColor.alpha(),fraction);
-
-            outputColor.set_red(r);
-            outputColor.set_green(g);
-            outputColor.set_blue(b);
-            outputColor.set_alpha(a);
+            return stopColor->rgba();
         }
+        float fraction = (value - stopValue) / (nextStopValue - stopValue);
 
+        unsigned r = interpolate(stopColor->red(), nextStopColor.red(),fraction);
+        unsigned g = interpolate(stopColor->green(), nextStopColor.green(),fraction);
+        unsigned b = interpolate(stopColor->blue(), nextStopColor.blue(),fraction);
+        unsigned a = interpolate(stopColor->alpha(), nextStopColor.alpha(),fraction);
+        return color(r, g, b, a).rgba();
     }
-    break;
     case COLORIZER_DISCRETE:
-        outputColor = stopColor;
-        break;
+        return stopColor->rgba();
     case COLORIZER_EXACT:
     default:
         //approximately equal (within epsilon)
         if(std::fabs(value - stopValue) < epsilon_)
         {
-            outputColor = stopColor;
-        }
-        else
-        {
-            outputColor = default_color_;
+            return stopColor->rgba();
         }
-        break;
+        return default_color_.rgba();
     }
-
-
-    /*
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "raster_colorizer: get_color " << value;
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tstopIdx: " << stopIdx;
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tnextStopIdx: " << nextStopIdx;
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tstopValue: " << stopValue;
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tnextStopValue: " << nextStopValue;
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tstopColor: " << stopColor.to_string();
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tnextStopColor: " << nextStopColor.to_string();
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\tstopMode: " << stopMode.as_string();
-      MAPNIK_LOG_DEBUG(raster_colorizer) << "\toutputColor: " << outputColor.to_string();
-    */
-
-    return outputColor.rgba();
 }
 
 
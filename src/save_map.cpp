@@ -631,6 +631,12 @@ void serialize_map(ptree & pt, Map const& map, bool explicit_defaults)
         set_attr( map_node, "buffer-size", buffer_size );
     }
 
+    bool deferred_labels = map.deferred_labels();
+    if ( deferred_labels || explicit_defaults)
+    {
+        set_attr( map_node, "deferred-labels", deferred_labels );
+    }
+
     std::string const& base_path = map.base_path();
     if ( !base_path.empty() || explicit_defaults)
     {
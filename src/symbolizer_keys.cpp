@@ -158,6 +158,7 @@ static const property_meta_type key_meta[const_max_key] =
                         property_types::target_direction},
     property_meta_type{ "avoid-edges",nullptr, property_types::target_bool },
     property_meta_type{ "font-feature-settings", nullptr, property_types::target_font_feature_settings },
+    property_meta_type{ "priority", nullptr, property_types::target_double },
 
 };
 
@@ -30,6 +30,7 @@
 #include <mapnik/text/text_properties.hpp>
 #include <mapnik/text/glyph_positions.hpp>
 #include <mapnik/vertex_cache.hpp>
+#include <mapnik/tolerance_iterator.hpp>
 #include <mapnik/util/math.hpp>
 
 // agg
@@ -74,6 +75,19 @@ bool placement_finder::next_position()
                                                                info_.properties,
                                                                info_.properties.layout_defaults,
                                                                info_.properties.format_tree());
+        // reuse an identical layout that was already shaped during this render
+        std::string key;
+        if (layout->cache_key(key))
+        {
+            if (text_layout_ptr cached = font_manager_.get_layout(key))
+            {
+                layout = cached;
+            }
+            else
+            {
+                font_manager_.add_layout(key, layout);
+            }
+        }
         // TODO: why is this call needed?
         // https://github.com/mapnik/mapnik/issues/2525
         text_props_ = evaluate_text_properties(info_.properties,feature_,attr_);
@@ -188,6 +202,69 @@ bool placement_finder::find_point_placement(pixel_position const& pos)
     return true;
 }
 
+bool placement_finder::find_line_placements(vertex_cache & pp, bool points)
+{
+    if (!layouts_.line_count()) return true; //TODO
+    pp.reset();
+
+    bool success = false;
+    while (pp.next_subpath())
+    {
+        if (points)
+        {
+            if (pp.length() <= 0.001)
+            {
+                success = find_point_placement(pp.current_position()) || success;
+                continue;
+            }
+        }
+        else
+        {
+            if ((pp.length() < text_props_->minimum_path_length * scale_factor_)
+                ||
+                (pp.length() <= 0.001) // Clipping removed whole geometry
+                ||
+                (pp.length() < layouts_.width()))
+                {
+                    continue;
+                }
+        }
+
+        double spacing = get_spacing(pp.length(), points ? 0. : layouts_.width());
+
+        //horizontal_alignment_e halign = layouts_.back()->horizontal_alignment();
+
+        // halign == H_LEFT -> don't move
+        if (horizontal_alignment_ == H_MIDDLE || horizontal_alignment_ == H_AUTO || horizontal_alignment_ == H_ADJUST)
+        {
+            if (!pp.forward(spacing / 2.0)) continue;
+        }
+        else if (horizontal_alignment_ == H_RIGHT)
+        {
+            if (!pp.forward(pp.length())) continue;
+        }
+
+        if (move_dx_ != 0.0) path_move_dx(pp, move_dx_);
+
+        do
+        {
+            tolerance_iterator tolerance_offset(text_props_->label_position_tolerance * scale_factor_, spacing); //TODO: Handle halign
+            while (tolerance_offset.next())
+            {
+                vertex_cache::scoped_state state(pp);
+                if (pp.move(tolerance_offset.get())
+                    && ((points && find_point_placement(pp.current_position()))
+                        || (!points && single_line_placement(pp, text_props_->upright))))
+                {
+                    success = true;
+                    break;
+                }
+            }
+        } while (pp.forward(spacing));
+    }
+    return success;
+}
+
 bool placement_finder::single_line_placement(vertex_cache &pp, text_upright_e orientation)
 {
     //
@@ -231,7 +308,8 @@ bool placement_finder::single_line_placement(vertex_cache &pp, text_upright_e or
             // centered on the line
             offset -= sign * line.height()/2;
             vertex_cache & off_pp = pp.get_offseted(offset, sign * layout_width);
-            vertex_cache::scoped_state off_state(off_pp); // TODO: Remove this when a clean implementation in vertex_cache::get_offseted is done
+            // off_pp is pp itself for (near) zero offsets, keep pp in place for the following lines
+            vertex_cache::scoped_state off_state(off_pp);
             double line_width = adjust ? (line.glyphs_width() + line.space_count() * adjust_character_spacing) : line.width();
 
             if (!off_pp.move(sign * layout.jalign_offset(line_width) - align_offset.x)) return false;
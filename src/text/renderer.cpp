@@ -29,6 +29,15 @@
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_any.hpp>
 
+// agg
+#include "agg_pixfmt_rgba.h"
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 namespace mapnik
 {
 
@@ -109,6 +118,146 @@ void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y
     }
 }
 
+namespace detail {
+
+// Halo of a run of glyphs sharing the same halo properties (HALO_RASTERIZER_DILATE).
+// The glyph bitmaps are merged into one coverage mask which is dilated with a
+// separable max filter and composited in a single pass, instead of compositing
+// (2r+1)^2 pixels for every glyph pixel.
+class halo_mask : private util::noncopyable
+{
+    struct glyph_bitmap
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+        std::vector<std::uint8_t> data;
+    };
+
+public:
+    bool empty() const
+    {
+        return glyphs_.empty();
+    }
+
+    void add(FT_Bitmap const& bitmap, int x, int y)
+    {
+        int width = bitmap.width;
+        int height = bitmap.rows;
+        if (width <= 0 || height <= 0) return;
+        glyphs_.push_back(glyph_bitmap{x, y, width, height, std::vector<std::uint8_t>(width * height)});
+        std::uint8_t * dst = glyphs_.back().data.data();
+        for (int row = 0; row < height; ++row)
+        {
+            std::uint8_t const* src = bitmap.buffer + row * bitmap.pitch;
+            std::copy(src, src + width, dst + row * width);
+        }
+    }
+
+    template <typename T>
+    void render(T & pixmap, unsigned rgba, int radius, double opacity, composite_mode_e comp_op)
+    {
+        if (glyphs_.empty()) return;
+        int x0 = std::numeric_limits<int>::max();
+        int y0 = std::numeric_limits<int>::max();
+        int x1 = std::numeric_limits<int>::min();
+        int y1 = std::numeric_limits<int>::min();
+        for (glyph_bitmap const& glyph : glyphs_)
+        {
+            x0 = std::min(x0, glyph.x);
+            y0 = std::min(y0, glyph.y);
+            x1 = std::max(x1, glyph.x + glyph.width);
+            y1 = std::max(y1, glyph.y + glyph.height);
+        }
+        x0 -= radius;
+        y0 -= radius;
+        x1 += radius;
+        y1 += radius;
+        int width = x1 - x0;
+        int height = y1 - y0;
+
+        // merge glyph coverage
+        mask_.assign(width * height, 0);
+        for (glyph_bitmap const& glyph : glyphs_)
+        {
+            for (int row = 0; row < glyph.height; ++row)
+            {
+                std::uint8_t const* src = glyph.data.data() + row * glyph.width;
+                std::uint8_t * dst = mask_.data() + (glyph.y - y0 + row) * width + (glyph.x - x0);
+                for (int col = 0; col < glyph.width; ++col)
+                {
+                    dst[col] = std::max(dst[col], src[col]);
+                }
+            }
+        }
+        glyphs_.clear();
+
+        // horizontal max filter
+        tmp_.assign(width * height, 0);
+        for (int row = 0; row < height; ++row)
+        {
+            std::uint8_t const* src = mask_.data() + row * width;
+            std::uint8_t * dst = tmp_.data() + row * width;
+            for (int d = -radius; d <= radius; ++d)
+            {
+                int begin = std::max(0, -d);
+                int end = std::min(width, width - d);
+                for (int col = begin; col < end; ++col)
+                {
+                    dst[col] = std::max(dst[col], src[col + d]);
+                }
+            }
+        }
+
+        // vertical max filter and composite, rows outside the image are skipped
+        using color_type = agg::rgba8;
+        using value_type = color_type::value_type;
+        using blender_type = agg::comp_op_adaptor_rgba<color_type, agg::order_rgba>;
+        unsigned ca = static_cast<unsigned>(((rgba >> 24) & 0xff) * opacity);
+        unsigned cb = (rgba >> 16) & 0xff;
+        unsigned cg = (rgba >> 8) & 0xff;
+        unsigned cr = rgba & 0xff;
+        int col_begin = std::max(0, -x0);
+        int col_end = std::min(width, static_cast<int>(pixmap.width()) - x0);
+        int row_begin = std::max(0, -y0);
+        int row_end = std::min(height, static_cast<int>(pixmap.height()) - y0);
+        if (col_begin >= col_end) return;
+        row_.resize(width);
+        for (int row = row_begin; row < row_end; ++row)
+        {
+            std::fill(row_.begin(), row_.end(), 0);
+            int k_end = std::min(height, row + radius + 1);
+            for (int k = std::max(0, row - radius); k < k_end; ++k)
+            {
+                std::uint8_t const* src = tmp_.data() + k * width;
+                for (int col = col_begin; col < col_end; ++col)
+                {
+                    row_[col] = std::max(row_[col], src[col]);
+                }
+            }
+            typename T::pixel_type * pixels = pixmap.getRow(row + y0);
+            for (int col = col_begin; col < col_end; ++col)
+            {
+                unsigned cover = row_[col];
+                if (cover)
+                {
+                    blender_type::blend_pix(comp_op, reinterpret_cast<value_type*>(&pixels[col + x0]),
+                                            cr, cg, cb, ca, cover);
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<glyph_bitmap> glyphs_;
+    std::vector<std::uint8_t> mask_;
+    std::vector<std::uint8_t> tmp_;
+    std::vector<std::uint8_t> row_;
+};
+
+} // namespace detail
+
 template <typename T>
 agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          halo_rasterizer_e rasterizer,
@@ -158,13 +307,29 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
     double text_opacity = 1.0;
     double halo_opacity = 1.0;
 
+    // HALO_RASTERIZER_DILATE: halos are collected for runs of glyphs with
+    // the same halo style and rendered when the style changes
+    detail::halo_mask mask;
+    int mask_radius = 0;
+
     for (auto const& glyph : glyphs_)
     {
-        halo_fill = glyph.properties.halo_fill.rgba();
-        halo_opacity = glyph.properties.halo_opacity;
+        unsigned glyph_halo_fill = glyph.properties.halo_fill.rgba();
+        double glyph_halo_opacity = glyph.properties.halo_opacity;
         halo_radius = glyph.properties.halo_radius * scale_factor_;
         // make sure we've got reasonable values.
         if (halo_radius <= 0.0 || halo_radius > 1024.0) continue;
+        bool dilate = (rasterizer_ == HALO_RASTERIZER_DILATE && halo_radius >= 1.0);
+        if (!mask.empty() &&
+            (!dilate ||
+             glyph_halo_fill != halo_fill ||
+             glyph_halo_opacity != halo_opacity ||
+             static_cast<int>(halo_radius) != mask_radius))
+        {
+            mask.render(pixmap_, halo_fill, mask_radius, halo_opacity, halo_comp_op_);
+        }
+        halo_fill = glyph_halo_fill;
+        halo_opacity = glyph_halo_opacity;
         FT_Glyph g;
         error = FT_Glyph_Copy(glyph.image, &g);
         if (!error)
@@ -187,6 +352,16 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                                      halo_comp_op_);
                 }
             }
+            else if (dilate)
+            {
+                error = FT_Glyph_To_Bitmap(&g, FT_RENDER_MODE_NORMAL, 0, 1);
+                if (!error)
+                {
+                    FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(g);
+                    mask.add(bit->bitmap, bit->left, height - bit->top);
+                    mask_radius = static_cast<int>(halo_radius);
+                }
+            }
             else
             {
                 error = FT_Glyph_To_Bitmap(&g, FT_RENDER_MODE_NORMAL, 0, 1);
@@ -205,6 +380,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
         }
         FT_Done_Glyph(g);
     }
+    mask.render(pixmap_, halo_fill, mask_radius, halo_opacity, halo_comp_op_);
 
     // render actual text
     for (auto & glyph : glyphs_)
@@ -228,11 +228,18 @@ bool text_symbolizer_helper::next_line_placement() const
             geo_itr_ = geometries_to_process_.begin();
             continue; //Reexecute size check
         }
-        vertex_adapter va(**geo_itr_);
-        converter_.apply(va);
-        if (adapter_.status())
+        auto path_itr = paths_.find(*geo_itr_);
+        if (path_itr == paths_.end())
+        {
+            // convert each geometry only once, not for every placement attempt
+            vertex_adapter va(**geo_itr_);
+            converter_.apply(va);
+            path_itr = paths_.emplace(*geo_itr_, adapter_.release_path()).first;
+        }
+        if (path_itr->second && adapter_.find_line_placements(*path_itr->second))
         {
             //Found a placement
+            paths_.erase(path_itr);
             geo_itr_ = geometries_to_process_.erase(geo_itr_);
             return true;
         }
@@ -179,8 +179,73 @@ mapnik::value_unicode_string const& text_layout::text() const
     return itemizer_.text();
 }
 
+namespace {
+
+template <typename T>
+inline void append_key(std::string & key, T const& val)
+{
+    key.append(reinterpret_cast<char const*>(&val), sizeof(T));
+}
+
+inline void append_key(std::string & key, std::string const& str)
+{
+    append_key(key, str.size());
+    key.append(str);
+}
+
+}
+
+bool text_layout::cache_key(std::string & key) const
+{
+    if (!child_layout_list_.empty()) return false;
+    key.clear();
+    append_key(key, scale_factor_);
+    append_key(key, displacement_.x);
+    append_key(key, displacement_.y);
+    append_key(key, orientation_.sin);
+    append_key(key, orientation_.cos);
+    append_key(key, wrap_char_);
+    append_key(key, wrap_width_);
+    append_key(key, wrap_before_);
+    append_key(key, repeat_wrap_char_);
+    append_key(key, rotate_displacement_);
+    append_key(key, text_ratio_);
+    append_key(key, valign_);
+    append_key(key, halign_);
+    append_key(key, jalign_);
+    itemizer_.for_each_format_run([&key](unsigned start, unsigned end, evaluated_format_properties_ptr const& f)
+    {
+        append_key(key, start);
+        append_key(key, end);
+        append_key(key, f->face_name);
+        if (f->fontset)
+        {
+            append_key(key, f->fontset->get_name());
+            for (auto const& name : f->fontset->get_face_names()) append_key(key, name);
+        }
+        append_key(key, f->text_size);
+        append_key(key, f->character_spacing);
+        append_key(key, f->line_spacing);
+        append_key(key, f->text_opacity);
+        append_key(key, f->halo_opacity);
+        append_key(key, f->text_transform);
+        append_key(key, f->fill.rgba());
+        append_key(key, f->fill.get_premultiplied());
+        append_key(key, f->halo_fill.rgba());
+        append_key(key, f->halo_fill.get_premultiplied());
+        append_key(key, f->halo_radius);
+        append_key(key, f->ff_settings.to_string());
+    });
+    mapnik::value_unicode_string const& text = itemizer_.text();
+    key.append(reinterpret_cast<char const*>(text.getBuffer()), text.length() * sizeof(UChar));
+    return true;
+}
+
 void text_layout::layout()
 {
+    // layouts shared through the layout cache are only processed once
+    if (laid_out_) return;
+    laid_out_ = true;
     unsigned num_lines = itemizer_.num_lines();
     for (unsigned i = 0; i < num_lines; ++i)
     {
@@ -430,6 +495,7 @@ void text_layout::clear()
     width_map_.clear();
     width_ = 0.0;
     height_ = 0.0;
+    laid_out_ = false;
     child_layout_list_.clear();
 }
 
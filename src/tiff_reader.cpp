@@ -36,9 +36,14 @@ extern "C"
 #include <boost/iostreams/device/array.hpp>
 #include <boost/iostreams/stream.hpp>
 #pragma GCC diagnostic pop
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 
 // stl
+#include <algorithm>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 namespace mapnik { namespace impl {
 
@@ -100,6 +105,57 @@ static int tiff_map_proc(thandle_t, tdata_t* , toff_t*)
     return 0;
 }
 
+// Input already in memory, either a mapped file or a caller supplied
+// buffer. libtiff is allowed to map it, so uncompressed strips and tiles
+// are copied straight out of it and nothing goes through stream seeks.
+struct memory_source
+{
+    char const* data;
+    std::size_t size;
+    std::size_t pos;
+};
+
+static toff_t tiff_memory_seek_proc(thandle_t handle, toff_t off, int whence)
+{
+    memory_source * in = reinterpret_cast<memory_source*>(handle);
+    std::size_t base = 0;
+    switch(whence)
+    {
+    case SEEK_CUR:
+        base = in->pos;
+        break;
+    case SEEK_END:
+        base = in->size;
+        break;
+    }
+    // negative offsets arrive wrapped around in the unsigned toff_t
+    in->pos = static_cast<std::size_t>(base + off);
+    return static_cast<toff_t>(in->pos);
+}
+
+static toff_t tiff_memory_size_proc(thandle_t handle)
+{
+    return static_cast<toff_t>(reinterpret_cast<memory_source*>(handle)->size);
+}
+
+static tsize_t tiff_memory_read_proc(thandle_t handle, tdata_t buf, tsize_t size)
+{
+    memory_source * in = reinterpret_cast<memory_source*>(handle);
+    if (size <= 0 || in->pos >= in->size) return 0;
+    std::size_t count = std::min(static_cast<std::size_t>(size), in->size - in->pos);
+    std::memcpy(buf, in->data + in->pos, count);
+    in->pos += count;
+    return static_cast<tsize_t>(count);
+}
+
+static int tiff_memory_map_proc(thandle_t handle, tdata_t* base, toff_t* size)
+{
+    memory_source * in = reinterpret_cast<memory_source*>(handle);
+    *base = const_cast<char*>(in->data);
+    *size = static_cast<toff_t>(in->size);
+    return 1;
+}
+
 }
 
 template <typename T>
@@ -120,9 +176,23 @@ class tiff_reader : public image_reader
         }
     };
 
+    // layout of one image file directory: the full resolution image or
+    // one of its overviews
+    struct directory
+    {
+        tdir_t index;
+        std::size_t width;
+        std::size_t height;
+        int read_method;
+        int rows_per_strip;
+        int tile_width;
+        int tile_height;
+    };
+
 private:
-    source_type source_;
-    input_stream stream_;
+    input_stream stream_; // only opened for files that cannot be mapped
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+    impl::memory_source memory_;
     tiff_ptr tif_;
     int read_method_;
     int rows_per_strip_;
@@ -139,6 +209,8 @@ private:
     unsigned compression_;
     bool has_alpha_;
     bool is_tiled_;
+    std::vector<directory> directories_; // full resolution image first
+    std::size_t level_; // directory the layout members above describe
 
 public:
     enum TiffType {
@@ -155,6 +227,9 @@ public:
     inline bool has_alpha() const final { return has_alpha_; }
     void read(unsigned x,unsigned y,image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    unsigned overview_count() const final;
+    std::pair<unsigned, unsigned> overview_size(unsigned level) const final;
+    image_any read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height) final;
     // methods specific to tiff reader
     unsigned bits_per_sample() const { return bps_; }
     unsigned sample_format() const { return sample_format_; }
@@ -169,6 +244,8 @@ private:
     tiff_reader(const tiff_reader&);
     tiff_reader& operator=(const tiff_reader&);
     void init();
+    void init_overviews(TIFF * tif);
+    void set_directory(std::size_t level);
     void read_generic(unsigned x,unsigned y,image_rgba8& image);
     void read_stripped(unsigned x,unsigned y,image_rgba8& image);
 
@@ -201,8 +278,9 @@ const bool registered2 = register_image_reader("tiff", create_tiff_reader2);
 
 template <typename T>
 tiff_reader<T>::tiff_reader(std::string const& file_name)
-    : source_(file_name, std::ios_base::in | std::ios_base::binary),
-      stream_(source_),
+    : stream_(),
+      region_(),
+      memory_(),
       tif_(nullptr),
       read_method_(generic),
       rows_per_strip_(0),
@@ -217,16 +295,33 @@ tiff_reader<T>::tiff_reader(std::string const& file_name)
       planar_config_(PLANARCONFIG_CONTIG),
       compression_(COMPRESSION_NONE),
       has_alpha_(false),
-      is_tiled_(false)
+      is_tiled_(false),
+      directories_(),
+      level_(0)
 {
-    if (!stream_) throw image_reader_exception("TIFF reader: cannot open file "+ file_name);
+    try
+    {
+        boost::interprocess::file_mapping mapping(file_name.c_str(), boost::interprocess::read_only);
+        region_.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+        memory_.data = static_cast<char const*>(region_->get_address());
+        memory_.size = region_->get_size();
+    }
+    catch (boost::interprocess::interprocess_exception const& ex)
+    {
+        // missing, empty or unmappable file: read it through a stream instead
+        MAPNIK_LOG_DEBUG(tiff_reader) << "cannot map " << file_name << ": " << ex.what();
+        region_.reset();
+        stream_.open(source_type(file_name, std::ios_base::in | std::ios_base::binary));
+        if (!stream_) throw image_reader_exception("TIFF reader: cannot open file "+ file_name);
+    }
     init();
 }
 
 template <typename T>
 tiff_reader<T>::tiff_reader(char const* data, std::size_t size)
-    : source_(data, size),
-      stream_(source_),
+    : stream_(),
+      region_(),
+      memory_(),
       tif_(nullptr),
       read_method_(generic),
       rows_per_strip_(0),
@@ -241,11 +336,14 @@ tiff_reader<T>::tiff_reader(char const* data, std::size_t size)
       planar_config_(PLANARCONFIG_CONTIG),
       compression_(COMPRESSION_NONE),
       has_alpha_(false),
-      is_tiled_(false)
+      is_tiled_(false),
+      directories_(),
+      level_(0)
 {
-    if (!stream_) throw image_reader_exception("TIFF reader: cannot open image stream ");
-    stream_.rdbuf()->pubsetbuf(0, 0);
-    stream_.seekg(0, std::ios::beg);
+    if (!data) throw image_reader_exception("TIFF reader: cannot open image stream ");
+    // read in place, the stream stays closed
+    memory_.data = data;
+    memory_.size = size;
     init();
 }
 
@@ -349,6 +447,91 @@ void tiff_reader<T>::init()
             }
         }
     }
+    directory full = { 0, width_, height_, read_method_, rows_per_strip_, tile_width_, tile_height_ };
+    directories_.push_back(full);
+    init_overviews(tif);
+}
+
+template <typename T>
+void tiff_reader<T>::init_overviews(TIFF * tif)
+{
+    // Pyramidal TIFFs (e.g. GeoTIFFs with internal overviews) chain their
+    // reduced resolution images after the main one. Only those decoding to
+    // the same pixel type as the main image can stand in for it.
+    tdir_t index = 0;
+    while (TIFFReadDirectory(tif))
+    {
+        ++index;
+        std::uint32_t subfile_type = 0;
+        std::uint16_t bps = 0;
+        std::uint16_t sample_format = SAMPLEFORMAT_UINT;
+        std::uint16_t photometric = 0;
+        std::uint16_t bands = 1;
+        std::uint16_t planar_config = PLANARCONFIG_CONTIG;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        TIFFGetField(tif, TIFFTAG_SUBFILETYPE, &subfile_type);
+        TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+        TIFFGetField(tif, TIFFTAG_SAMPLEFORMAT, &sample_format);
+        TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+        TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &bands);
+        TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &planar_config);
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        if (!(subfile_type & FILETYPE_REDUCEDIMAGE) || (subfile_type & FILETYPE_MASK)) continue;
+        if (bps != bps_ || sample_format != sample_format_ || photometric != photometric_ ||
+            bands != bands_ || planar_config != planar_config_) continue;
+        if (width == 0 || height == 0 || width > width_ || height > height_ ||
+            (width == width_ && height == height_)) continue;
+
+        directory dir = { index, width, height, generic, 0, 0, 0 };
+        std::uint32_t rows_per_strip = 0;
+        if (TIFFIsTiled(tif))
+        {
+            std::uint32_t tile_width = 0;
+            std::uint32_t tile_height = 0;
+            TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tile_width);
+            TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_height);
+            if (tile_width == 0 || tile_height == 0) continue;
+            dir.read_method = tiled;
+            dir.tile_width = tile_width;
+            dir.tile_height = tile_height;
+        }
+        else if (TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip) != 0 && rows_per_strip > 0)
+        {
+            dir.read_method = stripped;
+            dir.rows_per_strip = std::min(rows_per_strip, height);
+        }
+        else continue;
+        MAPNIK_LOG_DEBUG(tiff_reader) << "overview " << directories_.size() << ": " << width << "x" << height;
+        directories_.push_back(dir);
+    }
+    std::stable_sort(directories_.begin() + 1, directories_.end(),
+                     [](directory const& a, directory const& b) { return a.width > b.width; });
+    if (!TIFFSetDirectory(tif, 0))
+    {
+        throw image_reader_exception("TIFF reader: cannot return to the first directory");
+    }
+}
+
+template <typename T>
+void tiff_reader<T>::set_directory(std::size_t level)
+{
+    if (level == level_) return;
+    directory const& dir = directories_[level];
+    TIFF* tif = open(stream_);
+    if (!tif || !TIFFSetDirectory(tif, dir.index))
+    {
+        throw image_reader_exception("TIFF reader: cannot read directory " + std::to_string(dir.index));
+    }
+    width_ = dir.width;
+    height_ = dir.height;
+    read_method_ = dir.read_method;
+    rows_per_strip_ = dir.rows_per_strip;
+    tile_width_ = dir.tile_width;
+    tile_height_ = dir.tile_height;
+    is_tiled_ = (dir.read_method == tiled);
+    level_ = level;
 }
 
 template <typename T>
@@ -374,6 +557,37 @@ boost::optional<box2d<double> > tiff_reader<T>::bounding_box() const
     return bbox_;
 }
 
+template <typename T>
+unsigned tiff_reader<T>::overview_count() const
+{
+    return directories_.size() - 1;
+}
+
+template <typename T>
+std::pair<unsigned, unsigned> tiff_reader<T>::overview_size(unsigned level) const
+{
+    if (level >= directories_.size()) throw image_reader_exception("TIFF reader: no such overview level");
+    return std::make_pair(directories_[level].width, directories_[level].height);
+}
+
+template <typename T>
+image_any tiff_reader<T>::read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+    if (level >= directories_.size()) throw image_reader_exception("TIFF reader: no such overview level");
+    set_directory(level);
+    try
+    {
+        image_any data = read(x, y, width, height);
+        set_directory(0);
+        return data;
+    }
+    catch (...)
+    {
+        set_directory(0);
+        throw;
+    }
+}
+
 template <typename T>
 void tiff_reader<T>::read(unsigned x,unsigned y,image_rgba8& image)
 {
@@ -619,9 +833,9 @@ void tiff_reader<T>::read_tiled(unsigned x0,unsigned y0, ImageData & image)
         int width = image.width();
         int height = image.height();
         int start_y = (y0 / tile_height_) * tile_height_;
-        int end_y = ((y0 + height) / tile_height_ + 1) * tile_height_;
+        int end_y = ((y0 + height + tile_height_ - 1) / tile_height_) * tile_height_;
         int start_x = (x0 / tile_width_) * tile_width_;
-        int end_x = ((x0 + width) / tile_width_ + 1) * tile_width_;
+        int end_x = ((x0 + width + tile_width_ - 1) / tile_width_) * tile_width_;
         end_y = std::min(end_y, int(height_));
         end_x = std::min(end_x, int(width_));
 
@@ -690,7 +904,19 @@ void tiff_reader<T>::read_stripped(unsigned x0,unsigned y0,image_rgba8& image)
 template <typename T>
 TIFF* tiff_reader<T>::open(std::istream & input)
 {
-    if (!tif_)
+    if (!tif_ && memory_.data)
+    {
+        tif_ = tiff_ptr(TIFFClientOpen("tiff_input_memory", "rc",
+                                       reinterpret_cast<thandle_t>(&memory_),
+                                       impl::tiff_memory_read_proc,
+                                       impl::tiff_write_proc,
+                                       impl::tiff_memory_seek_proc,
+                                       impl::tiff_close_proc,
+                                       impl::tiff_memory_size_proc,
+                                       impl::tiff_memory_map_proc,
+                                       impl::tiff_unmap_proc), tiff_closer());
+    }
+    else if (!tif_)
     {
         tif_ = tiff_ptr(TIFFClientOpen("tiff_input_stream", "rcm",
                                        reinterpret_cast<thandle_t>(&input),
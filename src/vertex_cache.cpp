@@ -28,6 +28,34 @@
 namespace mapnik
 {
 
+// Path interface over a single subpath, offset lines are built for each subpath on its own.
+class vertex_cache::subpath_adapter
+{
+public:
+    explicit subpath_adapter(segment_vector const& subpath)
+        : subpath_(subpath),
+          itr_(subpath.vector.begin()) {}
+
+    void rewind(unsigned)
+    {
+        itr_ = subpath_.vector.begin();
+    }
+
+    unsigned vertex(double *x, double *y)
+    {
+        if (itr_ == subpath_.vector.end()) return agg::path_cmd_stop;
+        *x = itr_->pos.x;
+        *y = itr_->pos.y;
+        unsigned cmd = (itr_ == subpath_.vector.begin()) ? agg::path_cmd_move_to : agg::path_cmd_line_to;
+        ++itr_;
+        return cmd;
+    }
+
+private:
+    segment_vector const& subpath_;
+    std::vector<segment>::const_iterator itr_;
+};
+
 vertex_cache::vertex_cache(vertex_cache && rhs)
     : current_position_(std::move(rhs.current_position_)),
       segment_starting_point_(std::move(rhs.segment_starting_point_)),
@@ -141,17 +169,24 @@ vertex_cache & vertex_cache::get_offseted(double offset, double region_width)
         return *this;
     }
 
-    offseted_lines_map::iterator pos = offseted_lines_.find(offset);
+    std::size_t subpath_index = current_subpath_ - subpaths_.begin();
+    offseted_lines_map::iterator pos = offseted_lines_.find(std::make_pair(subpath_index, offset));
     if (pos == offseted_lines_.end())
     {
-        offset_converter<vertex_cache> converter(*this);
+        subpath_adapter subpath(*current_subpath_);
+        offset_converter<subpath_adapter> converter(subpath);
         converter.set_offset(offset);
-        pos = offseted_lines_.emplace(offset, std::make_unique<vertex_cache>(converter)).first;
+        pos = offseted_lines_.emplace(std::make_pair(subpath_index, offset),
+                                      std::make_unique<vertex_cache>(converter)).first;
     }
     vertex_cache_ptr & offseted_line = pos->second;
 
     offseted_line->reset();
-    offseted_line->next_subpath(); //TODO: Multiple subpath support
+    if (!offseted_line->next_subpath())
+    {
+        // degenerated offset line
+        return *this;
+    }
 
     // find the point on the offset line closest to the current position,
     // which we'll use to make the offset line aligned to this one.
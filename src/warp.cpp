@@ -22,6 +22,7 @@
 
 // mapnik
 #include <mapnik/warp.hpp>
+#include <mapnik/warp_mesh_cache.hpp>
 #include <mapnik/config.hpp>
 #include <mapnik/image.hpp>
 #include <mapnik/image_scaling_traits.hpp>
@@ -30,6 +31,8 @@
 #include <mapnik/view_transform.hpp>
 #include <mapnik/raster.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/util/parallel.hpp>
 
 // agg
 #include "agg_image_filters.h"
@@ -46,8 +49,83 @@
 #include "agg_image_accessors.h"
 #include "agg_renderer_scanline.h"
 
+// stl
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace mapnik {
 
+namespace {
+
+warp_mesh_ptr reprojected_mesh(proj_transform const& prj_trans, box2d<double> const& source_ext,
+                               std::size_t width, std::size_t height, unsigned mesh_size)
+{
+    warp_mesh_cache::key_type key{prj_trans.source().params(), prj_trans.dest().params(),
+                                  source_ext, width, height, mesh_size};
+    warp_mesh_ptr cached = warp_mesh_cache::instance().find(key);
+    if (cached) return cached;
+
+    view_transform ts(width, height, source_ext);
+    std::size_t mesh_nx = std::ceil(width/double(mesh_size) + 1);
+    std::size_t mesh_ny = std::ceil(height/double(mesh_size) + 1);
+    std::shared_ptr<warp_mesh> mesh = std::make_shared<warp_mesh>(mesh_nx, mesh_ny);
+    image_gray64f & xs = mesh->xs;
+    image_gray64f & ys = mesh->ys;
+
+    // Precalculate reprojected mesh
+    for(std::size_t j = 0; j < mesh_ny; ++j)
+    {
+        for (std::size_t i=0; i<mesh_nx; ++i)
+        {
+            xs(i,j) = std::min(i*mesh_size,width);
+            ys(i,j) = std::min(j*mesh_size,height);
+            ts.backward(&xs(i,j), &ys(i,j));
+        }
+    }
+    prj_trans.backward(xs.getData(), ys.getData(), nullptr, mesh_nx*mesh_ny);
+    warp_mesh_cache::instance().insert(key, mesh);
+    return mesh;
+}
+
+// A mesh cell projected into target pixels
+struct warp_cell
+{
+    double polygon[8];
+    double min_y;
+    double max_y;
+    std::size_t x0;
+    std::size_t y0;
+    std::size_t x1;
+    std::size_t y1;
+};
+
+// agg::render_scanlines_bin restricted to the rows [begin, end)
+template <typename Rasterizer, typename Scanline, typename BaseRenderer,
+          typename SpanAllocator, typename SpanGenerator>
+void render_band_scanlines(Rasterizer & ras, Scanline & sl, BaseRenderer & ren,
+                           SpanAllocator & alloc, SpanGenerator & span_gen,
+                           int begin, int end)
+{
+    if (ras.rewind_scanlines())
+    {
+        sl.reset(ras.min_x(), ras.max_x());
+        span_gen.prepare();
+        while (ras.sweep_scanline(sl))
+        {
+            if (sl.y() >= end) break;
+            if (sl.y() >= begin)
+            {
+                agg::render_scanline_bin(sl, ren, alloc, span_gen);
+            }
+        }
+    }
+}
+
+}
+
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                  box2d<double> const& target_ext, box2d<double> const& source_ext,
@@ -62,77 +140,86 @@ MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const&
 
     constexpr std::size_t pixel_size = sizeof(pixel_type);
 
-    view_transform ts(source.width(), source.height(),
-                      source_ext);
     view_transform tt(target.width(), target.height(),
                       target_ext, offset_x, offset_y);
 
-    std::size_t mesh_nx = std::ceil(source.width()/double(mesh_size) + 1);
-    std::size_t mesh_ny = std::ceil(source.height()/double(mesh_size) + 1);
+    warp_mesh_ptr mesh = reprojected_mesh(prj_trans, source_ext, source.width(), source.height(), mesh_size);
+    image_gray64f const& xs = mesh->xs;
+    image_gray64f const& ys = mesh->ys;
+    std::size_t mesh_nx = xs.width();
+    std::size_t mesh_ny = xs.height();
 
-    image_gray64f xs(mesh_nx, mesh_ny, false);
-    image_gray64f ys(mesh_nx, mesh_ny, false);
-
-    // Precalculate reprojected mesh
-    for(std::size_t j = 0; j < mesh_ny; ++j)
+    std::vector<warp_cell> cells;
+    cells.reserve((mesh_nx - 1) * (mesh_ny - 1));
+    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
     {
-        for (std::size_t i=0; i<mesh_nx; ++i)
+        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
         {
-            xs(i,j) = std::min(i*mesh_size,source.width());
-            ys(i,j) = std::min(j*mesh_size,source.height());
-            ts.backward(&xs(i,j), &ys(i,j));
+            warp_cell cell = {{xs(i,j), ys(i,j),
+                               xs(i+1,j), ys(i+1,j),
+                               xs(i+1,j+1), ys(i+1,j+1),
+                               xs(i,j+1), ys(i,j+1)}, 0, 0,
+                              i * mesh_size, j * mesh_size,
+                              std::min((i+1) * mesh_size, source.width()),
+                              std::min((j+1) * mesh_size, source.height())};
+            for (int k = 0; k < 8; k += 2)
+            {
+                tt.forward(cell.polygon + k, cell.polygon + k + 1);
+            }
+            cell.min_y = std::min(std::min(cell.polygon[1], cell.polygon[3]),
+                                  std::min(cell.polygon[5], cell.polygon[7]));
+            cell.max_y = std::max(std::max(cell.polygon[1], cell.polygon[3]),
+                                  std::max(cell.polygon[5], cell.polygon[7]));
+            cells.push_back(cell);
         }
     }
-    prj_trans.backward(xs.getData(), ys.getData(), nullptr, mesh_nx*mesh_ny);
 
-    agg::rasterizer_scanline_aa<> rasterizer;
-    agg::scanline_bin scanline;
-    agg::rendering_buffer buf(target.getBytes(),
-                              target.width(),
-                              target.height(),
-                              target.width() * pixel_size);
-    pixfmt_pre pixf(buf);
-    renderer_base rb(pixf);
-    rasterizer.clip_box(0, 0, target.width(), target.height());
-    agg::rendering_buffer buf_tile(
-        const_cast<unsigned char*>(source.getBytes()),
-        source.width(),
-        source.height(),
-        source.width() * pixel_size);
-
-    pixfmt_pre pixf_tile(buf_tile);
-
-    using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
-    img_accessor_type ia(pixf_tile);
-
-    agg::span_allocator<color_type> sa;
-    // Project mesh cells into target interpolating raster inside each one
-    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
+    // the filter weights are the same for every cell
+    agg::image_filter_lut filter;
+    if (scaling_method != SCALING_NEAR)
     {
-        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
-        {
-            double polygon[8] = {xs(i,j), ys(i,j),
-                                 xs(i+1,j), ys(i+1,j),
-                                 xs(i+1,j+1), ys(i+1,j+1),
-                                 xs(i,j+1), ys(i,j+1)};
-            tt.forward(polygon+0, polygon+1);
-            tt.forward(polygon+2, polygon+3);
-            tt.forward(polygon+4, polygon+5);
-            tt.forward(polygon+6, polygon+7);
+        detail::set_scaling_method(filter, scaling_method, filter_factor);
+    }
+
+    // Each band of target rows rasterizes the cells reaching into it and
+    // only renders its own scanlines, in the same cell order as a single
+    // pass, so the result does not depend on the number of bands
+    util::parallel_rows(target.height(), target.width(), [&](unsigned begin, unsigned end)
+    {
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_bin scanline;
+        agg::rendering_buffer buf(target.getBytes(),
+                                  target.width(),
+                                  target.height(),
+                                  target.width() * pixel_size);
+        pixfmt_pre pixf(buf);
+        renderer_base rb(pixf);
+        rasterizer.clip_box(0, 0, target.width(), target.height());
+        agg::rendering_buffer buf_tile(
+            const_cast<unsigned char*>(source.getBytes()),
+            source.width(),
+            source.height(),
+            source.width() * pixel_size);
+
+        pixfmt_pre pixf_tile(buf_tile);
+
+        using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
+        img_accessor_type ia(pixf_tile);
 
+        agg::span_allocator<color_type> sa;
+        // Project mesh cells into target interpolating raster inside each one
+        for (warp_cell const& cell : cells)
+        {
+            // rasterized vertices are floored, a row past them is safe
+            if (cell.max_y + 1 < begin || cell.min_y - 1 >= end) continue;
+            double const* polygon = cell.polygon;
             rasterizer.reset();
             rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
             rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
             rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
             rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
 
-            std::size_t x0 = i * mesh_size;
-            std::size_t y0 = j * mesh_size;
-            std::size_t x1 = (i+1) * mesh_size;
-            std::size_t y1 = (j+1) * mesh_size;
-            x1 = std::min(x1, source.width());
-            y1 = std::min(y1, source.height());
-            agg::trans_affine tr(polygon, x0, y0, x1, y1);
+            agg::trans_affine tr(polygon, cell.x0, cell.y0, cell.x1, cell.y1);
             if (tr.is_valid())
             {
                 interpolator_type interpolator(tr);
@@ -140,20 +227,17 @@ MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const&
                 {
                     using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
                     span_gen_type sg(ia, interpolator);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    render_band_scanlines(rasterizer, scanline, rb, sa, sg, begin, end);
                 }
                 else
                 {
                     using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
-                    agg::image_filter_lut filter;
-                    detail::set_scaling_method(filter, scaling_method, filter_factor);
                     span_gen_type sg(ia, interpolator, filter);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    render_band_scanlines(rasterizer, scanline, rb, sa, sg, begin, end);
                 }
             }
-
         }
-    }
+    });
 }
 
 namespace detail {
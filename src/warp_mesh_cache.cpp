@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/warp_mesh_cache.hpp>
+
+// stl
+#include <functional>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+namespace {
+
+template <typename T>
+inline void hash_combine(std::size_t & seed, T const& v)
+{
+    seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+std::size_t mesh_bytes(warp_mesh const& mesh)
+{
+    return mesh.xs.getSize() + mesh.ys.getSize();
+}
+
+}
+
+std::size_t warp_mesh_cache::key_hash::operator()(key_type const& key) const
+{
+    std::size_t seed = std::hash<std::string>()(key.source_srs);
+    hash_combine(seed, key.dest_srs);
+    hash_combine(seed, key.source_ext.minx());
+    hash_combine(seed, key.source_ext.miny());
+    hash_combine(seed, key.source_ext.maxx());
+    hash_combine(seed, key.source_ext.maxy());
+    hash_combine(seed, key.width);
+    hash_combine(seed, key.height);
+    hash_combine(seed, key.mesh_size);
+    return seed;
+}
+
+warp_mesh_cache::warp_mesh_cache()
+    : meshes_(),
+      index_(),
+      bytes_(0),
+      max_bytes_(16 * 1024 * 1024) {}
+
+warp_mesh_ptr warp_mesh_cache::find(key_type const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    auto itr = index_.find(key);
+    if (itr == index_.end())
+    {
+        return warp_mesh_ptr();
+    }
+    meshes_.splice(meshes_.begin(), meshes_, itr->second);
+    return itr->second->second;
+}
+
+void warp_mesh_cache::insert(key_type const& key, warp_mesh_ptr const& mesh)
+{
+    std::size_t bytes = mesh_bytes(*mesh);
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    // another thread may have reprojected the same mesh meanwhile
+    if (bytes > max_bytes_ || index_.find(key) != index_.end())
+    {
+        return;
+    }
+    meshes_.emplace_front(key, mesh);
+    index_.emplace(key, meshes_.begin());
+    bytes_ += bytes;
+    evict();
+}
+
+void warp_mesh_cache::evict()
+{
+    while (bytes_ > max_bytes_ && !meshes_.empty())
+    {
+        auto const& last = meshes_.back();
+        bytes_ -= mesh_bytes(*last.second);
+        index_.erase(last.first);
+        meshes_.pop_back();
+    }
+}
+
+void warp_mesh_cache::set_max_bytes(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    max_bytes_ = bytes;
+    evict();
+}
+
+std::size_t warp_mesh_cache::max_bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return max_bytes_;
+}
+
+std::size_t warp_mesh_cache::bytes() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return bytes_;
+}
+
+std::size_t warp_mesh_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    return meshes_.size();
+}
+
+void warp_mesh_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mapnik::scoped_lock lock(mutex_);
+#endif
+    index_.clear();
+    meshes_.clear();
+    bytes_ = 0;
+}
+
+}
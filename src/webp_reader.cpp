@@ -43,6 +43,7 @@ extern "C"
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
 #include <fstream>
 
 namespace mapnik
@@ -98,6 +99,8 @@ template <typename T>
 class webp_reader : public image_reader
 {
     using buffer_policy_type = T;
+    // overviews at 1/2, 1/4 and 1/8 of the full size, scaled while decoding
+    const static unsigned MAX_SCALE_LEVEL = 3;
 private:
     struct config_guard
     {
@@ -126,8 +129,13 @@ public:
     inline bool has_alpha() const final { return has_alpha_; }
     void read(unsigned x,unsigned y,image_rgba8& image) final;
     image_any read(unsigned x, unsigned y, unsigned width, unsigned height) final;
+    unsigned overview_count() const final;
+    std::pair<unsigned, unsigned> overview_size(unsigned level) const final;
+    bool scaled_overviews() const final { return true; }
+    image_any read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height) final;
 private:
     void init();
+    void read_scaled(unsigned level, unsigned x, unsigned y, image_rgba8& image);
 };
 
 namespace
@@ -235,9 +243,38 @@ boost::optional<box2d<double> > webp_reader<T>::bounding_box() const
     return boost::optional<box2d<double> >();
 }
 
+template <typename T>
+unsigned webp_reader<T>::overview_count() const
+{
+    return MAX_SCALE_LEVEL;
+}
+
+template <typename T>
+std::pair<unsigned, unsigned> webp_reader<T>::overview_size(unsigned level) const
+{
+    if (level > MAX_SCALE_LEVEL) throw image_reader_exception("WEBP reader: no such overview level");
+    unsigned scale = 1u << level;
+    return std::make_pair((width_ + scale - 1) / scale, (height_ + scale - 1) / scale);
+}
+
 template <typename T>
 void webp_reader<T>::read(unsigned x0, unsigned y0,image_rgba8& image)
 {
+    read_scaled(0, x0, y0, image);
+}
+
+template <typename T>
+void webp_reader<T>::read_scaled(unsigned level, unsigned x0, unsigned y0, image_rgba8& image)
+{
+    // the window is cropped at full resolution, then scaled row by row as
+    // it is decoded, so no full size output buffer is ever allocated
+    unsigned scale = 1u << level;
+    unsigned crop_x = x0 * scale;
+    unsigned crop_y = y0 * scale;
+    if (crop_x >= width_ || crop_y >= height_) return;
+    unsigned crop_width = std::min(width_ - crop_x, static_cast<unsigned>(image.width()) * scale);
+    unsigned crop_height = std::min(height_ - crop_y, static_cast<unsigned>(image.height()) * scale);
+
     WebPDecoderConfig config;
     config_guard guard(config);
     if (!WebPInitDecoderConfig(&config))
@@ -246,10 +283,16 @@ void webp_reader<T>::read(unsigned x0, unsigned y0,image_rgba8& image)
     }
 
     config.options.use_cropping = 1;
-    config.options.crop_left = x0;
-    config.options.crop_top = y0;
-    config.options.crop_width = std::min(static_cast<std::size_t>(width_ - x0), image.width());
-    config.options.crop_height = std::min(static_cast<std::size_t>(height_ - y0), image.height());
+    config.options.crop_left = crop_x;
+    config.options.crop_top = crop_y;
+    config.options.crop_width = crop_width;
+    config.options.crop_height = crop_height;
+    if (level > 0)
+    {
+        config.options.use_scaling = 1;
+        config.options.scaled_width = (crop_width + scale - 1) / scale;
+        config.options.scaled_height = (crop_height + scale - 1) / scale;
+    }
 
     if (WebPGetFeatures(buffer_->data(), buffer_->size(), &config.input) != VP8_STATUS_OK)
     {
@@ -275,4 +318,13 @@ image_any webp_reader<T>::read(unsigned x, unsigned y, unsigned width, unsigned
     return image_any(std::move(data));
 }
 
+template <typename T>
+image_any webp_reader<T>::read_overview(unsigned level, unsigned x, unsigned y, unsigned width, unsigned height)
+{
+    if (level > MAX_SCALE_LEVEL) throw image_reader_exception("WEBP reader: no such overview level");
+    image_rgba8 data(width,height);
+    read_scaled(level, x, y, data);
+    return image_any(std::move(data));
+}
+
 }
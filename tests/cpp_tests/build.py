@@ -43,6 +43,8 @@ else:
             test_env_local = test_env.Clone()
             if 'csv_parse' in cpp_test:
                 source_files += glob.glob('../../plugins/input/csv/' + '*.cpp')
+            if 'pgraster_wkb_reader' in cpp_test:
+                source_files += ['../../plugins/input/pgraster/pgraster_wkb_reader.cpp']
             test_program = test_env_local.Program(name, source=source_files)
             Depends(test_program, env.subst('../../src/%s' % env['MAPNIK_LIB_NAME']))
             Depends(test_program, env.subst('../../src/json/libmapnik-json${LIBSUFFIX}'))
@@ -3,9 +3,11 @@
 #include <mapnik/image.hpp>
 #include <mapnik/image_reader.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/image_sink.hpp>
 #include <mapnik/util/fs.hpp>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
 #if defined(HAVE_CAIRO)
 #include <mapnik/cairo/cairo_context.hpp>
 #include <mapnik/cairo/cairo_image_util.hpp>
@@ -111,6 +113,106 @@ int main(int argc, char** argv)
         }
 #endif
 
+    {
+        // encoding into a sink appends to the caller's buffer, and the
+        // bytes it appends decode back to the image
+        mapnik::image_rgba8 im(64,64);
+        for (unsigned y = 0; y < im.height(); ++y)
+        {
+            for (unsigned x = 0; x < im.width(); ++x)
+            {
+                // 8x8 blocks of 64 colours, few enough for png8 to keep them all
+                im(x,y) = 0xff800000 | ((x / 8) * 32) | (((y / 8) * 32) << 8);
+            }
+        }
+        // the largest channel difference each format may decode with, none for lossless ones
+        std::vector<std::pair<std::string, int> > formats;
+#if defined(HAVE_PNG)
+        formats.emplace_back("png", 0);
+        formats.emplace_back("png8", 0);
+#endif
+#if defined(HAVE_JPEG)
+        formats.emplace_back("jpeg", 48);
+#endif
+#if defined(HAVE_TIFF)
+        formats.emplace_back("tiff", 0);
+#endif
+#if defined(HAVE_WEBP)
+        formats.emplace_back("webp", 48);
+#endif
+        for (auto const& format : formats)
+        {
+            std::string buffer("prefix");
+            mapnik::string_sink sink(buffer);
+            mapnik::save_to_sink(im, sink, format.first);
+            BOOST_TEST( buffer.size() > 6 );
+            BOOST_TEST( buffer.compare(0, 6, "prefix") == 0 );
+            std::string data = buffer.substr(6);
+            std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(data.data(), data.size()));
+            BOOST_TEST( reader.get() != nullptr );
+            if (!reader) continue;
+            BOOST_TEST_EQ( reader->width(), im.width() );
+            BOOST_TEST_EQ( reader->height(), im.height() );
+            mapnik::image_rgba8 decoded(im.width(), im.height());
+            reader->read(0, 0, decoded);
+            int max_diff = 0;
+            for (unsigned y = 0; y < im.height(); ++y)
+            {
+                for (unsigned x = 0; x < im.width(); ++x)
+                {
+                    for (unsigned shift = 0; shift < 32; shift += 8)
+                    {
+                        int a = (im(x,y) >> shift) & 0xff;
+                        int b = (decoded(x,y) >> shift) & 0xff;
+                        max_diff = std::max(max_diff, std::abs(a - b));
+                    }
+                }
+            }
+            if (max_diff > format.second)
+            {
+                std::clog << format.first << " decodes " << max_diff << " away from the source\n";
+            }
+            BOOST_TEST( max_diff <= format.second );
+        }
+    }
+
+#if defined(HAVE_JPEG)
+    {
+        // scaled and windowed jpeg decoding match a full decode
+        mapnik::image_rgba8 im(100,60);
+        for (unsigned y = 0; y < im.height(); ++y)
+        {
+            for (unsigned x = 0; x < im.width(); ++x)
+            {
+                im(x,y) = 0xff000000 | ((x * 5) & 0xff) | (((y * 3) & 0xff) << 8) | (((x ^ y) & 0xff) << 16);
+            }
+        }
+        std::string data = mapnik::save_to_string(im, "jpeg");
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(data.data(), data.size()));
+        BOOST_TEST( reader->overview_count() == 3 );
+        BOOST_TEST( reader->overview_size(3) == std::make_pair(13u, 8u) );
+        for (unsigned level = 0; level <= reader->overview_count(); ++level)
+        {
+            std::pair<unsigned, unsigned> size = reader->overview_size(level);
+            mapnik::image_any full = reader->read_overview(level, 0, 0, size.first, size.second);
+            mapnik::image_any window = reader->read_overview(level, size.first / 3, size.second / 2,
+                                                             size.first / 2, size.second / 3);
+            BOOST_TEST( full.width() == size.first );
+            mapnik::image_rgba8 const& f = mapnik::util::get<mapnik::image_rgba8>(full);
+            mapnik::image_rgba8 const& w = mapnik::util::get<mapnik::image_rgba8>(window);
+            bool same = true;
+            for (unsigned y = 0; y < w.height(); ++y)
+            {
+                for (unsigned x = 0; x < w.width(); ++x)
+                {
+                    if (w(x,y) != f(x + size.first / 3, y + size.second / 2)) same = false;
+                }
+            }
+            BOOST_TEST( same );
+        }
+    }
+#endif
+
 #if defined(HAVE_WEBP)
         should_throw = "./tests/cpp_tests/data/blank.webp";
         BOOST_TEST( mapnik::util::exists( should_throw ) );
@@ -0,0 +1,140 @@
+#include <iostream>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/image_sink.hpp>
+
+namespace {
+
+// a polygon and a line layer, the styles only draw when `draw` is true
+void add_layers(mapnik::Map & m, bool draw)
+{
+    using namespace mapnik;
+    feature_type_style polygons_style;
+    {
+        rule r;
+        if (!draw) r.set_filter(parse_expression("False"));
+        polygon_symbolizer poly_sym;
+        r.append(std::move(poly_sym));
+        polygons_style.add_rule(std::move(r));
+    }
+    m.insert_style("polygons", std::move(polygons_style));
+
+    feature_type_style lines_style;
+    {
+        rule r;
+        if (!draw) r.set_filter(parse_expression("False"));
+        line_symbolizer line_sym;
+        r.append(std::move(line_sym));
+        lines_style.add_rule(std::move(r));
+    }
+    m.insert_style("lines", std::move(lines_style));
+
+    parameters p;
+    p["type"] = "csv";
+    p["separator"] = "|";
+    p["inline"] = "wkt\nPOLYGON((-10 -10, 10 -10, 10 10, -10 10, -10 -10))";
+
+    layer lyr("layer");
+    lyr.set_datasource(datasource_cache::instance().create(p));
+    lyr.add_style("polygons");
+    lyr.add_style("lines");
+    m.add_layer(lyr);
+    m.zoom_to_box(box2d<double>(-20, -20, 20, 20));
+}
+
+bool render_solid(mapnik::Map const& m, mapnik::image_rgba8 & image)
+{
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, image);
+    ren.apply();
+    return ren.solid();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q") != args.end();
+
+    using namespace mapnik;
+
+    try
+    {
+        datasource_cache::instance().register_datasources("plugins/input/csv.input");
+
+        {
+            // no background: nothing is known about the image
+            Map m(256, 256);
+            add_layers(m, false);
+            image_rgba8 image(m.width(), m.height());
+            BOOST_TEST_EQ(render_solid(m, image), false);
+        }
+
+        {
+            // a background colour and styles that match no feature
+            Map m(256, 256);
+            m.set_background(color(10, 80, 200));
+            add_layers(m, false);
+            image_rgba8 image(m.width(), m.height());
+            BOOST_TEST_EQ(render_solid(m, image), true);
+            BOOST_TEST(is_solid(image));
+#if defined(HAVE_PNG)
+            // the hint skips the scan and gives the bytes of a full encode
+            std::string expected = save_to_string(image, "png");
+            std::string buffer;
+            string_sink sink(buffer);
+            save_to_sink(image, sink, "png", true);
+            BOOST_TEST(buffer == expected);
+#endif
+        }
+
+        {
+            // polygons and lines drawn onto the background
+            Map m(256, 256);
+            m.set_background(color(10, 80, 200));
+            add_layers(m, true);
+            image_rgba8 image(m.width(), m.height());
+            BOOST_TEST_EQ(render_solid(m, image), false);
+            BOOST_TEST(!is_solid(image));
+        }
+
+        {
+            // a background image
+            Map m(256, 256);
+            m.set_background(color(10, 80, 200));
+            m.set_background_image("./tests/data/images/marker.png");
+            add_layers(m, false);
+            image_rgba8 image(m.width(), m.height());
+            BOOST_TEST_EQ(render_solid(m, image), false);
+        }
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << std::endl;
+        BOOST_TEST(false);
+    }
+
+    if (::boost::detail::test_errors())
+    {
+        return ::boost::report_errors();
+    }
+    else
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ image solid: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+}
@@ -0,0 +1,69 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/label_collision_detector.hpp>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        using mapnik::box2d;
+        // two 256x256 tiles side by side with a 64px buffer
+        mapnik::label_collision_detector4 left(box2d<double>(-64, -64, 320, 320));
+        left.insert(box2d<double>(10, 10, 50, 20), mapnik::value_unicode_string::fromUTF8("inside"));
+        left.insert(box2d<double>(240.5, 100, 290.25, 112), mapnik::value_unicode_string::fromUTF8("I-95 \xc3\xa9"));
+        left.insert(box2d<double>(250, 200, 270, 210));
+
+        // labels overlapping the right neighbour
+        box2d<double> region(256, -64, 320, 320);
+        BOOST_TEST_EQ( left.labels_in_box(region).size(), 2u );
+
+        std::ostringstream out;
+        left.save_labels(out, region);
+
+        mapnik::label_collision_detector4 right(box2d<double>(-64, -64, 320, 320));
+        std::istringstream in(out.str());
+        BOOST_TEST( right.load_labels(in, -256, 0) );
+
+        std::vector<mapnik::label_collision_detector4::label> labels = right.labels_in_box(right.extent());
+        BOOST_TEST_EQ( labels.size(), 2u );
+        BOOST_TEST( !right.has_placement(box2d<double>(0, 105, 10, 108)) );
+        BOOST_TEST( right.has_placement(box2d<double>(40, 105, 50, 108)) );
+        BOOST_TEST( !right.has_placement(box2d<double>(100, 100, 110, 110),
+                                         0, mapnik::value_unicode_string::fromUTF8("I-95 \xc3\xa9"), 100) );
+        for (auto const& l : labels)
+        {
+            if (l.text.length() > 0)
+            {
+                BOOST_TEST( l.text == mapnik::value_unicode_string::fromUTF8("I-95 \xc3\xa9") );
+                BOOST_TEST_EQ( l.box.minx(), -15.5 );
+                BOOST_TEST_EQ( l.box.maxx(), 34.25 );
+            }
+        }
+
+        std::istringstream bad("1 2 3 4 10 short\n");
+        BOOST_TEST( !right.load_labels(bad) );
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << "\n";
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors()) {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ label collision detector: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,119 @@
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/raster.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/util/variant.hpp>
+#include "../../plugins/input/pgraster/pgraster_wkb_reader.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+void put_bytes(std::vector<uint8_t> & wkb, void const* data, std::size_t size)
+{
+    uint8_t const* bytes = static_cast<uint8_t const*>(data);
+    wkb.insert(wkb.end(), bytes, bytes + size);
+}
+
+// WKB of a one band 8BUI raster with the given nodata value, in host byte order
+std::vector<uint8_t> make_wkb(uint16_t width, uint16_t height, uint8_t nodata,
+                              std::vector<uint8_t> const& pixels)
+{
+    std::vector<uint8_t> wkb;
+    uint16_t one = 1;
+    wkb.push_back(*reinterpret_cast<uint8_t const*>(&one)); // 1 if little endian
+    uint16_t version = 0;
+    uint16_t bands = 1;
+    put_bytes(wkb, &version, 2);
+    put_bytes(wkb, &bands, 2);
+    double const georef[6] = { 1.0, -1.0, 0.0, double(height), 0.0, 0.0 }; // scale, origin, skew
+    put_bytes(wkb, georef, sizeof(georef));
+    int32_t srid = 0;
+    put_bytes(wkb, &srid, 4);
+    put_bytes(wkb, &width, 2);
+    put_bytes(wkb, &height, 2);
+    wkb.push_back(4 | (1 << 6)); // PT_8BUI with the hasnodata flag
+    wkb.push_back(nodata);
+    wkb.insert(wkb.end(), pixels.begin(), pixels.end());
+    return wkb;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i=1;i<argc;++i)
+    {
+        args.push_back(argv[i]);
+    }
+    bool quiet = std::find(args.begin(), args.end(), "-q")!=args.end();
+
+    try
+    {
+        // the last pixel differs from nodata: the value reported must be the
+        // one stored in the band, not the last pixel decoded
+        std::vector<uint8_t> pixels = { 7, 10, 200, 7, 255, 7, 0, 42 };
+        std::vector<uint8_t> wkb = make_wkb(4, 2, 7, pixels);
+
+        // data band, as read for band=1
+        mapnik::raster_ptr data = pgraster_wkb_reader::read(wkb.data(), wkb.size(), 1);
+        BOOST_TEST(data);
+        BOOST_TEST(data->nodata());
+        BOOST_TEST_EQ(*data->nodata(), 7.0);
+        mapnik::image_gray32f const& band = mapnik::util::get<mapnik::image_gray32f>(data->data_);
+        BOOST_TEST_EQ(band.width(), 4u);
+        BOOST_TEST_EQ(band.height(), 2u);
+
+        // colorized with the band's nodata, exactly the nodata pixels are masked
+        mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(255, 0, 0));
+        colorizer.add_stop(mapnik::colorizer_stop(0, mapnik::COLORIZER_LINEAR, mapnik::color(0, 0, 0)));
+        colorizer.add_stop(mapnik::colorizer_stop(255, mapnik::COLORIZER_LINEAR, mapnik::color(255, 255, 255)));
+        mapnik::image_rgba8 out(4, 2);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx, 1);
+        colorizer.colorize(out, band, data->nodata(), *feature);
+        for (unsigned i = 0; i < pixels.size(); ++i)
+        {
+            unsigned x = i % 4;
+            unsigned y = i / 4;
+            BOOST_TEST_EQ(band(x, y), float(pixels[i]));
+            bool masked = (out(x, y) >> 24) == 0;
+            BOOST_TEST_EQ(masked, pixels[i] == 7);
+        }
+
+        // grayscale interpretation, as read without a band
+        mapnik::raster_ptr gray = pgraster_wkb_reader::read(wkb.data(), wkb.size(), 0);
+        BOOST_TEST(gray);
+        BOOST_TEST(gray->nodata());
+        BOOST_TEST_EQ(*gray->nodata(), 7.0);
+
+        // no nodata flag, no nodata value
+        wkb[61] = 4;
+        mapnik::raster_ptr plain = pgraster_wkb_reader::read(wkb.data(), wkb.size(), 1);
+        BOOST_TEST(plain);
+        BOOST_TEST(!plain->nodata());
+    }
+    catch (std::exception const & ex)
+    {
+        std::clog << ex.what() << std::endl;
+        BOOST_TEST(false);
+    }
+
+    if (!::boost::detail::test_errors())
+    {
+        if (quiet) std::clog << "\x1b[1;32m.\x1b[0m";
+        else std::clog << "C++ pgraster WKB reader: \x1b[1;32m✓ \x1b[0m\n";
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+    }
+    else
+    {
+        return ::boost::report_errors();
+    }
+}
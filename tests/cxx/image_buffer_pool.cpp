@@ -0,0 +1,108 @@
+#include "catch.hpp"
+
+#include <mapnik/image_buffer_pool.hpp>
+
+namespace {
+
+// constructed before the pool, so destroyed after it at exit
+mapnik::image_buffer_pool::buffer_ptr held_until_exit;
+
+bool transparent(mapnik::image_rgba8 const& im)
+{
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            if (im(x,y) != 0) return false;
+        }
+    }
+    return true;
+}
+
+}
+
+TEST_CASE("image buffer pool") {
+
+mapnik::image_buffer_pool & pool = mapnik::image_buffer_pool::instance();
+
+SECTION("clear painted") {
+    for (unsigned size : { 1u, 7u, 33u })
+    {
+        mapnik::image_rgba8 im(size, size + 3);
+        REQUIRE( transparent(im) );
+        im(0,0) = 0xffffffff;
+        im(size - 1, size + 2) = 0x01000000;
+        im(size / 2, 1) = 0x00000001;
+        mapnik::clear_painted(im);
+        REQUIRE( transparent(im) );
+        im.set(0x80808080);
+        mapnik::clear_painted(im);
+        REQUIRE( transparent(im) );
+    }
+}
+
+SECTION("buffers are reused cleared") {
+    pool.clear();
+    auto a = pool.acquire(100, 50);
+    mapnik::image_rgba8 * raw = a.get();
+    (*a)(3,4) = 0xffffffff;
+    (*a)(99,49) = 0x01020304;
+    a->set_premultiplied(true);
+    a.reset();
+    REQUIRE( pool.idle_bytes() == 100 * 50 * 4 );
+    auto b = pool.acquire(100, 50);
+    REQUIRE( b.get() == raw );
+    REQUIRE( pool.idle_bytes() == 0 );
+    REQUIRE( transparent(*b) );
+    REQUIRE( !b->get_premultiplied() );
+    REQUIRE( !b->painted() );
+}
+
+SECTION("sizes must match") {
+    pool.clear();
+    auto a = pool.acquire(64, 32);
+    mapnik::image_rgba8 * raw = a.get();
+    a.reset();
+    auto b = pool.acquire(32, 64);
+    REQUIRE( b.get() != raw );
+    REQUIRE( b->width() == 32 );
+    REQUIRE( b->height() == 64 );
+    REQUIRE( pool.idle_bytes() == 64 * 32 * 4 );
+    auto c = pool.acquire(64, 32);
+    REQUIRE( c.get() == raw );
+}
+
+SECTION("release after clear") {
+    pool.clear();
+    auto a = pool.acquire(16, 16);
+    (*a)(1,1) = 0xffffffff;
+    pool.clear();
+    REQUIRE( pool.idle_bytes() == 0 );
+    a.reset();
+    REQUIRE( pool.idle_bytes() == 16 * 16 * 4 );
+    auto b = pool.acquire(16, 16);
+    REQUIRE( transparent(*b) );
+}
+
+SECTION("idle buffers stay under max bytes") {
+    pool.clear();
+    std::size_t old_max = pool.max_bytes();
+    pool.set_max_bytes(16 * 16 * 4);
+    auto a = pool.acquire(16, 16);
+    auto b = pool.acquire(16, 16);
+    auto big = pool.acquire(32, 32);
+    a.reset();
+    b.reset();
+    big.reset();
+    REQUIRE( pool.idle_bytes() == 16 * 16 * 4 );
+    pool.set_max_bytes(0);
+    REQUIRE( pool.idle_bytes() == 0 );
+    pool.set_max_bytes(old_max);
+}
+
+SECTION("buffers may outlive the pool") {
+    held_until_exit = pool.acquire(8, 8);
+    REQUIRE( held_until_exit->width() == 8 );
+}
+
+}
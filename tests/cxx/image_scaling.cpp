@@ -0,0 +1,163 @@
+#include "catch.hpp"
+
+#include <mapnik/image.hpp>
+#include <mapnik/image_scaling.hpp>
+#include <mapnik/image_scaling_traits.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// any sub-pixel offset sends scale_image_agg through agg's span generators,
+// this one is too small to move the rasterized polygon
+const double agg_path_offset = 1e-7;
+
+std::uint32_t next_random(std::uint32_t & state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+template <typename T>
+void fill_random(T & im, std::uint32_t seed)
+{
+    using pixel_type = typename T::pixel_type;
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            std::uint32_t r = next_random(seed);
+            pixel_type v;
+            std::memcpy(&v, &r, sizeof(pixel_type) < sizeof(r) ? sizeof(pixel_type) : sizeof(r));
+            im(x, y) = v;
+        }
+    }
+}
+
+// rgba8 is scaled premultiplied: keep the colour channels within alpha
+template <>
+void fill_random(mapnik::image_rgba8 & im, std::uint32_t seed)
+{
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            std::uint32_t a = next_random(seed) & 0xff;
+            std::uint32_t r = a ? next_random(seed) % (a + 1) : 0;
+            std::uint32_t g = a ? next_random(seed) % (a + 1) : 0;
+            std::uint32_t b = a ? next_random(seed) % (a + 1) : 0;
+            im(x, y) = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+}
+
+// gray32f is scaled through its bits like gray32, keep the floats finite
+template <>
+void fill_random(mapnik::image_gray32f & im, std::uint32_t seed)
+{
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            im(x, y) = static_cast<float>(next_random(seed)) / 1024.0f - 4096.0f;
+        }
+    }
+}
+
+template <typename T>
+bool same_bytes(T const& a, T const& b)
+{
+    return a.width() == b.width() && a.height() == b.height() &&
+        std::memcmp(a.getBytes(), b.getBytes(), a.getSize()) == 0;
+}
+
+// the aligned fast path must give agg's output byte for byte
+template <typename T>
+void check_scaling(std::string const& name)
+{
+    std::vector<std::pair<unsigned, unsigned> > sizes = { {1, 1}, {7, 5}, {33, 17}, {64, 64} };
+    std::vector<std::pair<double, double> > ratios = {
+        {1.0, 1.0}, {2.0, 2.0}, {3.7, 1.3}, {1.5, 0.5}, {0.5, 0.5}, {0.3, 0.77}, {0.1, 0.25}, {5.0, 0.9}
+    };
+    for (auto const& size : sizes)
+    {
+        T source(size.first, size.second);
+        fill_random(source, size.first * 31 + size.second);
+        for (auto const& ratio : ratios)
+        {
+            unsigned width = std::max(1u, static_cast<unsigned>(std::round(size.first * ratio.first)));
+            unsigned height = std::max(1u, static_cast<unsigned>(std::round(size.second * ratio.second)));
+            for (int method = mapnik::SCALING_NEAR; method <= mapnik::SCALING_BLACKMAN; ++method)
+            {
+                mapnik::scaling_method_e scaling_method = static_cast<mapnik::scaling_method_e>(method);
+                T fast(width, height);
+                T reference(width, height);
+                mapnik::scale_image_agg(fast, source, scaling_method, ratio.first, ratio.second, 0.0, 0.0, 3.0);
+                mapnik::scale_image_agg(reference, source, scaling_method, ratio.first, ratio.second,
+                                        agg_path_offset, 0.0, 3.0);
+                INFO( name << " " << *mapnik::scaling_method_to_string(scaling_method) << " "
+                      << size.first << "x" << size.second << " -> " << width << "x" << height );
+                REQUIRE( same_bytes(fast, reference) );
+            }
+        }
+    }
+}
+
+// weights up to 1.6 in filter units, more than two of them multiplied
+// together no longer fit the 16 bit lanes the rgba8 SSE sum works in
+struct heavy_filter
+{
+    double radius() const { return 2.0; }
+    double calc_weight(double x) const { return x < 1.0 ? 1.6 : 0.2; }
+};
+
+}
+
+TEST_CASE("image scaling") {
+
+SECTION("rgba8") {
+    check_scaling<mapnik::image_rgba8>("rgba8");
+}
+
+SECTION("gray8") {
+    check_scaling<mapnik::image_gray8>("gray8");
+}
+
+SECTION("gray16") {
+    check_scaling<mapnik::image_gray16>("gray16");
+}
+
+SECTION("gray32f") {
+    check_scaling<mapnik::image_gray32f>("gray32f");
+}
+
+SECTION("filter weights too large for the SSE sum") {
+    agg::image_filter_lut filter;
+    filter.calculate(heavy_filter(), false);
+    int max_weight = 0;
+    for (int i = 0; i < (filter.diameter() << agg::image_subpixel_shift); ++i)
+    {
+        max_weight = std::max(max_weight, std::abs(static_cast<int>(filter.weight_array()[i])));
+    }
+    REQUIRE( max_weight > 23170 );
+    mapnik::image_rgba8 source(33, 17);
+    fill_random(source, 7);
+    for (double ratio : { 0.4, 1.0, 2.5 })
+    {
+        unsigned width = static_cast<unsigned>(std::round(33 * ratio));
+        unsigned height = static_cast<unsigned>(std::round(17 * ratio));
+        mapnik::image_rgba8 fast(width, height);
+        mapnik::image_rgba8 reference(width, height);
+        mapnik::detail::scale_image_agg(fast, source, &filter, ratio, ratio, 0.0, 0.0);
+        mapnik::detail::scale_image_agg(reference, source, &filter, ratio, ratio, agg_path_offset, 0.0);
+        INFO( "ratio " << ratio );
+        REQUIRE( same_bytes(fast, reference) );
+    }
+}
+
+}
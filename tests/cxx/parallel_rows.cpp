@@ -0,0 +1,90 @@
+#include "catch.hpp"
+
+#include <mapnik/util/parallel.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("parallel rows") {
+
+SECTION("bands cover every row once") {
+    unsigned old_threads = mapnik::util::band_threads();
+    mapnik::util::set_band_threads(4);
+    unsigned rows = 1000;
+    std::vector<int> hits(rows, 0);
+    mapnik::util::parallel_rows(rows, 1000, [&](unsigned begin, unsigned end)
+    {
+        for (unsigned y = begin; y < end; ++y) ++hits[y];
+    });
+    mapnik::util::set_band_threads(old_threads);
+    for (unsigned y = 0; y < rows; ++y)
+    {
+        REQUIRE( hits[y] == 1 );
+    }
+}
+
+SECTION("exceptions are rethrown on the calling thread") {
+    unsigned old_threads = mapnik::util::band_threads();
+    mapnik::util::set_band_threads(4);
+    // every band throws, so whichever thread ran it the caller sees it
+    REQUIRE_THROWS_AS( mapnik::util::parallel_rows(1000, 1000, [](unsigned, unsigned)
+    {
+        throw std::runtime_error("band failed");
+    }), std::runtime_error );
+    // only the last band throws, most likely on a pool thread
+    std::atomic<unsigned> done(0);
+    REQUIRE_THROWS_AS( mapnik::util::parallel_rows(1000, 1000, [&](unsigned begin, unsigned end)
+    {
+        if (end == 1000) throw std::runtime_error("band failed");
+        ++done;
+    }), std::runtime_error );
+    // the pool is still usable afterwards
+    std::atomic<unsigned> rows(0);
+    mapnik::util::parallel_rows(1000, 1000, [&](unsigned begin, unsigned end)
+    {
+        rows += end - begin;
+    });
+    mapnik::util::set_band_threads(old_threads);
+    REQUIRE( rows == 1000 );
+}
+
+SECTION("concurrent and nested callers") {
+    unsigned old_threads = mapnik::util::band_threads();
+    mapnik::util::set_band_threads(3);
+    std::atomic<unsigned> rows(0);
+    std::vector<std::thread> callers;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        callers.emplace_back([&rows]
+        {
+            mapnik::util::parallel_rows(300, 1000, [&rows](unsigned begin, unsigned end)
+            {
+                for (unsigned y = begin; y < end; ++y)
+                {
+                    mapnik::util::parallel_rows(300, 1000, [&rows](unsigned b, unsigned e)
+                    {
+                        rows += e - b;
+                    });
+                }
+            });
+        });
+    }
+    for (std::thread & t : callers) t.join();
+    mapnik::util::set_band_threads(old_threads);
+    REQUIRE( rows == 4 * 300 * 300 );
+}
+
+SECTION("defaults to a single band") {
+    REQUIRE( mapnik::util::band_threads() == 1 );
+    std::thread::id caller = std::this_thread::get_id();
+    bool same_thread = true;
+    mapnik::util::parallel_rows(1000, 1000, [&](unsigned, unsigned)
+    {
+        same_thread = same_thread && std::this_thread::get_id() == caller;
+    });
+    REQUIRE( same_thread );
+}
+
+}
@@ -0,0 +1,139 @@
+#if defined(HAVE_PNG)
+
+#include "catch.hpp"
+
+#include <mapnik/image.hpp>
+#include <mapnik/octree.hpp>
+#include <mapnik/hextree.hpp>
+#include <mapnik/png_io.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+mapnik::image_rgba8 long_runs(unsigned width, unsigned height)
+{
+    // runs of 1 to 37 pixels from a handful of colours, so runs start and
+    // end at every offset within the four pixel groups run_end compares
+    static const unsigned colors[] = { 0xff0000ff, 0xff00ff00, 0x80ff0000, 0xffffffff, 0x00000000, 0x40204080 };
+    mapnik::image_rgba8 im(width, height);
+    unsigned run = 0;
+    for (unsigned y = 0; y < height; ++y)
+    {
+        unsigned x = 0;
+        while (x < width)
+        {
+            unsigned len = 1 + (run * 7) % 37;
+            unsigned color = colors[run % 6];
+            for (unsigned i = 0; i < len && x < width; ++i) im(x++, y) = color;
+            ++run;
+        }
+    }
+    return im;
+}
+
+mapnik::image_rgba8 noise(unsigned width, unsigned height)
+{
+    mapnik::image_rgba8 im(width, height);
+    std::uint32_t state = 12345;
+    for (unsigned y = 0; y < height; ++y)
+    {
+        for (unsigned x = 0; x < width; ++x)
+        {
+            state = state * 1664525u + 1013904223u;
+            im(x, y) = state;
+        }
+    }
+    return im;
+}
+
+template <typename Tree, typename Color>
+void insert_pixels(Tree & tree, mapnik::image_rgba8 const& im, bool by_run)
+{
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        mapnik::image_rgba8::pixel_type const* row = im.getRow(y);
+        for (unsigned x = 0; x < im.width();)
+        {
+            unsigned val = row[x];
+            unsigned end = by_run ? mapnik::detail::run_end(row, x, im.width()) : x + 1;
+            tree.insert(Color(val), end - x);
+            x = end;
+        }
+    }
+}
+
+template <typename Tree>
+std::vector<int> quantize_all(Tree const& tree, mapnik::image_rgba8 const& im)
+{
+    std::vector<int> indexes;
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            indexes.push_back(tree.quantize(im(x, y)));
+        }
+    }
+    return indexes;
+}
+
+// the run by run histogram must give the palette and indexes of one insert per pixel
+void check_quantizers(mapnik::image_rgba8 const& im)
+{
+    mapnik::octree<mapnik::rgb> oct_pixels(256);
+    mapnik::octree<mapnik::rgb> oct_runs(256);
+    insert_pixels<mapnik::octree<mapnik::rgb>, mapnik::rgb>(oct_pixels, im, false);
+    insert_pixels<mapnik::octree<mapnik::rgb>, mapnik::rgb>(oct_runs, im, true);
+    std::vector<mapnik::rgb> oct_pal_pixels, oct_pal_runs;
+    oct_pixels.create_palette(oct_pal_pixels);
+    oct_runs.create_palette(oct_pal_runs);
+    REQUIRE( oct_pal_runs.size() == oct_pal_pixels.size() );
+    REQUIRE( oct_pal_runs == oct_pal_pixels );
+    REQUIRE( quantize_all(oct_runs, im) == quantize_all(oct_pixels, im) );
+
+    mapnik::hextree<mapnik::rgba> hex_pixels(256);
+    mapnik::hextree<mapnik::rgba> hex_runs(256);
+    insert_pixels<mapnik::hextree<mapnik::rgba>, mapnik::rgba>(hex_pixels, im, false);
+    insert_pixels<mapnik::hextree<mapnik::rgba>, mapnik::rgba>(hex_runs, im, true);
+    std::vector<mapnik::rgba> hex_pal_pixels, hex_pal_runs;
+    hex_pixels.create_palette(hex_pal_pixels);
+    hex_runs.create_palette(hex_pal_runs);
+    REQUIRE( hex_pal_runs.size() == hex_pal_pixels.size() );
+    REQUIRE( hex_pal_runs == hex_pal_pixels );
+    REQUIRE( quantize_all(hex_runs, im) == quantize_all(hex_pixels, im) );
+}
+
+}
+
+TEST_CASE("png8 quantize") {
+
+SECTION("run end") {
+    mapnik::image_rgba8 im = long_runs(203, 3);
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        mapnik::image_rgba8::pixel_type const* row = im.getRow(y);
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            unsigned end = x + 1;
+            while (end < im.width() && row[end] == row[x]) ++end;
+            REQUIRE( mapnik::detail::run_end(row, x, im.width()) == end );
+        }
+    }
+}
+
+SECTION("long runs") {
+    check_quantizers(long_runs(256, 256));
+    mapnik::image_rgba8 solid(256, 256);
+    solid.set(0xff336699);
+    check_quantizers(solid);
+}
+
+SECTION("noise") {
+    check_quantizers(noise(256, 256));
+    check_quantizers(noise(37, 11));
+}
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "catch.hpp"
+
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/util/parallel.hpp>
+
+#include <boost/optional.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// colorize must give what get_color gives for every pixel, nodata aside
+template <typename T>
+void check_colorize(mapnik::raster_colorizer const& colorizer, T const& in,
+                    boost::optional<double> const& nodata = boost::optional<double>())
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature = mapnik::feature_factory::create(ctx, 1);
+    mapnik::image_rgba8 out(in.width(), in.height());
+    colorizer.colorize(out, in, nodata, *feature);
+    for (unsigned y = 0; y < in.height(); ++y)
+    {
+        for (unsigned x = 0; x < in.width(); ++x)
+        {
+            typename T::pixel_type value = in(x, y);
+            unsigned expected = (nodata && std::fabs(value - *nodata) < colorizer.get_epsilon())
+                ? 0 : colorizer.get_color(value);
+            REQUIRE( out(x, y) == expected );
+        }
+    }
+}
+
+template <typename T>
+T every_value(unsigned width)
+{
+    using limits = std::numeric_limits<typename T::pixel_type>;
+    long count = static_cast<long>(limits::max()) - limits::min() + 1;
+    T im(width, static_cast<unsigned>((count + width - 1) / width));
+    long i = 0;
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x, ++i)
+        {
+            im(x, y) = static_cast<typename T::pixel_type>(limits::min() + i % count);
+        }
+    }
+    return im;
+}
+
+mapnik::raster_colorizer make_colorizer(float low, float high)
+{
+    mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(10, 20, 30, 40));
+    unsigned steps = 30;
+    for (unsigned i = 0; i < steps; ++i)
+    {
+        float value = low + (high - low) * i / (steps - 1);
+        mapnik::colorizer_mode mode = (i % 3 == 0) ? mapnik::COLORIZER_DISCRETE
+            : (i % 3 == 1) ? mapnik::COLORIZER_INHERIT : mapnik::COLORIZER_EXACT;
+        colorizer.add_stop(mapnik::colorizer_stop(value, mode, mapnik::color(i * 8, 255 - i * 8, (i * 37) % 256, 128 + i)));
+    }
+    return colorizer;
+}
+
+}
+
+TEST_CASE("raster colorizer") {
+
+SECTION("8 and 16 bit lookup tables") {
+    // images with fewer pixels than the table are coloured without one
+    mapnik::raster_colorizer colorizer = make_colorizer(-20000, 50000);
+    check_colorize(colorizer, every_value<mapnik::image_gray8>(16));
+    check_colorize(colorizer, every_value<mapnik::image_gray8>(16), boost::optional<double>(7));
+    check_colorize(colorizer, every_value<mapnik::image_gray16>(256));
+    check_colorize(colorizer, every_value<mapnik::image_gray16s>(256), boost::optional<double>(-3));
+    mapnik::image_gray8 small(7, 3);
+    small(2, 1) = 200;
+    check_colorize(colorizer, small);
+    colorizer = make_colorizer(10, 240);
+    check_colorize(colorizer, every_value<mapnik::image_gray8>(16));
+    check_colorize(colorizer, every_value<mapnik::image_gray8s>(16));
+}
+
+SECTION("binary search of float stops") {
+    mapnik::raster_colorizer colorizer = make_colorizer(-1.5, 2.5);
+    mapnik::image_gray32f im(97, 41);
+    std::uint32_t state = 777;
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x)
+        {
+            state = state * 1664525u + 1013904223u;
+            // runs of repeated values, stop values themselves and values outside the stops
+            if (x % 5 == 4) im(x, y) = im(x - 1, y);
+            else if (x % 7 == 0) im(x, y) = colorizer.get_stops()[state % 30].get_value();
+            else im(x, y) = -2.0f + 5.0f * (state >> 8) / float(1 << 24);
+        }
+    }
+    im(0, 0) = std::numeric_limits<float>::quiet_NaN();
+    im(1, 0) = std::numeric_limits<float>::quiet_NaN();
+    im(2, 0) = std::numeric_limits<float>::infinity();
+    im(3, 0) = -std::numeric_limits<float>::infinity();
+    check_colorize(colorizer, im);
+    check_colorize(colorizer, im, boost::optional<double>(im(10, 10)));
+
+    mapnik::image_gray64f im64(im.width(), im.height());
+    for (unsigned y = 0; y < im.height(); ++y)
+    {
+        for (unsigned x = 0; x < im.width(); ++x) im64(x, y) = im(x, y);
+    }
+    check_colorize(colorizer, im64);
+
+    unsigned old_threads = mapnik::util::band_threads();
+    mapnik::util::set_band_threads(4);
+    check_colorize(colorizer, im);
+    mapnik::util::set_band_threads(old_threads);
+}
+
+SECTION("duplicate and unsorted stops") {
+    // set_stops takes stops add_stop would refuse
+    mapnik::colorizer_stops stops;
+    stops.emplace_back(0, mapnik::COLORIZER_LINEAR, mapnik::color(255, 0, 0));
+    stops.emplace_back(1, mapnik::COLORIZER_LINEAR, mapnik::color(0, 255, 0));
+    stops.emplace_back(1, mapnik::COLORIZER_DISCRETE, mapnik::color(0, 0, 255));
+    stops.emplace_back(1, mapnik::COLORIZER_LINEAR, mapnik::color(0, 0, 0, 128));
+    stops.emplace_back(2, mapnik::COLORIZER_EXACT, mapnik::color(255, 255, 255));
+    stops.emplace_back(3, mapnik::COLORIZER_LINEAR, mapnik::color(9, 9, 9));
+    mapnik::raster_colorizer colorizer;
+    colorizer.set_stops(stops);
+    mapnik::image_gray32f im(64, 1);
+    for (unsigned x = 0; x < im.width(); ++x) im(x, 0) = -0.5f + x / 16.0f;
+    im(63, 0) = std::numeric_limits<float>::quiet_NaN();
+    check_colorize(colorizer, im);
+    mapnik::image_gray16 im16(300, 300);
+    for (unsigned y = 0; y < im16.height(); ++y)
+    {
+        for (unsigned x = 0; x < im16.width(); ++x) im16(x, y) = (x + y) % 5;
+    }
+    check_colorize(colorizer, im16);
+
+    std::swap(stops[0], stops[4]);
+    colorizer.set_stops(stops);
+    check_colorize(colorizer, im);
+    check_colorize(colorizer, im16);
+}
+
+SECTION("no stops") {
+    mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(1, 2, 3, 4));
+    mapnik::image_gray32f im(5, 5);
+    im(1, 1) = std::numeric_limits<float>::quiet_NaN();
+    check_colorize(colorizer, im);
+    check_colorize(colorizer, every_value<mapnik::image_gray8>(16), boost::optional<double>(0));
+}
+
+}
@@ -0,0 +1,106 @@
+#include "catch.hpp"
+
+#include <mapnik/palette.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string make_palette()
+{
+    std::string pal;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        pal += static_cast<char>(i * 16);
+        pal += static_cast<char>(255 - i * 16);
+        pal += static_cast<char>((i * 71) & 0xff);
+        pal += static_cast<char>(i < 4 ? 64 * i : 255);
+    }
+    return pal;
+}
+
+// every row quantized through one cache must match quantizing pixel by pixel
+void check_rows(mapnik::rgba_palette const& pal, std::vector<unsigned> const& pixels, unsigned width)
+{
+    mapnik::rgba_palette::cache cache;
+    std::vector<unsigned char> out(width);
+    for (std::size_t y = 0; y + width <= pixels.size(); y += width)
+    {
+        pal.quantize(&pixels[y], out.data(), width, cache);
+        for (unsigned x = 0; x < width; ++x)
+        {
+            REQUIRE( static_cast<unsigned>(out[x]) == static_cast<unsigned>(pal.quantize(pixels[y + x])) );
+        }
+    }
+}
+
+}
+
+TEST_CASE("rgba palette") {
+
+mapnik::rgba_palette pal(make_palette(), mapnik::rgba_palette::PALETTE_RGBA);
+REQUIRE( pal.valid() );
+
+SECTION("palette colors map to themselves") {
+    std::vector<mapnik::rgb> const& colors = pal.palette();
+    std::vector<unsigned> const& alphas = pal.alphaTable();
+    for (unsigned i = 0; i < colors.size(); ++i)
+    {
+        unsigned a = i < alphas.size() ? alphas[i] : 255;
+        if (a == 0) continue;
+        unsigned val = (a << 24) | (colors[i].b << 16) | (colors[i].g << 8) | colors[i].r;
+        mapnik::rgba_palette::cache cache;
+        unsigned char index;
+        pal.quantize(&val, &index, 1, cache);
+        REQUIRE( static_cast<unsigned>(index) == i );
+        REQUIRE( static_cast<unsigned>(pal.quantize(val)) == i );
+    }
+}
+
+SECTION("runs and transparent pixels") {
+    unsigned width = 97;
+    std::vector<unsigned> pixels;
+    unsigned run = 0;
+    while (pixels.size() < width * 9)
+    {
+        unsigned val = run % 5 == 0 ? 0 : 0xff000000 | (run * 0x1f3a57);
+        for (unsigned i = 0; i < 1 + run % 13; ++i) pixels.push_back(val);
+        ++run;
+    }
+    check_rows(pal, pixels, width);
+}
+
+SECTION("noise") {
+    unsigned width = 256;
+    std::vector<unsigned> pixels;
+    std::uint32_t state = 4321;
+    for (unsigned i = 0; i < width * 64; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        pixels.push_back(state);
+    }
+    check_rows(pal, pixels, width);
+}
+
+SECTION("colors sharing a cache slot") {
+    // alternate between distinct colors that hash to the same slot, so
+    // each one evicts the other
+    std::vector<unsigned> same_slot;
+    unsigned first = 0xff102030;
+    unsigned slot = (first * 2654435761u) >> 20;
+    for (unsigned val = first; same_slot.size() < 4; ++val)
+    {
+        if (((val * 2654435761u) >> 20) == slot) same_slot.push_back(val);
+    }
+    std::vector<unsigned> pixels;
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        pixels.push_back(same_slot[i % 4]);
+        pixels.push_back(same_slot[(i * 3) % 4]);
+    }
+    check_rows(pal, pixels, 32);
+}
+
+}
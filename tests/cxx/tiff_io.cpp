@@ -56,6 +56,22 @@
     REQUIRE( subimage.width() == 1 ); \
     REQUIRE( subimage.height() == 1 ); \
 
+// 2x2 average of each block of pixels, rounded half up
+mapnik::image_gray8 downsample_gray8(mapnik::image_gray8 const& image)
+{
+    mapnik::image_gray8 reduced(image.width() / 2, image.height() / 2);
+    for (unsigned y = 0; y < reduced.height(); ++y)
+    {
+        for (unsigned x = 0; x < reduced.width(); ++x)
+        {
+            unsigned sum = image(2 * x, 2 * y) + image(2 * x + 1, 2 * y) +
+                           image(2 * x, 2 * y + 1) + image(2 * x + 1, 2 * y + 1);
+            reduced(x, y) = static_cast<std::uint8_t>((sum + 2) / 4);
+        }
+    }
+    return reduced;
+}
+
 TEST_CASE("tiff io") {
 
 SECTION("scan rgb8 striped") {
@@ -278,6 +294,72 @@ SECTION("gray32f tiled") {
     TIFF_READ_ONE_PIXEL
 }
 
+SECTION("overviews") {
+    // levels 1 and 2 are 2x2 averages (rounded) of the level above
+    std::string filename("./tests/data/tiff/ndvi_256x256_gray8_pyramid.tif");
+    mapnik::util::file file(filename);
+    // the in memory reader reads straight from this buffer, keep it alive
+    mapnik::util::file::data_type buffer = file.data();
+    std::unique_ptr<mapnik::image_reader> readers[2] = {
+        std::unique_ptr<mapnik::image_reader>(mapnik::get_image_reader(filename,"tiff")),
+        std::unique_ptr<mapnik::image_reader>(mapnik::get_image_reader(buffer.get(),file.size()))
+    };
+    for (auto & reader : readers)
+    {
+        REQUIRE( reader->width() == 256 );
+        REQUIRE( reader->height() == 256 );
+        REQUIRE( reader->overview_count() == 2 );
+        REQUIRE( reader->overview_size(1) == std::make_pair(128u, 128u) );
+        REQUIRE( reader->overview_size(2) == std::make_pair(64u, 64u) );
+        REQUIRE_THROWS( reader->read_overview(3, 0, 0, 1, 1) );
+        mapnik::image_any full = reader->read(0, 0, 256, 256);
+        std::vector<mapnik::image_gray8> levels;
+        levels.push_back(mapnik::util::get<mapnik::image_gray8>(full));
+        for (unsigned level = 1; level <= 2; ++level)
+        {
+            levels.push_back(downsample_gray8(levels.back()));
+            mapnik::image_gray8 const& expected = levels.back();
+            // whole overview, then windows straddling tile boundaries
+            unsigned windows[][4] = { { 0, 0, expected.width(), expected.height() },
+                                      { 5, 7, 20, 30 },
+                                      { 60, 10, 4, 50 },
+                                      { expected.width() - 3, expected.height() - 2, 3, 2 } };
+            for (auto const& w : windows)
+            {
+                mapnik::image_any data = reader->read_overview(level, w[0], w[1], w[2], w[3]);
+                REQUIRE( data.is<mapnik::image_gray8>() );
+                mapnik::image_gray8 const& gray = mapnik::util::get<mapnik::image_gray8>(data);
+                REQUIRE( gray.width() == w[2] );
+                REQUIRE( gray.height() == w[3] );
+                for (unsigned y = 0; y < w[3]; ++y)
+                {
+                    for (unsigned x = 0; x < w[2]; ++x)
+                    {
+                        REQUIRE( gray(x, y) == expected(w[0] + x, w[1] + y) );
+                    }
+                }
+            }
+        }
+        // reading an overview leaves the full resolution image selected
+        REQUIRE( reader->width() == 256 );
+        mapnik::image_any again = reader->read(0, 0, 256, 256);
+        REQUIRE( std::equal(again.getBytes(), again.getBytes() + again.getSize(), full.getBytes()) );
+    }
+}
+
+SECTION("no overviews") {
+    std::string filename("./tests/data/tiff/ndvi_256x256_gray8_tiled.tif");
+    std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(filename,"tiff"));
+    REQUIRE( reader->overview_count() == 0 );
+    REQUIRE( reader->overview_size(0) == std::make_pair(256u, 256u) );
+    REQUIRE_THROWS( reader->read_overview(1, 0, 0, 1, 1) );
+    mapnik::image_any data = reader->read_overview(0, 10, 20, 30, 40);
+    mapnik::image_any subimage = reader->read(10, 20, 30, 40);
+    REQUIRE( data.width() == 30 );
+    REQUIRE( data.height() == 40 );
+    REQUIRE( std::equal(data.getBytes(), data.getBytes() + data.getSize(), subimage.getBytes()) );
+}
+
 }
 
 #endif
@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include <mapnik/vertex_cache.hpp>
+#include <mapnik/offset_converter.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct test_path
+{
+    struct vertex_type
+    {
+        unsigned cmd;
+        double x;
+        double y;
+    };
+
+    void move_to(double x, double y) { vertices.push_back(vertex_type{agg::path_cmd_move_to, x, y}); }
+    void line_to(double x, double y) { vertices.push_back(vertex_type{agg::path_cmd_line_to, x, y}); }
+
+    void rewind(unsigned) { pos = 0; }
+
+    unsigned vertex(double * x, double * y)
+    {
+        if (pos == vertices.size()) return agg::path_cmd_stop;
+        *x = vertices[pos].x;
+        *y = vertices[pos].y;
+        return vertices[pos++].cmd;
+    }
+
+    std::vector<vertex_type> vertices;
+    std::size_t pos = 0;
+};
+
+// two parts far apart, so an offset line of the wrong part is easy to tell
+test_path two_part_line()
+{
+    test_path path;
+    path.move_to(0, 0);
+    path.line_to(100, 0);
+    path.line_to(150, 50);
+    path.line_to(300, 50);
+    path.move_to(0, 500);
+    path.line_to(50, 450);
+    path.line_to(200, 450);
+    path.line_to(250, 520);
+    return path;
+}
+
+test_path part(test_path const& path, unsigned index)
+{
+    test_path result;
+    for (auto const& v : path.vertices)
+    {
+        if (v.cmd == agg::path_cmd_move_to && index-- == 0)
+        {
+            result.vertices.push_back(v);
+        }
+        else if (!result.vertices.empty())
+        {
+            if (v.cmd == agg::path_cmd_move_to) break;
+            result.vertices.push_back(v);
+        }
+    }
+    return result;
+}
+
+std::vector<double> coords(mapnik::vertex_cache & pp)
+{
+    std::vector<double> result;
+    double x, y;
+    pp.rewind(0);
+    while (!agg::is_stop(pp.vertex(&x, &y)))
+    {
+        result.push_back(x);
+        result.push_back(y);
+    }
+    return result;
+}
+
+// the cached offset line must be the one built from scratch for the
+// current part and aligned to the current position
+void check_offset(mapnik::vertex_cache & pp, test_path const& path, unsigned index, double offset)
+{
+    test_path subpath = part(path, index);
+    mapnik::offset_converter<test_path> converter(subpath);
+    converter.set_offset(offset);
+    mapnik::vertex_cache expected(converter);
+    expected.reset();
+    REQUIRE( expected.next_subpath() );
+    expected.move(expected.position_closest_to(pp.current_position()));
+
+    mapnik::vertex_cache & offseted = pp.get_offseted(offset, 0);
+    REQUIRE( &offseted != &pp );
+    REQUIRE( coords(offseted) == coords(expected) );
+    REQUIRE( offseted.length() == Approx(expected.length()) );
+    REQUIRE( offseted.linear_position() == Approx(expected.linear_position()) );
+    REQUIRE( offseted.current_position().x == Approx(expected.current_position().x) );
+    REQUIRE( offseted.current_position().y == Approx(expected.current_position().y) );
+}
+
+}
+
+TEST_CASE("vertex cache") {
+
+SECTION("offset lines of each part") {
+    test_path path = two_part_line();
+    mapnik::vertex_cache pp(path);
+    pp.reset();
+    REQUIRE( pp.next_subpath() );
+    REQUIRE( pp.move(120) );
+    check_offset(pp, path, 0, 10);
+    check_offset(pp, path, 0, -7.5);
+    REQUIRE( pp.next_subpath() );
+    REQUIRE( pp.move(30) );
+    check_offset(pp, path, 1, 10);
+    check_offset(pp, path, 1, -7.5);
+}
+
+SECTION("cached offset lines are realigned") {
+    test_path path = two_part_line();
+    mapnik::vertex_cache pp(path);
+    for (double distance : { 20.0, 180.0, 60.0, 250.0 })
+    {
+        // the second and later passes take the lines from the cache
+        for (unsigned pass = 0; pass < 2; ++pass)
+        {
+            pp.reset();
+            REQUIRE( pp.next_subpath() );
+            REQUIRE( pp.move(distance) );
+            check_offset(pp, path, 0, 10);
+            REQUIRE( pp.next_subpath() );
+            REQUIRE( pp.move(distance) );
+            check_offset(pp, path, 1, 10);
+            check_offset(pp, path, 1, 3);
+        }
+    }
+}
+
+SECTION("tiny offsets use the line itself") {
+    test_path path = two_part_line();
+    mapnik::vertex_cache pp(path);
+    pp.reset();
+    REQUIRE( pp.next_subpath() );
+    REQUIRE( &pp.get_offseted(0.001, 0) == &pp );
+}
+
+}
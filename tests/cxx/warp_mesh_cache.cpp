@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include <mapnik/warp_mesh_cache.hpp>
+
+namespace {
+
+mapnik::warp_mesh_cache::key_type make_key(double minx, std::size_t width)
+{
+    return mapnik::warp_mesh_cache::key_type{"+init=epsg:4326", "+init=epsg:3857",
+                                             mapnik::box2d<double>(minx, 0, minx + 10, 10),
+                                             width, 256, 16};
+}
+
+mapnik::warp_mesh_ptr make_mesh(std::size_t nx, std::size_t ny)
+{
+    return std::make_shared<mapnik::warp_mesh>(nx, ny);
+}
+
+}
+
+TEST_CASE("warp mesh cache") {
+
+mapnik::warp_mesh_cache & cache = mapnik::warp_mesh_cache::instance();
+
+SECTION("hits") {
+    cache.clear();
+    REQUIRE( !cache.find(make_key(0, 256)) );
+    mapnik::warp_mesh_ptr mesh = make_mesh(17, 17);
+    cache.insert(make_key(0, 256), mesh);
+    REQUIRE( cache.find(make_key(0, 256)) == mesh );
+    REQUIRE( cache.bytes() == 2 * 17 * 17 * sizeof(double) );
+    // any field of the key tells meshes apart
+    REQUIRE( !cache.find(make_key(1, 256)) );
+    REQUIRE( !cache.find(make_key(0, 512)) );
+    mapnik::warp_mesh_cache::key_type other_srs = make_key(0, 256);
+    other_srs.dest_srs = "+init=epsg:32630";
+    REQUIRE( !cache.find(other_srs) );
+    mapnik::warp_mesh_cache::key_type other_mesh_size = make_key(0, 256);
+    other_mesh_size.mesh_size = 32;
+    REQUIRE( !cache.find(other_mesh_size) );
+    // a mesh inserted again for the same key keeps the first one
+    cache.insert(make_key(0, 256), make_mesh(17, 17));
+    REQUIRE( cache.find(make_key(0, 256)) == mesh );
+    REQUIRE( cache.size() == 1 );
+    cache.clear();
+    REQUIRE( !cache.find(make_key(0, 256)) );
+    REQUIRE( cache.bytes() == 0 );
+}
+
+SECTION("least recently used meshes are evicted") {
+    cache.clear();
+    std::size_t old_max = cache.max_bytes();
+    std::size_t mesh_bytes = 2 * 8 * 8 * sizeof(double);
+    cache.set_max_bytes(3 * mesh_bytes);
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        cache.insert(make_key(i, 256), make_mesh(8, 8));
+    }
+    REQUIRE( cache.size() == 3 );
+    // touching the oldest one makes the second the least recently used
+    REQUIRE( cache.find(make_key(0, 256)) );
+    cache.insert(make_key(3, 256), make_mesh(8, 8));
+    REQUIRE( cache.size() == 3 );
+    REQUIRE( cache.bytes() == 3 * mesh_bytes );
+    REQUIRE( cache.find(make_key(0, 256)) );
+    REQUIRE( !cache.find(make_key(1, 256)) );
+    REQUIRE( cache.find(make_key(2, 256)) );
+    REQUIRE( cache.find(make_key(3, 256)) );
+    // meshes larger than the whole budget are not kept
+    cache.insert(make_key(4, 256), make_mesh(16, 16));
+    REQUIRE( !cache.find(make_key(4, 256)) );
+    REQUIRE( cache.size() == 3 );
+    cache.set_max_bytes(mesh_bytes);
+    REQUIRE( cache.size() == 1 );
+    REQUIRE( cache.find(make_key(3, 256)) );
+    cache.set_max_bytes(old_max);
+    cache.clear();
+}
+
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+
+from nose.tools import eq_
+from utilities import execution_path, run_all, get_unique_colors
+
+import os, mapnik
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+# Two overlapping labels competing for the same spot: red has the higher priority.
+# Layers are listed in the given order, the first one being rendered first.
+map_template = '''<Map srs="+init=epsg:4326" deferred-labels="%(deferred)s">
+  <Style name="low">
+    <Rule>
+      <TextSymbolizer face-name="DejaVu Sans Book" size="24" fill="blue" dx="20" priority="1">'MMMM'</TextSymbolizer>
+    </Rule>
+  </Style>
+  <Style name="high">
+    <Rule>
+      <TextSymbolizer face-name="DejaVu Sans Book" size="24" fill="red" priority="[rank] * 10">'MMMM'</TextSymbolizer>
+    </Rule>
+  </Style>
+  %(layers)s
+</Map>
+'''
+
+layer_template = '''<Layer name="%(name)s" srs="+init=epsg:4326" clear-label-cache="%(clear)s">
+    <StyleName>%(name)s</StyleName>
+    <Datasource>
+      <Parameter name="type">csv</Parameter>
+      <Parameter name="inline">
+x,y,rank,name
+0,0,2,%(name)s
+      </Parameter>
+    </Datasource>
+  </Layer>'''
+
+red = 'rgba(255,0,0,255)'
+blue = 'rgba(0,0,255,255)'
+
+def make_map(layers, deferred=True, clear=()):
+    m = mapnik.Map(256, 256)
+    xml = map_template % {'deferred': 'true' if deferred else 'false',
+                          'layers': '\n  '.join(layer_template % {'name': name,
+                                                                  'clear': 'true' if name in clear else 'false'}
+                                                for name in layers)}
+    mapnik.load_map_from_string(m, xml)
+    m.zoom_to_box(mapnik.Box2d(-1, -1, 1, 1))
+    return m
+
+def render_colors(m):
+    im = mapnik.Image(m.width, m.height)
+    mapnik.render(m, im)
+    return get_unique_colors(im)
+
+if 'csv' in mapnik.DatasourceCache.plugin_names():
+
+    def test_higher_priority_wins_whatever_the_layer_order():
+        for layers in (['low', 'high'], ['high', 'low']):
+            colors = render_colors(make_map(layers))
+            eq_(red in colors, True)
+            eq_(blue in colors, False)
+
+    def test_layer_order_wins_without_deferred_labels():
+        colors = render_colors(make_map(['low', 'high'], deferred=False))
+        eq_(blue in colors, True)
+        eq_(red in colors, False)
+
+    def test_clear_label_cache_starts_a_new_group():
+        # labels of a layer with clear-label-cache are not blocked by
+        # the labels of earlier layers, whatever their priority
+        for layers in (['low', 'high'], ['high', 'low']):
+            colors = render_colors(make_map(layers, clear=[layers[1]]))
+            eq_(red in colors, True)
+            eq_(blue in colors, True)
+        # clearing before the first layer changes nothing
+        colors = render_colors(make_map(['low', 'high'], clear=['low']))
+        eq_(red in colors, True)
+        eq_(blue in colors, False)
+
+    def test_deferred_labels_round_trip():
+        m = make_map(['low', 'high'])
+        eq_(m.deferred_labels, True)
+        xml = mapnik.save_map_to_string(m)
+        eq_('deferred-labels="true"' in xml, True)
+        eq_('priority="1"' in xml, True)
+        eq_('priority="[rank]*10"' in xml, True)
+        m2 = mapnik.Map(256, 256)
+        mapnik.load_map_from_string(m2, xml)
+        eq_(m2.deferred_labels, True)
+        eq_(mapnik.save_map_to_string(m2), xml)
+        m2.zoom_to_box(mapnik.Box2d(-1, -1, 1, 1))
+        eq_(render_colors(m2), render_colors(m))
+        # the default is not written out
+        m.deferred_labels = False
+        eq_('deferred-labels' in mapnik.save_map_to_string(m), False)
+
+    if mapnik.has_grid_renderer():
+
+        def test_grid_places_by_priority():
+            # both features in one layer, the lower priority one first
+            m = make_map(['high'])
+            lyr = m.layers[0]
+            lyr.datasource = mapnik.Datasource(type='csv', inline='x,y,rank,name\n0,0,0,first\n0,0,2,second\n')
+            grid = mapnik.Grid(m.width, m.height)
+            mapnik.render_layer(m, grid, layer=0, fields=['name'])
+            names = [feature['name'] for feature in grid.encode('utf', resolution=4)['data'].values()]
+            eq_(names, ['second'])
+            m.deferred_labels = False
+            grid = mapnik.Grid(m.width, m.height)
+            mapnik.render_layer(m, grid, layer=0, fields=['name'])
+            names = [feature['name'] for feature in grid.encode('utf', resolution=4)['data'].values()]
+            eq_(names, ['first'])
+
+if __name__ == "__main__":
+    setup()
+    exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+from nose.tools import eq_, raises
+from utilities import execution_path, run_all
+
+import os, mapnik
+import threading
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+if 'gdal' in mapnik.DatasourceCache.plugin_names():
+
+    pyramid = '../data/tiff/ndvi_256x256_gray8_pyramid.tif'
+    # the 64x64 overview of the pyramid on its own
+    overview = '../data/tiff/ndvi_64x64_gray8_overview.tif'
+
+    def make_map(datasource, size):
+        _map = mapnik.Map(size, size)
+        style = mapnik.Style()
+        rule = mapnik.Rule()
+        rule.symbols.append(mapnik.RasterSymbolizer())
+        style.rules.append(rule)
+        _map.append_style('raster_style', style)
+        lyr = mapnik.Layer('raster')
+        lyr.datasource = datasource
+        lyr.styles.append('raster_style')
+        _map.layers.append(lyr)
+        _map.zoom_to_box(mapnik.Box2d(0, 0, 256, 256))
+        return _map
+
+    def render(_map):
+        im = mapnik.Image(_map.width, _map.height)
+        mapnik.render(_map, im)
+        return im.tostring()
+
+    def test_overview_read_at_reduced_scale():
+        # a quarter scale render reads the pixels of the 64x64 overview
+        # instead of downsampling the full resolution
+        from_pyramid = render(make_map(mapnik.Gdal(file=pyramid, extent='0,0,256,256'), 64))
+        from_overview = render(make_map(mapnik.Gdal(file=overview, extent='0,0,256,256'), 64))
+        eq_(from_pyramid, from_overview)
+        # at full scale the overviews are not used
+        full = render(make_map(mapnik.Gdal(file=pyramid, extent='0,0,256,256'), 256))
+        eq_(full == render(make_map(mapnik.Gdal(file=overview, extent='0,0,256,256'), 256)), False)
+
+    def check_concurrent_featuresets(**kwargs):
+        ds = mapnik.Gdal(file=pyramid, extent='0,0,256,256', **kwargs)
+        # more featuresets open at once than handles in the pool
+        query = mapnik.Query(ds.envelope())
+        featuresets = [ds.features(query) for i in range(4)]
+        for fs in featuresets:
+            feat = fs.next()
+            eq_(feat.has_key('nodata'), True)
+        _map = make_map(ds, 64)
+        expected = render(_map)
+        results = []
+        def run():
+            for i in range(10):
+                results.append(render(_map) == expected)
+        threads = [threading.Thread(target=run) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        eq_(results, [True] * 40)
+
+    def test_concurrent_featuresets_share_pooled_handles():
+        check_concurrent_featuresets(max_size=2)
+
+    def test_concurrent_featuresets_share_one_handle():
+        check_concurrent_featuresets(shared=True)
+
+    def test_shared_handle_of_two_datasources():
+        # GDAL gives both datasources the same handle, renders of either
+        # must wait for each other
+        maps = [make_map(mapnik.Gdal(file=pyramid, extent='0,0,256,256', shared=True), 64)
+                for i in range(2)]
+        expected = render(maps[0])
+        results = []
+        def run(_map):
+            for i in range(10):
+                results.append(render(_map) == expected)
+        threads = [threading.Thread(target=run, args=(maps[i % 2],)) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        eq_(results, [True] * 40)
+
+    @raises(RuntimeError)
+    def test_missing_file_throws():
+        mapnik.Gdal(file='../data/tiff/does_not_exist.tif')
+
+if __name__ == "__main__":
+    setup()
+    exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
@@ -63,6 +63,25 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
                 fail_im.save('/tmp/mapnik-style-image-filter-' + filename + '.fail.png','png32')
         eq_(len(fails), 0, '\n'+'\n'.join(fails))
 
+    def test_image_filters_in_bands():
+        eq_(mapnik.band_threads(), 1)
+        m = mapnik.Map(1024, 1024)
+        mapnik.load_map(m, '../data/good_maps/style_level_image_filter.xml')
+        m.zoom_all()
+        for name in ("agg-stack-blur(2,2)", "blur", "emboss", "sobel", "x-gradient"):
+            style_markers = m.find_style("markers")
+            style_markers.image_filters = name
+            replace_style(m, "markers", style_markers)
+            single = mapnik.Image(m.width, m.height)
+            mapnik.render(m, single)
+            mapnik.set_band_threads(4)
+            try:
+                banded = mapnik.Image(m.width, m.height)
+                mapnik.render(m, banded)
+            finally:
+                mapnik.set_band_threads(1)
+            eq_(banded.tostring('png32'), single.tostring('png32'), name)
+
 if __name__ == "__main__":
     setup()
     exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
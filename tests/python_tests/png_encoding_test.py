@@ -157,6 +157,19 @@ if mapnik.has_png():
         eq_(len(im.tostring('png8:t=0')) == len(im_in.tostring('png8')), True)
         eq_(len(im.tostring('png8:t=0:m=o')) == len(im_in.tostring('png8:m=o')), True)
 
+    def test_lossless_encodings():
+        im = mapnik.Image.open('./images/support/transparency/aerial_rgba.png')
+        expected = mapnik.Image.fromstring(im.tostring('png32')).tostring('png32')
+        expected_rgb = mapnik.Image.fromstring(im.tostring('png32:t=0')).tostring('png32')
+        for opt in ['png32:p=4','png32:p=4:t=0','png32:p=0:z=1:s=rle',
+                    'png32:f=adaptive','png32:z=fast:t=0','png32:p=4:z=fast',
+                    'png32:e=miniz:f=adaptive','png32:e=miniz:z=fast:t=0']:
+            t0 = tmp_dir + 'png-encoding-lossless.png'
+            im.save(t0, opt)
+            eq_(mapnik.Image.open(t0).tostring('png32'),
+                expected_rgb if 't=0' in opt else expected,
+                '%s not lossless' % opt)
+
     def test_9_colors_hextree():
         expected = './images/support/encoding-opts/png8-9cols.png'
         im = mapnik.Image.open(expected)
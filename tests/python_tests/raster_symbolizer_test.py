@@ -143,6 +143,62 @@ def test_raster_with_alpha_blends_correctly_with_background():
         # All white is expected
         eq_(get_unique_colors(mim),['rgba(254,254,254,255)'])
 
+def test_raster_cache_rereads_replaced_file():
+    if 'raster' in mapnik.DatasourceCache.plugin_names():
+        filepath = '/tmp/mapnik-raster-cache-test.png'
+        def render(color, size, format='png32'):
+            im = mapnik.Image(size, size)
+            im.fill(mapnik.Color(color))
+            im.save(filepath, format)
+            _map = mapnik.Map(64, 64)
+            style = mapnik.Style()
+            rule = mapnik.Rule()
+            rule.symbols.append(mapnik.RasterSymbolizer())
+            style.rules.append(rule)
+            _map.append_style('raster_style', style)
+            lyr = mapnik.Layer('raster')
+            # the same window of the same path each time, only the file changes
+            lyr.datasource = mapnik.Raster(file=filepath, lox=0, loy=0, hix=64, hiy=64)
+            lyr.styles.append('raster_style')
+            _map.layers.append(lyr)
+            _map.zoom_all()
+            out = mapnik.Image(_map.width, _map.height)
+            mapnik.render(_map, out)
+            return get_unique_colors(out)
+        eq_(render('red', 32), ['rgba(255,0,0,255)'])
+        eq_(render('red', 32), ['rgba(255,0,0,255)'])
+        # rewritten in place with another size and colour
+        eq_(render('blue', 16), ['rgba(0,0,255,255)'])
+        # rewritten in place with the same size, most likely within the same
+        # second: a solid png8 only differs in its one palette entry
+        eq_(render('red', 16, 'png8'), ['rgba(255,0,0,255)'])
+        size = os.path.getsize(filepath)
+        eq_(render('green', 16, 'png8'), ['rgba(0,128,0,255)'])
+        eq_(os.path.getsize(filepath), size)
+        os.remove(filepath)
+
+def test_jpeg_raster_scaled_decode_is_opt_in():
+    if 'raster' in mapnik.DatasourceCache.plugin_names():
+        def render(**kwargs):
+            _map = mapnik.Map(16, 16)
+            style = mapnik.Style()
+            rule = mapnik.Rule()
+            rule.symbols.append(mapnik.RasterSymbolizer())
+            style.rules.append(rule)
+            _map.append_style('raster_style', style)
+            lyr = mapnik.Layer('raster')
+            lyr.datasource = mapnik.Raster(file='../data/images/checker.jpg',
+                                           lox=0, loy=0, hix=70, hiy=70, **kwargs)
+            lyr.styles.append('raster_style')
+            _map.layers.append(lyr)
+            _map.zoom_all()
+            out = mapnik.Image(_map.width, _map.height)
+            mapnik.render(_map, out)
+            return out.tostring()
+        # downsampled more than 4x, yet by default the jpeg is decoded at full scale
+        eq_(render(), render(overviews=False))
+        eq_(len(render(scaled_decode=True)), len(render()))
+
 def test_raster_warping():
     lyrSrs = "+init=epsg:32630"
     mapSrs = '+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs'
@@ -69,6 +69,40 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
         eq_(feat['NUMERIC'],32)
         eq_(feat['DATE'],'20121202')
 
+    def test_dbf_strings_are_trimmed_and_numbers_parsed():
+        ds = mapnik.Shapefile(file='../data/shp/dbf_fields')
+        eq_(ds.fields(),['NAME', 'CODE', 'COUNT', 'RATIO', 'MAYBE'])
+        eq_(ds.field_types(),['str', 'str', 'int', 'float', 'int'])
+        features = ds.all_features()
+        eq_(len(features),3)
+        # padding on either side is dropped, a blank string stays empty and
+        # blank or '*' filled numbers are null
+        eq_(features[0].attributes,{'NAME':u'padded', 'CODE':u'ab', 'COUNT':42, 'RATIO':-1.25, 'MAYBE':None})
+        eq_(features[1].attributes,{'NAME':u'full width', 'CODE':u'', 'COUNT':-7, 'RATIO':1234.5, 'MAYBE':12})
+        eq_(features[2].attributes,{'NAME':u'x', 'CODE':u'abcdef', 'COUNT':0, 'RATIO':0.0, 'MAYBE':None})
+
+    def test_dbf_subset_of_columns():
+        ds = mapnik.Shapefile(file='../data/shp/dbf_fields')
+        query = mapnik.Query(ds.envelope())
+        query.add_property_name('RATIO')
+        query.add_property_name('NAME')
+        fs = ds.features(query)
+        eq_(fs.next().attributes,{'NAME':u'padded', 'RATIO':-1.25})
+        eq_(fs.next().attributes,{'NAME':u'full width', 'RATIO':1234.5})
+        eq_(fs.next().attributes,{'NAME':u'x', 'RATIO':0.0})
+        query = mapnik.Query(ds.envelope())
+        query.add_property_name('COUNT')
+        eq_([f.attributes for f in ds.features(query)],[{'COUNT':42}, {'COUNT':-7}, {'COUNT':0}])
+
+    def test_dbf_records_missing_from_the_file_are_empty():
+        # the dbf declares three records but only holds two: the third shape
+        # gets no attributes rather than those of the second
+        ds = mapnik.Shapefile(file='../data/shp/dbf_truncated')
+        features = ds.all_features()
+        eq_(len(features),3)
+        eq_(features[1]['NAME'],u'second')
+        eq_(features[2].attributes,{'NAME':None, 'CODE':None, 'COUNT':None, 'RATIO':None, 'MAYBE':None})
+
     # created by hand in qgis 1.8.0
     def test_shapefile_point2d_from_qgis():
         ds = mapnik.Shapefile(file='../data/shp/points/qgis.shp')
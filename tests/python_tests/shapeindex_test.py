@@ -46,6 +46,37 @@ def test_shapeindex():
         pass
       eq_(count,count2)
 
+def feature_ids(ds,box):
+    ids = []
+    fs = ds.features(mapnik.Query(box))
+    try:
+      while (True):
+        ids.append(fs.next().id())
+    except StopIteration:
+      pass
+    return sorted(ids)
+
+def test_shapeindex_rtree():
+    # the packed r-tree must return the same features as the original files
+    source_dir = '../data/shp/'
+    working_dir = '/tmp/mapnik-shp-rtree-tmp/'
+    if os.path.exists(working_dir):
+      shutil.rmtree(working_dir)
+    shutil.copytree(source_dir,working_dir)
+    for name in ['world_merc','poly','ne_110m_admin_0_countries']:
+      source_file = os.path.join(source_dir,name+'.shp')
+      dest_file = os.path.join(working_dir,name+'.shp')
+      stdin, stderr = Popen('shapeindex --rtree --node-size 4 %s' % dest_file, shell=True, stdout=PIPE, stderr=PIPE).communicate()
+      eq_(os.path.exists(os.path.join(working_dir,name+'.rtree')),True)
+      ds = mapnik.Shapefile(file=source_file)
+      ds2 = mapnik.Shapefile(file=dest_file)
+      extent = ds.envelope()
+      boxes = [extent,
+               mapnik.Box2d(extent.minx,extent.miny,extent.center().x,extent.center().y),
+               mapnik.Box2d(extent.center().x,extent.center().y,extent.maxx,extent.maxy)]
+      for box in boxes:
+        eq_(feature_ids(ds,box),feature_ids(ds2,box))
+
 if __name__ == "__main__":
     setup()
     exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+
+from nose.tools import eq_
+from utilities import execution_path, run_all
+
+import os, mapnik
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+# Labels on a 4x4 grid of 128px cells, one per cell. Layouts shaped once are
+# reused for later labels with the same text and properties during a render.
+map_template = '''<Map srs="+init=epsg:4326">
+  <Style name="labels">
+    <Rule>
+      <TextSymbolizer face-name="DejaVu Sans Book" allow-overlap="true"
+          size="[size]" fill="[fill]" halo-fill="[halo_fill]" halo-radius="[halo]"
+          wrap-width="[wrap]" character-spacing="[spacing]">[name]</TextSymbolizer>
+    </Rule>
+  </Style>
+  <Layer name="labels" srs="+init=epsg:4326">
+    <StyleName>labels</StyleName>
+    <Datasource>
+      <Parameter name="type">csv</Parameter>
+      <Parameter name="inline">
+%s
+      </Parameter>
+    </Datasource>
+  </Layer>
+</Map>
+'''
+
+header = 'x,y,name,size,fill,halo_fill,halo,wrap,spacing'
+
+# repeats of one label with variations of each property that changes its layout or look
+labels = [
+    'Main St,12,black,white,1,0,0',
+    'Main St,12,black,white,1,0,0',
+    'Main St,14,black,white,1,0,0',
+    'Main St,12,red,white,1,0,0',
+    'Main St,12,black,blue,1,0,0',
+    'Main St,12,black,white,3,0,0',
+    'Main St,12,black,white,1,30,0',
+    'Main St,12,black,white,1,0,2',
+    'Main St,12,black,white,1,0,0',
+    'Main Rd,12,black,white,1,0,0',
+    'Main St,14,black,white,1,0,0',
+    'Main St,12,red,white,1,0,0',
+    'Main St,12,black,white,1,30,0',
+    'Main St,12,black,white,1,0,2',
+    'Main Rd,12,black,white,1,0,0',
+    'Main St,12,black,white,1,0,0',
+]
+
+cell = 128
+
+def cell_center(i):
+    return (cell / 2 + (i % 4) * cell, cell / 2 + (i / 4) * cell)
+
+def make_map(indexes):
+    rows = [header]
+    for i in indexes:
+        x, y = cell_center(i)
+        rows.append('%d,%d,%s' % (x, y, labels[i]))
+    m = mapnik.Map(4 * cell, 4 * cell)
+    mapnik.load_map_from_string(m, map_template % '\n'.join(rows))
+    m.zoom_to_box(mapnik.Box2d(0, 0, 4 * cell, 4 * cell))
+    return m
+
+def render(m):
+    im = mapnik.Image(m.width, m.height)
+    mapnik.render(m, im)
+    return im
+
+def cell_pixels(im, i):
+    x, y = cell_center(i)
+    # y grows downwards in the image
+    return im.view(x - cell / 2, 4 * cell - y - cell / 2, cell, cell).tostring()
+
+if 'csv' in mapnik.DatasourceCache.plugin_names():
+
+    def test_cached_layouts_match_uncached():
+        everything = render(make_map(range(len(labels))))
+        blank = mapnik.Image(cell, cell).tostring()
+        for i in range(len(labels)):
+            # a map with a single label never hits the cache
+            alone = render(make_map([i]))
+            eq_(cell_pixels(alone, i) != blank, True)
+            eq_(cell_pixels(everything, i), cell_pixels(alone, i),
+                'label %d (%s) differs when rendered with the others' % (i, labels[i]))
+
+    def test_property_changes_are_not_shared():
+        im = render(make_map(range(len(labels))))
+        for i in range(len(labels)):
+            for j in range(i):
+                eq_(cell_pixels(im, i) == cell_pixels(im, j), labels[i] == labels[j],
+                    'labels %d (%s) and %d (%s)' % (i, labels[i], j, labels[j]))
+
+if __name__ == "__main__":
+    setup()
+    exit(run_all(eval(x) for x in dir() if x.startswith("test_")))
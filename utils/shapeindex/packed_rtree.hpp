@@ -0,0 +1,190 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2014 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef PACKED_RTREE_HPP
+#define PACKED_RTREE_HPP
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+// mapnik
+#include <mapnik/box2d.hpp>
+
+#include "shp_rtree.hpp"
+
+using mapnik::box2d;
+using mapnik::coord2d;
+
+// Builds the packed Hilbert R-tree index read by the shape plugin, see
+// shp_rtree.hpp for the file layout.
+class packed_rtree
+{
+public:
+    explicit packed_rtree(std::uint32_t node_size)
+        : node_size_(node_size < 2 ? 2 : node_size) {}
+
+    void insert(std::uint64_t offset, box2d<double> const& item_ext)
+    {
+        items_.push_back(item{item_ext, offset, 0});
+        if (items_.size() == 1) extent_ = item_ext;
+        else extent_.expand_to_include(item_ext);
+    }
+
+    std::size_t count() const
+    {
+        return items_.size();
+    }
+
+    std::uint64_t count_nodes() const
+    {
+        shp_rtree_format::header hdr;
+        hdr.node_size = node_size_;
+        hdr.count = items_.size();
+        return hdr.num_nodes();
+    }
+
+    void write(std::ostream & out)
+    {
+        using namespace shp_rtree_format;
+        sort_items();
+
+        char header[header_size];
+        std::memset(header, 0, header_size);
+        std::memcpy(header, "mapnik", 6);
+        put_uint(header + 6, version, 2);
+        put_uint(header + 8, node_size_, 4);
+        put_uint(header + 16, items_.size(), 8);
+        put_box(header + 24, extent_);
+        out.write(header, header_size);
+
+        // every level is written as full nodes, its entries are the boxes of
+        // the nodes written for the level below
+        std::vector<entry> level;
+        level.reserve(items_.size());
+        for (auto const& i : items_) level.push_back(entry{i.box, i.offset});
+        std::uint64_t node = 0;
+        std::vector<char> buffer(std::size_t(node_size_) * entry_size);
+        while (!level.empty())
+        {
+            std::vector<entry> parents;
+            for (std::size_t first = 0; first < level.size(); first += node_size_)
+            {
+                std::size_t last = std::min(level.size(), first + std::size_t(node_size_));
+                std::memset(buffer.data(), 0, buffer.size());
+                box2d<double> node_ext = level[first].box;
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    char * data = buffer.data() + (i - first) * entry_size;
+                    put_box(data, level[i].box);
+                    put_uint(data + 32, level[i].value, 8);
+                    node_ext.expand_to_include(level[i].box);
+                }
+                out.write(buffer.data(), buffer.size());
+                parents.push_back(entry{node_ext, node++});
+            }
+            if (level.size() <= node_size_) break;
+            level.swap(parents);
+        }
+    }
+
+private:
+    struct item
+    {
+        box2d<double> box;
+        std::uint64_t offset;
+        std::uint32_t hilbert;
+    };
+
+    struct entry
+    {
+        box2d<double> box;
+        std::uint64_t value;
+    };
+
+    // Position of (x, y) along the Hilbert curve filling a 2^16 x 2^16 grid
+    static std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t d = 0;
+        for (std::uint32_t s = 1 << 15; s > 0; s >>= 1)
+        {
+            std::uint32_t rx = (x & s) > 0;
+            std::uint32_t ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    void sort_items()
+    {
+        double width = extent_.width();
+        double height = extent_.height();
+        double const max = 65535.0;
+        for (auto & i : items_)
+        {
+            coord2d c = i.box.center();
+            std::uint32_t x = width > 0 ? static_cast<std::uint32_t>(max * (c.x - extent_.minx()) / width) : 0;
+            std::uint32_t y = height > 0 ? static_cast<std::uint32_t>(max * (c.y - extent_.miny()) / height) : 0;
+            i.hilbert = hilbert(x, y);
+        }
+        std::sort(items_.begin(), items_.end(), [](item const& a, item const& b)
+                  {
+                      return a.hilbert < b.hilbert || (a.hilbert == b.hilbert && a.offset < b.offset);
+                  });
+    }
+
+    static void put_uint(char * data, std::uint64_t value, unsigned bytes)
+    {
+        for (unsigned i = 0; i < bytes; ++i)
+        {
+            data[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void put_box(char * data, box2d<double> const& box)
+    {
+        double coords[4] = { box.minx(), box.miny(), box.maxx(), box.maxy() };
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, &coords[i], 8);
+            put_uint(data + 8 * i, bits, 8);
+        }
+    }
+
+    std::uint32_t node_size_;
+    std::vector<item> items_;
+    box2d<double> extent_;
+};
+
+#endif // PACKED_RTREE_HPP